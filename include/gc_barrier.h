@@ -4,6 +4,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "gc_types.h"
 
 
@@ -15,6 +16,7 @@ typedef enum {
   GC_BARRIER_CARD_MARKING = 1,
   GC_BARRIER_SNAPSHOT = 2,
   GC_BARRIER_INCREMENTAL = 3,
+  GC_BARRIER_REMSET = 4,  // remembers old->young sources in a set instead of cards
 } gc_barrier_type_t;
 
 typedef struct {
@@ -28,6 +30,10 @@ typedef struct {
 typedef struct gc_barrier_context {
   gc_barrier_type_t type;
   bool enabled;
+  bool stats_enabled;    // counting every store sends every store to the slow path
+  bool filtered;         // only old->young stores need the slow path
+  uintptr_t young_start; // nursery bounds copied from the generation context,
+  size_t young_size;     // empty without one
   gc_barrier_stats_t stats;
 } gc_barrier_t;
 
@@ -35,14 +41,40 @@ typedef struct gc_barrier_context {
 bool gc_barrier_init(gc_t *gc, gc_barrier_type_t type);
 void gc_barrier_destroy(gc_t *gc);
 
+// full barrier: classifies the store by header, counts it and does the
+// incremental and concurrent marking work
 void gc_barrier_write(gc_t *gc, void *from_obj, void *to_obj);
+void gc_barrier_write_slow(gc_t *gc, void *from_obj, void *to_obj);
+void gc_barrier_delete(gc_t *gc, void *from_obj, void *to_obj);
 void gc_barrier_array_write(gc_t *gc, void *array, size_t index, void *value);
+// after array[start, start + count) were stored: one pass over the slots,
+// then the cards covering the young ones are dirtied once. Only remembers,
+// the slots still need edges (simple_gc_array_copy records them)
+void gc_barrier_range_write(gc_t *gc, void *array, size_t start, size_t count);
 
+// recomputes the filter after stats, generations or marking modes change
+void gc_barrier_update_filter(gc_t *gc);
+void gc_barrier_set_stats(gc_t *gc, bool enabled);
+
+// stats are only counted after gc_barrier_set_stats(gc, true)
 void gc_barrier_get_stats(gc_t *gc, gc_barrier_stats_t *stats);
 void gc_barrier_print_stats(gc_t *gc);
 void gc_barrier_reset_stats(gc_t *gc);
 
-#define GC_WRITE(gc, from, to) gc_barrier_write(gc, from, to)
+// a store only matters to a minor collection when it makes an old object
+// point into the nursery; the unsigned subtraction checks both bounds in
+// one compare, so other stores leave after at most two
+static inline void gc_barrier_write_fast(gc_t *gc, gc_barrier_t *barrier, void *from_obj, void *to_obj) {
+  if (!barrier || !barrier->enabled) return;
+
+  if (barrier->filtered) {
+    if ((uintptr_t) to_obj - barrier->young_start >= barrier->young_size) return;
+    if ((uintptr_t) from_obj - barrier->young_start < barrier->young_size) return;
+  }
+  gc_barrier_write_slow(gc, from_obj, to_obj);
+}
+
+#define GC_WRITE(gc, from, to) gc_barrier_write_fast(gc, (gc)->barrier_context, from, to)
 #define GC_ARRAY_WRITE(gc, array, index, value) gc_barrier_array_write(gc, array, index, value)
 
 
@@ -0,0 +1,70 @@
+#ifndef GC_BITMAP_H
+#define GC_BITMAP_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define GC_BITMAP_WORD_BITS 64
+#define GC_BITMAP_WORDS(bits) (((bits) + GC_BITMAP_WORD_BITS - 1) / GC_BITMAP_WORD_BITS)
+
+
+// sweep over whole bitmaps: mark becomes the dead set (alloc & ~mark),
+// alloc keeps only survivors (alloc & mark); returns the number of dead bits
+size_t gc_bitmap_sweep(uint64_t *alloc, uint64_t *mark, size_t words);
+
+static inline unsigned gc_bitmap_ctz(uint64_t word) {
+#if defined(__GNUC__)
+  return (unsigned) __builtin_ctzll(word);
+#else
+  unsigned n = 0;
+  while (!(word & 1)) {
+    word >>= 1;
+    ++n;
+  }
+  return n;
+#endif
+}
+
+static inline unsigned gc_bitmap_clz(uint64_t word) {
+#if defined(__GNUC__)
+  return (unsigned) __builtin_clzll(word);
+#else
+  unsigned n = 0;
+  while (!(word & ((uint64_t) 1 << 63))) {
+    word <<= 1;
+    ++n;
+  }
+  return n;
+#endif
+}
+
+static inline size_t gc_bitmap_popcount(uint64_t word) {
+#if defined(__GNUC__)
+  return (size_t) __builtin_popcountll(word);
+#else
+  size_t n = 0;
+  while (word) {
+    word &= word - 1;
+    ++n;
+  }
+  return n;
+#endif
+}
+
+static inline bool gc_bitmap_test(const uint64_t *bits, size_t index) {
+  return (bits[index / GC_BITMAP_WORD_BITS] >> (index % GC_BITMAP_WORD_BITS)) & 1;
+}
+
+static inline void gc_bitmap_set(uint64_t *bits, size_t index) {
+  bits[index / GC_BITMAP_WORD_BITS] |= (uint64_t) 1 << (index % GC_BITMAP_WORD_BITS);
+}
+
+static inline void gc_bitmap_clear(uint64_t *bits, size_t index) {
+  bits[index / GC_BITMAP_WORD_BITS] &= ~((uint64_t) 1 << (index % GC_BITMAP_WORD_BITS));
+}
+
+
+#endif /* GC_BITMAP_H */
@@ -15,26 +15,60 @@ typedef struct gc_context gc_t;
 #define GC_CARD_CLEAN 0
 #define GC_CARD_DIRTY 1
 
-
+// summary: one bit per chunk of 64 cards (32 KiB of heap), set with any of
+// its cards; the scan only descends into chunks whose bit is set
+#define GC_CARD_CHUNK_SHIFT 6
+#define GC_CARD_CHUNK_CARDS (1u << GC_CARD_CHUNK_SHIFT)
+
+// sparse table: cards are kept in regions of GC_CARD_REGION_CARDS cards
+// (1 MiB of heap), committed the first time one of their cards is dirtied or
+// an object in them is recorded, so every address has a card and far apart
+// mappings cost nothing in between
+#define GC_CARD_REGION_SHIFT 11
+#define GC_CARD_REGION_CARDS (1u << GC_CARD_REGION_SHIFT)
+
+// crossing map: object starts are kept per GC_CARD_GRANULE, one 64-bit word
+// per card; a card whose first byte belongs to an object starting earlier
+// records how many cards back that object starts, GC_CROSSING_MAX meaning
+// "at least that far, step back GC_CROSSING_MAX - 1 and look again"
+#define GC_CARD_GRANULE 8
+#define GC_CROSSING_MAX 255
+
+
+typedef struct gc_card_region {
+  size_t first_card;  // multiple of GC_CARD_REGION_CARDS
+  uint64_t summary;   // bit per chunk that may hold dirty cards
+  uint8_t cards[GC_CARD_REGION_CARDS];
+  uint8_t crossing[GC_CARD_REGION_CARDS];  // cards back to the object covering the first byte
+  uint64_t starts[GC_CARD_REGION_CARDS];   // bit i: a header starts at card + i * GC_CARD_GRANULE
+} gc_card_region_t;
+
+// card i covers heap_start + i * GC_CARD_SIZE; indices wrap, so addresses
+// below heap_start have cards too
 typedef struct gc_cardtable {
-  uint8_t *cards;
-  size_t num_cards;
   void *heap_start;
-  void *heap_end;
+  gc_card_region_t **regions;  // committed regions sorted by first_card
+  size_t region_count;
+  size_t region_capacity;
+  gc_card_region_t *last;      // region found by the last lookup
+  size_t num_cards;            // cards in committed regions
   size_t dirty_count;
   bool enabled;
 } gc_cardtable_t;
 
 typedef void (*gc_card_scan_fn)(gc_t *gc, void *card_start, void *card_end, void *user_data);
+typedef void (*gc_card_object_fn)(gc_t *gc, void *header, void *user_data);
 
 
+// heap_size bytes from heap_start are committed up front, the rest on use
 bool gc_cardtable_init(gc_cardtable_t *table, void *heap_start, size_t heap_size);
 void gc_cardtable_destroy(gc_cardtable_t *table);
 
 size_t gc_cardtable_addr_to_card(gc_cardtable_t *table, void *addr);
 void *gc_cardtable_card_to_addr(gc_cardtable_t *table, size_t card_index);
-void gc_cardtable_mark_dirty(gc_cardtable_t *table, void *addr);
-void gc_cardtable_mark_range_dirty(gc_cardtable_t *table, void *start, size_t size);
+// false only when a region could not be committed
+bool gc_cardtable_mark_dirty(gc_cardtable_t *table, void *addr);
+bool gc_cardtable_mark_range_dirty(gc_cardtable_t *table, void *start, size_t size);
 bool gc_cardtable_is_dirty(gc_cardtable_t *table, void *addr);
 
 void gc_cardtable_clear(gc_cardtable_t *table);
@@ -42,6 +76,13 @@ void gc_cardtable_clear_card(gc_cardtable_t *table, size_t card_index);
 
 void gc_cardtable_scan_dirty(gc_t *gc, gc_cardtable_t *table, gc_card_scan_fn callback, void *user_data);
 
+// crossing map; headers must sit at GC_CARD_GRANULE offsets from heap_start
+bool gc_cardtable_record_object(gc_cardtable_t *table, void *header, size_t bytes);
+bool gc_cardtable_has_object(gc_cardtable_t *table, void *header);
+void gc_cardtable_forget_objects(gc_cardtable_t *table);
+void gc_cardtable_for_each_object(gc_t *gc, gc_cardtable_t *table, void *card_start,
+    gc_card_object_fn callback, void *user_data);
+
 size_t gc_cardtable_dirty_count(gc_cardtable_t *table);
 float gc_cardtable_dirty_ratio(gc_cardtable_t *table);
 void gc_cardtable_print_stats(gc_cardtable_t *table);
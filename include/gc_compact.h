@@ -0,0 +1,121 @@
+#ifndef GC_COMPACT_H
+#define GC_COMPACT_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "gc_types.h"
+#include "gc_pool.h"
+
+
+typedef struct gc_context gc_t;
+
+
+#define GC_FRAG_BUCKETS 10
+
+// blocks below this occupancy count as sparse
+#define GC_COMPACT_SPARSE_OCCUPANCY 0.5f
+
+// live bytes evacuation may copy in one compaction
+#define GC_EVACUATE_DEFAULT_BUDGET (256 * 1024)
+
+// free large blocks worth returning to the allocator
+#define GC_COMPACT_LARGE_FREE_BYTES (16 * 1024)
+
+
+typedef enum {
+  GC_COMPACT_SLIDE = 0,      // slide every survivor of a class, pause ~ live data
+  GC_COMPACT_EVACUATE,       // copy out only the sparsest blocks, pause ~ budget
+  GC_COMPACT_DEPTH_FIRST,    // lay survivors out in depth-first order from the roots
+  GC_COMPACT_BREADTH_FIRST   // same, breadth-first
+} gc_compact_mode_t;
+
+// pool blocks by occupancy, bucket i holds [i/10, (i+1)/10) of capacity used
+typedef struct gc_frag_histogram {
+  size_t blocks[GC_FRAG_BUCKETS];
+  size_t free_bytes[GC_FRAG_BUCKETS];
+} gc_frag_histogram_t;
+
+
+typedef struct relocation_entry {
+  void *old_addr;  // NULL marks an empty slot
+  void *new_addr;
+} relocation_entry_t;
+
+// open-addressing table of moved objects, sized from the live count before
+// a compaction so that it never grows while objects are being moved
+typedef struct compaction_ctx {
+  relocation_entry_t *relocations;
+  size_t relocation_count;
+  size_t relocation_capacity;  // power of two
+  bool in_progress;
+
+  gc_compact_mode_t mode;
+  size_t evacuate_budget;
+  bool compact_large;  // include the large tier, off: dead blocks stay for reuse
+
+  // objects pinned by the last stack scan; pins_incomplete disables moving
+  // when one of them could not be recorded
+  obj_header_t **stack_pins;
+  size_t stack_pin_count;
+  size_t stack_pin_capacity;
+  bool pins_incomplete;
+
+  // statistics
+  size_t blocks_released;
+  size_t bytes_released;
+  size_t blocks_evacuated;
+  size_t bytes_evacuated;
+  size_t pinned_skipped;
+  size_t large_blocks_released;
+  size_t large_bytes_released;
+  size_t large_objects_moved;
+} compaction_ctx_t;
+
+
+void gc_compact_init(compaction_ctx_t *ctx);
+void gc_compact_destroy(compaction_ctx_t *ctx);
+
+// pinned objects stay where they are and their slots are never a destination
+bool gc_compact_pin_stack(compaction_ctx_t *ctx, obj_header_t *header);
+void gc_compact_unpin_stack(compaction_ctx_t *ctx);
+bool gc_compact_can_move(const compaction_ctx_t *ctx);
+
+// relocation table
+bool gc_compact_relocations_init(compaction_ctx_t *ctx, size_t live_count);
+// false once the table is half full, callers record before they move
+bool gc_compact_add_relocation(compaction_ctx_t *ctx, void *old_addr, void *new_addr);
+void *gc_compact_find_new_address(compaction_ctx_t *ctx, void *old_addr);
+void gc_compact_clear_relocations(compaction_ctx_t *ctx);
+
+// sliding (LISP2) compaction of one size class: survivors keep their order
+// and are packed towards the head of the block list
+bool gc_compact_class_needed(const size_class_t *sc);
+bool gc_compact_plan_class(gc_t *gc, size_class_t *sc);
+void gc_compact_update_references(gc_t *gc);
+void gc_compact_move_class(size_class_t *sc);
+size_t gc_compact_release_blocks(gc_t *gc, size_class_t *sc);
+
+// all three passes over every pool size class, then release emptied blocks
+void gc_compact_pools(gc_t *gc);
+
+// locality: pack every class with survivors in the order a traversal of the
+// recorded edges from roots and handles reaches them, so objects that are
+// walked together end up in neighbouring slots
+void gc_compact_locality(gc_t *gc, bool breadth_first);
+
+// evacuation: rank blocks by occupancy and copy the survivors of the sparsest
+// ones into denser blocks of the same class until the byte budget is spent
+size_t gc_compact_evacuate_class(gc_t *gc, size_class_t *sc, size_t *budget);
+void gc_compact_evacuate(gc_t *gc);
+
+// large tier: free blocks go back to the allocator and the survivors are
+// packed into one arena, so the tier shrinks with its live bytes
+size_t gc_compact_large_free_bytes(const gc_t *gc);
+size_t gc_compact_release_large(gc_t *gc);
+void gc_compact_large(gc_t *gc);
+
+void gc_compact_histogram(gc_t *gc, gc_frag_histogram_t *histogram);
+
+
+#endif /* GC_COMPACT_H */
@@ -0,0 +1,99 @@
+#ifndef GC_CONCURRENT_H
+#define GC_CONCURRENT_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "gc_types.h"
+
+
+typedef struct gc_context gc_t;
+typedef struct gc_concurrent_context gc_concurrent_t;
+
+
+#define GC_SATB_BUFFER_SIZE 256
+#define GC_CONCURRENT_BATCH 16 // objects scanned per heap lock acquisition
+
+
+typedef enum {
+  GC_CONC_IDLE = 0,
+  GC_CONC_MARKING = 1,
+} gc_conc_phase_t;
+
+// per-thread log of references removed while marking
+typedef struct gc_satb_buffer {
+  void *entries[GC_SATB_BUFFER_SIZE];
+  size_t count;
+  size_t logged;
+  struct gc_satb_buffer *next;
+} gc_satb_buffer_t;
+
+typedef struct {
+  size_t cycles;
+  size_t objects_scanned;
+  size_t satb_logged;
+  size_t satb_drained;
+  uint64_t initial_pause_us;
+  uint64_t final_pause_us;
+  uint64_t concurrent_mark_us;
+} gc_concurrent_stats_t;
+
+typedef struct gc_concurrent_context {
+  gc_conc_phase_t phase;
+
+  // background marker
+  pthread_t thread;
+  bool thread_running;
+  bool stop_requested;
+  bool mark_done;
+
+  // held by the marker while it touches the heap (including the collector's
+  // mark stack), by mutators while they allocate or edit roots and the
+  // reference graph, and by the collector for the whole final pause
+  pthread_mutex_t heap_lock;
+  // serializes cycle start, final pause and abort between mutator threads;
+  // taken before heap_lock, never while holding it
+  pthread_mutex_t pause_lock;
+
+  // SATB buffers: one active buffer per mutator thread, full ones queued
+  pthread_key_t satb_key;
+  pthread_mutex_t satb_lock;
+  gc_satb_buffer_t *buffers;
+  gc_satb_buffer_t *filled;
+
+  size_t cycle_objects_before;
+  gc_concurrent_stats_t stats;
+} gc_concurrent_t;
+
+
+bool gc_concurrent_init(gc_t *gc);
+void gc_concurrent_destroy(gc_t *gc);
+bool gc_concurrent_marking(const gc_t *gc);
+
+// mutator side heap lock, no-op unless concurrent mode is enabled
+void gc_concurrent_lock(gc_t *gc);
+void gc_concurrent_unlock(gc_t *gc);
+
+// serializes the phase changes below, no-op unless concurrent mode is enabled
+void gc_concurrent_pause_lock(gc_t *gc);
+void gc_concurrent_pause_unlock(gc_t *gc);
+
+// cycle control: start and final_mark run with both locks held, join with
+// only pause_lock (the marker needs heap_lock to finish), abort with only
+// pause_lock and takes heap_lock itself
+bool gc_concurrent_start(gc_t *gc);
+bool gc_concurrent_mark_done(gc_t *gc);
+void gc_concurrent_join(gc_t *gc);
+void gc_concurrent_final_mark(gc_t *gc);
+void gc_concurrent_abort(gc_t *gc);
+
+// snapshot barrier: record a reference the mutator dropped or stored
+// (caller holds the heap lock)
+void gc_concurrent_satb_log(gc_t *gc, void *ptr);
+
+void gc_concurrent_get_stats(gc_t *gc, gc_concurrent_stats_t *stats);
+
+
+#endif /* GC_CONCURRENT_H */
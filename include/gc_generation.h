@@ -4,14 +4,21 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "gc_types.h"
 #include "gc_pool.h"
 #include "gc_large.h"
 #include "gc_cardtable.h"
+#include "gc_remset.h"
 
 
 #define GC_PROMOTION_AGE 3
 
+// nursery objects start on GC_NURSERY_ALIGN boundaries, one start bit each
+#define GC_NURSERY_ALIGN 16
+// eden is this many times the size of one survivor space
+#define GC_SURVIVOR_RATIO 8
+
 typedef struct gc_context gc_t;
 typedef struct gc_gen_context gc_gen_t;
 
@@ -30,17 +37,44 @@ typedef struct {
   double total_time_ms;
 } gc_gen_stats_t;
 
+// bump allocated part of the nursery
+typedef struct gc_gen_space {
+  char *start;
+  char *top;
+  char *end;
+} gc_gen_space_t;
+
 typedef struct gc_gen_context {
   bool enabled;
 
-  size_class_t young_pools[GC_NUM_SIZE_CLASSES];
-  large_block_t *young_large;
-  size_t young_large_count;
+  // nursery: one reserved region split into eden and two survivor spaces,
+  // nothing young lives anywhere else; new objects are bump allocated in
+  // eden, minor GC copies survivors into the empty survivor space
+  char *nursery_start;
+  char *nursery_end;
+  gc_gen_space_t eden;
+  gc_gen_space_t survivor[2];
+  int survivor_from;         // survivor space holding the current survivors
+  // a minor collection had to leave live objects where they were, so no
+  // space could be dropped; the next one tenures every survivor and empties
+  // the whole nursery once nothing is left behind
+  bool kept;
+  size_t kept_used;          // young_used right after that collection
+  bool kept_retry;           // a pin was dropped or old space freed since
+  uint64_t *nursery_starts;  // bit per GC_NURSERY_ALIGN granule holding a header
 
   size_t young_capacity;
   size_t young_used;
 
+  // covers the old generation; headers are recorded in its crossing map,
+  // cards_stale once one could not be and the table must be set up again
   gc_cardtable_t cardtable;
+  bool cards_stale;
+  // old->young sources under GC_BARRIER_REMSET
+  gc_remset_t remset;
+  // set while every old->young edge has its source in a dirty card or the
+  // remembered set, whichever the barrier keeps
+  bool remembered;
 
   gc_gen_stats_t stats[GC_GEN_COUNT];
   size_t minor_count;
@@ -58,7 +92,21 @@ bool gc_gen_should_collect_minor(gc_t *gc);
 bool gc_gen_should_collect_major(gc_t *gc);
 void gc_gen_collect_minor(gc_t *gc);
 void gc_gen_collect_major(gc_t *gc);
+void gc_gen_after_full_collection(gc_t *gc);
+// a young object lost its pin, a kept nursery may be emptied now
+void gc_gen_unpinned(gc_t *gc, void *ptr);
+
+// barrier hook for an old object that now references a young one
+void gc_gen_remember(gc_t *gc, void *from_obj);
+// same for a run of slots inside from_obj, [start, start + size)
+void gc_gen_remember_range(gc_t *gc, void *from_obj, void *start, size_t size);
+
+// "is young" is an address range check
+static inline bool gc_gen_in_nursery(const gc_gen_t *gen, const void *ptr) {
+  return (const char*) ptr >= gen->nursery_start && (const char*) ptr < gen->nursery_end;
+}
 
+obj_header_t* gc_gen_nursery_header(gc_gen_t *gen, void *ptr);
 gc_generation_id_t gc_gen_which_generation(gc_t *gc, void *ptr);
 size_t gc_gen_young_size(gc_t *gc);
 size_t gc_gen_old_size(gc_t *gc);
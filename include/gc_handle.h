@@ -0,0 +1,54 @@
+#ifndef GC_HANDLE_H
+#define GC_HANDLE_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "gc_types.h"
+
+
+typedef struct gc_context gc_t;
+
+
+#define GC_HANDLE_CHUNK_SLOTS 256
+
+// a handle is the address of a table slot that holds the object's current
+// address; the slot never moves, so the handle stays valid when the object does
+typedef void **gc_handle_t;
+
+typedef struct gc_handle_chunk {
+  struct gc_handle_chunk *next;
+  void *slots[GC_HANDLE_CHUNK_SLOTS];
+} gc_handle_chunk_t;
+
+// free slots are chained through themselves with the low bit set, object
+// addresses are aligned so a live slot never has it
+typedef struct gc_handle_table {
+  gc_handle_chunk_t *chunks;
+  void **free_list;
+  size_t count;     // live handles
+  size_t capacity;  // slots in all chunks
+} gc_handle_table_t;
+
+
+bool gc_handle_table_init(gc_handle_table_t *table);
+void gc_handle_table_destroy(gc_handle_table_t *table);
+
+gc_handle_t gc_handle_new(gc_handle_table_t *table, void *ptr);
+void gc_handle_free(gc_handle_table_t *table, gc_handle_t handle);
+
+static inline bool gc_handle_is_live(const void *slot_value) {
+  return slot_value && ((size_t) slot_value & 1) == 0;
+}
+
+// calls visit on every live handle
+void gc_handle_for_each(gc_handle_table_t *table,
+    void (*visit)(gc_handle_t handle, void *ctx), void *ctx);
+
+// repoint the handle of a moved object, O(1) through the header back-pointer
+static inline void gc_handle_relocate(obj_header_t *header) {
+  if (header->handle) *header->handle = header + 1;
+}
+
+
+#endif /* GC_HANDLE_H */
@@ -0,0 +1,62 @@
+#ifndef GC_INCREMENTAL_H
+#define GC_INCREMENTAL_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "gc_types.h"
+
+
+typedef struct gc_context gc_t;
+typedef struct gc_incremental_context gc_incremental_t;
+
+
+#define GC_INCREMENTAL_DEFAULT_BUDGET_US 1000
+#define GC_INCREMENTAL_CHECK_INTERVAL 32  // objects scanned between clock reads
+#define GC_INCREMENTAL_UNBOUNDED 0        // budget that runs a cycle to completion
+
+
+// tri-color state lives in the heap: white = unmarked, gray = marked and
+// still on the collector's mark stack, black = marked and scanned
+typedef enum {
+  GC_INC_IDLE = 0,
+  GC_INC_MARKING = 1,
+} gc_inc_phase_t;
+
+typedef struct {
+  size_t cycles;
+  size_t steps;
+  size_t objects_scanned;
+  size_t barrier_shades;
+  uint64_t last_step_us;
+  uint64_t max_step_us;
+} gc_incremental_stats_t;
+
+typedef struct gc_incremental_context {
+  gc_inc_phase_t phase;
+
+  size_t budget_us; // budget used by allocation-driven steps
+  size_t cycle_objects_before;
+  uint64_t cycle_pause_us;
+  gc_incremental_stats_t stats;
+} gc_incremental_t;
+
+
+bool gc_incremental_init(gc_t *gc);
+void gc_incremental_destroy(gc_t *gc);
+bool gc_incremental_marking(const gc_t *gc);
+
+// cycle control
+void gc_incremental_start(gc_t *gc);
+size_t gc_incremental_mark(gc_t *gc, size_t max_objects);
+bool gc_incremental_step(gc_t *gc, size_t budget_us);
+void gc_incremental_abort(gc_t *gc);
+
+// shade a white object gray (used by roots and the insertion barrier)
+void gc_incremental_shade(gc_t *gc, void *ptr);
+
+void gc_incremental_get_stats(gc_t *gc, gc_incremental_stats_t *stats);
+
+
+#endif /* GC_INCREMENTAL_H */
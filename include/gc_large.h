@@ -11,12 +11,23 @@
 #define GC_SIZE_MAX 1024 * 1024 * 5  // 5 MB
 
 
+// objects packed by compaction share one allocation, header starts are
+// aligned to GC_LARGE_ARENA_ALIGN
+#define GC_LARGE_ARENA_ALIGN 16
+
+typedef struct large_arena {
+  void *memory;
+  size_t size;
+  size_t blocks;  // blocks still carved from it, freed with the last one
+} large_arena_t;
+
 // large block structure (256 bytes - 4KB objects)
 typedef struct large_block {
   void *memory;
   size_t size;
   bool in_use;
   obj_header_t *header;
+  large_arena_t *arena;  // NULL when the block owns its memory
   struct large_block *next;
 } large_block_t;
 
@@ -35,6 +46,11 @@ void gc_large_free_block(large_block_t *block);
 large_block_t* gc_large_find_best_fit(large_block_t *blocks, size_t size);
 void* gc_large_alloc(large_block_t **blocks, size_t *block_count, obj_type_t type, size_t size);
 
+// arenas for compacted large objects
+large_arena_t* gc_large_arena_create(size_t size);
+size_t gc_large_arena_footprint(const obj_header_t *header);
+obj_header_t* gc_large_move_block(large_block_t *block, large_arena_t *arena, void *memory);
+
 // huge object management
 huge_object_t* gc_huge_create_object(obj_type_t type, size_t size);
 void gc_huge_free_object(huge_object_t *huge);
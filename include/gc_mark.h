@@ -10,6 +10,35 @@ typedef struct gc_context gc_t;
 typedef struct reference_node ref_node_t;
 
 
+#define GC_MARK_STACK_CAPACITY 4096
+
+
+// fixed-size gray stack, allocated once per collector and reused by every
+// cycle; when it fills up, objects are still marked but their children are
+// found again by an overflow rescan
+typedef struct gc_mark_stack {
+  void **entries;
+  size_t count;
+  size_t capacity;
+  bool overflowed;
+  size_t overflow_count;
+} gc_mark_stack_t;
+
+
+bool gc_mark_stack_init(gc_mark_stack_t *stack, size_t capacity);
+void gc_mark_stack_destroy(gc_mark_stack_t *stack);
+void gc_mark_stack_clear(gc_mark_stack_t *stack);
+
+// building blocks shared by the stop-the-world, incremental and concurrent markers
+bool gc_mark_shade(gc_t *gc, void *ptr);
+void gc_mark_scan(gc_t *gc, void *ptr);
+size_t gc_mark_drain(gc_t *gc, size_t max_objects);
+bool gc_mark_recover_overflow(gc_t *gc);
+
+// drain and rescan until nothing gray is left
+void gc_mark_complete(gc_t *gc);
+void gc_mark_shade_roots(gc_t *gc);
+
 void gc_mark_object(gc_t *gc, void *ptr);
 void gc_mark_all_roots(gc_t *gc);
 
@@ -23,9 +23,18 @@ typedef struct pool_block {
   size_t capacity;
   size_t used;
   free_node_t *free_list;
+  uint64_t *alloc_bits;  // one bit per slot, set while the slot holds an object
+  uint64_t *mark_bits;   // sweep scratch, filled from headers and then the dead set
+  size_t bitmap_words;
+  bool needs_sweep;      // marked by the last cycle but not yet swept
   struct pool_block *next;
 } pool_block_t;
 
+typedef struct size_class size_class_t;
+
+// called before allocating from a block that still needs sweeping
+typedef void (*gc_pool_sweep_fn)(void *ctx, size_class_t *sc, pool_block_t *block);
+
 typedef struct size_class {
   size_t size;           // object size (excluding header)
   size_t slot_size;      // total slot size (header + object)
@@ -33,6 +42,8 @@ typedef struct size_class {
   size_t total_capacity;
   size_t total_used;
   size_t total_allocated;
+  gc_pool_sweep_fn sweep_fn;
+  void *sweep_ctx;
 } size_class_t;
 
 
@@ -45,6 +56,11 @@ pool_block_t* gc_pool_create_block(size_t slot_size, size_t capacity);
 void gc_pool_free_block(pool_block_t *block);
 bool gc_pool_pointer_in_block(pool_block_t *block, void *ptr);
 
+// slot occupancy, backed by the block's allocation bitmap
+size_t gc_pool_slot_index(const pool_block_t *block, const void *slot);
+bool gc_pool_slot_in_use(const pool_block_t *block, const void *slot);
+void gc_pool_set_allocated(pool_block_t *block, size_t index, bool allocated);
+
 // allocation/freeing
 void* gc_pool_alloc_from_block(pool_block_t *block, obj_type_t type, size_t size);
 void* gc_pool_alloc_from_size_class(size_class_t *sc, obj_type_t type, size_t size);
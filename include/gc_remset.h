@@ -0,0 +1,41 @@
+#ifndef GC_REMSET_H
+#define GC_REMSET_H
+
+
+#include <stddef.h>
+#include <stdbool.h>
+
+
+typedef struct gc_context gc_t;
+
+
+#define GC_REMSET_INITIAL_CAPACITY 64
+
+// remembered set: the old objects that stored a reference to a young one,
+// each kept once; open addressing with linear probing, NULL marks a free
+// entry and the table doubles at 3/4 load
+typedef struct gc_remset {
+  void **entries;
+  size_t capacity;  // power of two, 0 until the first insert
+  size_t count;
+  size_t inserts;   // calls to gc_remset_add, duplicates included
+} gc_remset_t;
+
+typedef void (*gc_remset_fn)(gc_t *gc, void *obj, void *user_data);
+
+
+void gc_remset_init(gc_remset_t *set);
+void gc_remset_destroy(gc_remset_t *set);
+
+// false only when the table could not grow; obj is not remembered then
+bool gc_remset_add(gc_remset_t *set, void *obj);
+bool gc_remset_contains(const gc_remset_t *set, const void *obj);
+void gc_remset_clear(gc_remset_t *set);
+
+void gc_remset_for_each(gc_t *gc, gc_remset_t *set, gc_remset_fn callback, void *user_data);
+
+size_t gc_remset_count(const gc_remset_t *set);
+void gc_remset_print_stats(const gc_remset_t *set);
+
+
+#endif /* GC_REMSET_H */
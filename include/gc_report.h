@@ -0,0 +1,86 @@
+#ifndef GC_REPORT_H
+#define GC_REPORT_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "gc_pool.h"
+
+
+typedef struct gc_context gc_t;
+
+
+#define GC_CYCLE_HISTORY 16
+
+
+typedef enum {
+  GC_PHASE_ROOTS = 0,    // shading explicit roots and scanning the stack
+  GC_PHASE_MARK,         // tracing (pause time only for incremental/concurrent)
+  GC_PHASE_SWEEP,        // in the pause; lazy sweeping only flags blocks here
+  GC_PHASE_COMPACT,
+  GC_PHASE_TUNE,
+  GC_PHASE_COUNT
+} gc_phase_t;
+
+typedef enum {
+  GC_TIER_POOL = 0,
+  GC_TIER_LARGE,
+  GC_TIER_HUGE,
+  GC_TIER_LEGACY,
+  GC_TIER_NURSERY,  // young objects a minor collection left behind
+  GC_TIER_COUNT
+} gc_tier_t;
+
+typedef struct gc_reclaim {
+  size_t objects;
+  size_t bytes;
+} gc_reclaim_t;
+
+typedef struct gc_cycle_report {
+  size_t cycle;                 // 1 for the first collection
+  const char *kind;             // "full", "incremental", "concurrent" or "minor"
+
+  // monotonic wall clock
+  uint64_t start_us;
+  uint64_t total_us;
+  uint64_t phase_us[GC_PHASE_COUNT];
+
+  // heap at the start and at the end of the pause
+  size_t objects_before;
+  size_t objects_after;
+  size_t bytes_before;
+  size_t bytes_after;
+
+  // reclaimed by this cycle, including blocks swept lazily after the pause
+  gc_reclaim_t reclaimed;
+  gc_reclaim_t size_class[GC_NUM_SIZE_CLASSES];
+  gc_reclaim_t tier[GC_TIER_COUNT];
+} gc_cycle_report_t;
+
+// ring of the most recent cycles
+typedef struct gc_report {
+  gc_cycle_report_t entries[GC_CYCLE_HISTORY];
+  size_t cycles;               // cycles ever recorded
+  bool in_cycle;
+} gc_report_t;
+
+
+void gc_report_init(gc_report_t *report);
+uint64_t gc_report_now_us(void);
+
+void gc_report_begin(gc_t *gc, const char *kind);
+void gc_report_phase(gc_t *gc, gc_phase_t phase, uint64_t elapsed_us);
+void gc_report_end(gc_t *gc);
+
+// credit freed objects to the latest cycle, class_index is -1 outside pools
+void gc_report_reclaim(gc_t *gc, gc_tier_t tier, int class_index, size_t objects, size_t bytes);
+
+// latest cycle, NULL before the first collection
+const gc_cycle_report_t *gc_report_last(const gc_t *gc);
+
+// copy up to max reports, newest first
+size_t gc_report_history(const gc_t *gc, gc_cycle_report_t *reports, size_t max);
+
+
+#endif /* GC_REPORT_H */
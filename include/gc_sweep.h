@@ -12,13 +12,26 @@
 typedef struct gc_context gc_t;
 
 
+#define GC_SWEEP_CACHE_LINE 64
+#define GC_SWEEP_PARALLEL_MIN_BLOCKS 4 // per worker, below this sweep serially
+
+
+void gc_sweep_pool_block(gc_t *gc, size_class_t *sc, pool_block_t *block);
 void gc_sweep_pools(gc_t *gc);
 void gc_sweep_large_blocks(gc_t *gc);
 void gc_sweep_huge_objects(gc_t *gc);
 void gc_sweep_legacy(gc_t *gc);
 void gc_sweep_all(gc_t *gc);
 
-// statistics
+// lazy sweeping: a cycle only flags pool blocks, which are then swept one at
+// a time by the allocator or by a background pass (or by the sweeper thread,
+// see gc_sweeper.h)
+void gc_sweep_lazy_init(gc_t *gc);
+void gc_sweep_lazy_begin(gc_t *gc);
+size_t gc_sweep_lazy_step(gc_t *gc, size_t max_blocks);
+void gc_sweep_finish(gc_t *gc);
+
+// statistics of the latest cycle, see gc_report.h
 size_t gc_count_swept(gc_t *gc);
 size_t gc_bytes_freed_last_sweep(gc_t *gc);
 
@@ -0,0 +1,79 @@
+#ifndef GC_SWEEPER_H
+#define GC_SWEEPER_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "gc_types.h"
+#include "gc_pool.h"
+#include "gc_large.h"
+
+
+typedef struct gc_context gc_t;
+typedef struct gc_sweeper_context gc_sweeper_t;
+
+
+// one unswept block owned by the sweeper; dead slots are chained privately
+// and only spliced into the block's free list by the mutator
+typedef struct gc_swept_block {
+  size_class_t *sc;
+  pool_block_t *block;
+  free_node_t *dead_head;
+  free_node_t *dead_tail;
+  size_t dead_count;
+  size_t dead_bytes;
+} gc_swept_block_t;
+
+typedef struct {
+  size_t cycles;
+  size_t blocks_swept;
+  size_t slots_freed;
+  size_t huge_unmapped;
+  size_t handoffs;
+} gc_sweeper_stats_t;
+
+typedef struct gc_sweeper_context {
+  pthread_t thread;
+  bool thread_running;
+  bool stop_requested;
+
+  // guards the work list, the hand-off index and the dead huge list
+  pthread_mutex_t lock;
+  pthread_cond_t work_ready;
+  pthread_cond_t work_done;
+
+  // blocks flagged by the last cycle: [0, swept) are done and wait for the
+  // mutator, [applied, swept) have not been handed back yet
+  gc_swept_block_t *work;
+  size_t work_count;
+  size_t work_capacity;
+  size_t swept;
+  size_t applied;
+
+  // huge objects unlinked by the mutator, unmapped on the sweeper thread
+  huge_object_t *dead_huge;
+  bool unmapping;
+
+  gc_sweeper_stats_t stats;
+} gc_sweeper_t;
+
+
+bool gc_sweeper_init(gc_t *gc);
+void gc_sweeper_destroy(gc_t *gc);
+bool gc_sweeper_active(const gc_t *gc);
+
+// hand the blocks flagged by gc_sweep_lazy_begin and the dead huge objects
+// to the sweeper thread
+void gc_sweeper_submit(gc_t *gc);
+
+// splice finished blocks back into their size classes, returns blocks applied
+size_t gc_sweeper_collect(gc_t *gc);
+
+// block until the sweeper has finished everything, then collect
+void gc_sweeper_wait(gc_t *gc);
+
+void gc_sweeper_get_stats(gc_t *gc, gc_sweeper_stats_t *stats);
+
+
+#endif /* GC_SWEEPER_H */
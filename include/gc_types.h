@@ -7,6 +7,14 @@
 
 typedef struct obj_header obj_header_t;
 
+// why an object must not be moved
+#define GC_PIN_EXPLICIT 0x1  // simple_gc_pin
+#define GC_PIN_STACK    0x2  // ambiguous stack word, cleared at the end of the cycle
+
+// what a minor collection did with a nursery object it reached
+#define GC_FORWARD_COPIED   1  // copied, forward holds the new data address
+#define GC_FORWARD_RETAINED 2  // left in place (pinned or not promotable)
+
 typedef enum {
   OBJ_TYPE_UNKNOWN = 0,
   OBJ_TYPE_PRIMITIVE,
@@ -18,11 +26,18 @@ typedef struct obj_header {
   obj_type_t type;
   size_t size;
   bool marked;
-  obj_header_t *next;
+  union {
+    obj_header_t *next;  // legacy objects: the gc->objects list
+    void **handle;       // pool/large/huge objects: owning handle slot or NULL
+    void *forward;       // nursery copy left behind by minor GC: new data address
+  };
 
   // generational
   unsigned char age;
   unsigned char generation;
+
+  unsigned char pinned;  // GC_PIN_* bits
+  unsigned char forwarded;  // GC_FORWARD_* during a minor collection
 } obj_header_t;
 
 
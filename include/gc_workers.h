@@ -0,0 +1,48 @@
+#ifndef GC_WORKERS_H
+#define GC_WORKERS_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+
+typedef struct gc_workers gc_workers_t;
+
+// one share of a parallel phase; worker 0 is the calling thread
+typedef void (*gc_worker_fn)(void *ctx, size_t worker);
+
+typedef struct gc_worker_arg {
+  gc_workers_t *workers;
+  size_t index;
+} gc_worker_arg_t;
+
+// fixed set of helper threads parked between collections
+typedef struct gc_workers {
+  pthread_t *threads;
+  gc_worker_arg_t *args;
+  size_t count;          // workers, including the calling thread
+
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+
+  gc_worker_fn fn;
+  void *ctx;
+  size_t round;          // bumped by every gc_workers_run
+  size_t busy;           // helpers still inside the current round
+  bool stop;
+} gc_workers_t;
+
+
+// count of 0 uses one worker per online CPU
+gc_workers_t *gc_workers_create(size_t count);
+void gc_workers_destroy(gc_workers_t *workers);
+
+// run fn on every worker and return once all of them are done
+void gc_workers_run(gc_workers_t *workers, gc_worker_fn fn, void *ctx);
+
+size_t gc_workers_default_count(void);
+
+
+#endif /* GC_WORKERS_H */
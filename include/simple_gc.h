@@ -13,6 +13,13 @@
 #include "gc_sweep.h"
 #include "gc_generation.h"
 #include "gc_barrier.h"
+#include "gc_concurrent.h"
+#include "gc_incremental.h"
+#include "gc_sweeper.h"
+#include "gc_workers.h"
+#include "gc_report.h"
+#include "gc_compact.h"
+#include "gc_handle.h"
 #include "gc_trace.h"
 #include "gc_debug.h"
 
@@ -27,8 +34,6 @@ typedef struct gc_context gc_t;
 typedef struct gc_config gc_config_t;
 typedef struct reference_node ref_node_t;
 
-typedef struct relocation_entry relocation_entry_t;
-typedef struct compaction_ctx compaction_ctx_t;
 typedef struct live_obj live_obj_t;
 
 typedef struct gc_gen_context gc_gen_t;
@@ -49,18 +54,6 @@ typedef enum {
   GC_PRESSURE_CRITICAL = 4,
 } gc_pressure_t;
 
-typedef struct relocation_entry {
-  void *old_addr;
-  void *new_addr;
-  relocation_entry_t *next;
-} relocation_entry_t;
-
-typedef struct compaction_ctx {
-  relocation_entry_t *relocations;
-  size_t relocation_count;
-  bool in_progress;
-} compaction_ctx_t;
-
 typedef struct live_obj {
     obj_header_t *header;
     void *data;
@@ -75,6 +68,21 @@ typedef struct gc_config {
   size_t expansion_trigger;
 } gc_config_t;
 
+// slot edges grouped by their source object, so simple_gc_array_copy only
+// visits the edges of dst. Open addressing, kept at most half full; rebuilt
+// from the reference list after collections move or drop edges
+typedef struct gc_slot_entry {
+  void *obj;
+  ref_node_t *edges;  // chained through slot_next
+} gc_slot_entry_t;
+
+typedef struct gc_slot_index {
+  gc_slot_entry_t *entries;
+  size_t count;
+  size_t capacity;
+  bool valid;
+} gc_slot_index_t;
+
 typedef struct gc_context {
   obj_header_t *objects; // linked-list
   size_t object_count;
@@ -84,9 +92,15 @@ typedef struct gc_context {
   size_t root_count;
   size_t root_capacity;
   ref_node_t *references;
+  gc_slot_index_t slot_index;
+  gc_mark_stack_t mark_stack;
 
   gc_gen_t *gen_context;
   gc_barrier_t *barrier_context;
+  gc_incremental_t *incremental;
+  gc_concurrent_t *concurrent;
+  gc_sweeper_t *sweeper;
+  gc_workers_t *workers;
 
   // stack scanning
   void *stack_bottom;  // highest address (architecture assumption)
@@ -104,6 +118,11 @@ typedef struct gc_context {
   huge_object_t *huge_objects;
   size_t huge_object_count;
   compaction_ctx_t compaction;
+  gc_handle_table_t *handles;  // NULL unless handles are enabled
+
+  // lazy sweeping
+  bool lazy_sweep;
+  size_t sweep_pending;  // pool blocks flagged by the last cycle, not yet swept
 
   // memory pressure
   gc_config_t config;
@@ -121,18 +140,38 @@ typedef struct gc_context {
   size_t total_bytes_freed;
   size_t total_compactions;
   size_t bytes_reclaimed;
+  gc_report_t report;
 
   // trace/debug
   gc_trace_t *trace;
   gc_debug_t *debug;
 } gc_t;
 
+// edges recorded by simple_gc_array_copy know the slot of from_obj holding
+// to_obj, moving collectors write the new address back into it
+#define GC_REF_NO_SLOT SIZE_MAX
+
 typedef struct reference_node {
   void *from_obj;
   void *to_obj;
+  size_t slot;  // index into from_obj as an array of pointers, or GC_REF_NO_SLOT
   struct reference_node *next;
+  struct reference_node **pprev;      // the link pointing at this node
+  struct reference_node *slot_next;   // next slot edge of from_obj, see gc_slot_index_t
 } ref_node_t;
 
+static inline void gc_ref_link(gc_t *gc, ref_node_t *ref) {
+  ref->next = gc->references;
+  ref->pprev = &gc->references;
+  if (gc->references) gc->references->pprev = &ref->next;
+  gc->references = ref;
+}
+
+static inline void gc_ref_unlink(ref_node_t *ref) {
+  *ref->pprev = ref->next;
+  if (ref->next) ref->next->pprev = ref->pprev;
+}
+
 typedef struct gc_stats {
   size_t object_count;
   size_t heap_used;
@@ -189,6 +228,45 @@ static inline void simple_gc_sweep(gc_t *gc) {
 }
 void simple_gc_collect(gc_t *gc);
 
+// incremental collection (not available together with generations)
+bool simple_gc_enable_incremental(gc_t *gc);
+void simple_gc_disable_incremental(gc_t *gc);
+bool simple_gc_is_incremental(gc_t *gc);
+bool simple_gc_collect_step(gc_t *gc, size_t budget_us);
+
+// concurrent snapshot-at-the-beginning marking (not available together with
+// generations or incremental mode). Any mutator thread may start or finish a
+// cycle; the final remark and the sweep stop every other mutator
+bool simple_gc_enable_concurrent(gc_t *gc);
+void simple_gc_disable_concurrent(gc_t *gc);
+bool simple_gc_is_concurrent(gc_t *gc);
+bool simple_gc_collect_concurrent_start(gc_t *gc);
+bool simple_gc_concurrent_mark_done(gc_t *gc);
+void simple_gc_collect_concurrent_finish(gc_t *gc);
+
+// lazy sweeping: collections only mark, pool blocks are swept on demand by
+// the allocator or by simple_gc_sweep_step (not available with generations)
+bool simple_gc_enable_lazy_sweep(gc_t *gc);
+void simple_gc_disable_lazy_sweep(gc_t *gc);
+bool simple_gc_is_lazy_sweep(gc_t *gc);
+size_t simple_gc_sweep_step(gc_t *gc, size_t max_blocks);
+
+// background sweeper thread: implies lazy sweeping, unswept blocks and dead
+// huge objects are handed to the thread after each cycle
+bool simple_gc_enable_background_sweep(gc_t *gc);
+void simple_gc_disable_background_sweep(gc_t *gc);
+bool simple_gc_is_background_sweep(gc_t *gc);
+
+// parallel stop-the-world sweep, threads = 0 uses one worker per CPU
+bool simple_gc_enable_parallel_sweep(gc_t *gc, size_t threads);
+void simple_gc_disable_parallel_sweep(gc_t *gc);
+bool simple_gc_is_parallel_sweep(gc_t *gc);
+
+// per-cycle reports: phase timings and what each cycle reclaimed; history is
+// copied newest first, at most GC_CYCLE_HISTORY cycles are kept
+bool simple_gc_last_cycle(gc_t *gc, gc_cycle_report_t *report);
+size_t simple_gc_cycle_history(gc_t *gc, gc_cycle_report_t *reports, size_t max);
+
 // ref counting
 bool simple_gc_add_reference(gc_t *gc, void *from_ptr, void *to_ptr);
 bool simple_gc_remove_reference(gc_t *gc, void *from_ptr, void *to_ptr);
@@ -202,8 +280,38 @@ void simple_gc_scan_stack(gc_t* gc);
 bool simple_gc_auto_init_stack(gc_t *gc);
 
 // compaction
+// an explicit compaction is skipped while a concurrent cycle is marking,
+// the cycle compacts when it finishes
 bool simple_gc_should_compact(gc_t *gc);
 void simple_gc_compact(gc_t *gc);
+void simple_gc_set_compaction_mode(gc_t *gc, gc_compact_mode_t mode);
+
+// pinned objects are never moved by compaction or a minor collection;
+// objects found by the conservative stack scan are pinned for the rest of
+// the cycle. A pinned young object keeps the nursery from being emptied,
+// later minor collections tenure around it until it is unpinned
+bool simple_gc_pin(gc_t *gc, void *ptr);
+bool simple_gc_unpin(gc_t *gc, void *ptr);
+bool simple_gc_is_pinned(gc_t *gc, void *ptr);
+
+// handle indirection (pool mode only): a handle keeps its object alive and
+// always reads back the current address through *handle, so moving the
+// object updates one slot instead of every root and reference
+bool simple_gc_enable_handles(gc_t *gc);
+void simple_gc_disable_handles(gc_t *gc);
+bool simple_gc_is_handles(gc_t *gc);
+gc_handle_t simple_gc_alloc_handle(gc_t *gc, obj_type_t type, size_t size);
+bool simple_gc_realloc_handle(gc_t *gc, gc_handle_t handle, size_t size);
+void simple_gc_release_handle(gc_t *gc, gc_handle_t handle);
+size_t simple_gc_handle_count(gc_t *gc);
+void simple_gc_set_evacuation_budget(gc_t *gc, size_t bytes);
+
+// the large tier is left alone by default, its dead blocks are reused by
+// later allocations; once enabled every compaction frees them and packs the
+// surviving large objects into one arena
+void simple_gc_set_large_compaction(gc_t *gc, bool enable);
+void simple_gc_compact_large(gc_t *gc);
+void simple_gc_fragmentation_histogram(gc_t *gc, gc_frag_histogram_t *histogram);
 
 // memory pressure
 gc_pressure_t simple_gc_check_pressure(gc_t *gc);
@@ -222,6 +330,11 @@ void simple_gc_print_gen_stats(gc_t *gc);
 bool simple_gc_enable_write_barrier(gc_t *gc);
 void simple_gc_disable_write_barrier(gc_t *gc);
 void simple_gc_write(gc_t *gc, void *from, void *to);
+// memmove of count references into dst[dst_offset, dst_offset + count),
+// barriered as one range; false if dst has no room for them. Young targets
+// become edges from dst that replace those of the overwritten slots, so minor
+// collections keep them alive and rewrite the slots when they move
+bool simple_gc_array_copy(gc_t *gc, void *dst, size_t dst_offset, const void *src, size_t count);
 void simple_gc_print_barrier_stats(gc_t *gc);
 
 // stats
@@ -2,6 +2,8 @@
 #include "simple_gc.h"
 #include "gc_generation.h"
 #include "gc_cardtable.h"
+#include "gc_concurrent.h"
+#include "gc_incremental.h"
 #include "gc_trace.h"
 #include <stdlib.h>
 #include <string.h>
@@ -19,6 +21,10 @@ bool gc_barrier_init(gc_t *gc, gc_barrier_type_t type) {
   memset(&barrier->stats, 0, sizeof(gc_barrier_stats_t));
 
   gc->barrier_context = barrier;
+  gc_barrier_update_filter(gc);
+
+  // stores made without a barrier were never carded
+  if (gc->gen_context) gc->gen_context->remembered = false;
   return true;
 }
 
@@ -27,6 +33,58 @@ void gc_barrier_destroy(gc_t *gc) {
 
   free(gc->barrier_context);
   gc->barrier_context = NULL;
+
+  if (gc->gen_context) gc->gen_context->remembered = false;
+}
+
+// marking barriers have to see every store, so the filter only applies when
+// neither marker is set up and nobody is counting
+void gc_barrier_update_filter(gc_t *gc) {
+  if (!gc || !gc->barrier_context) return;
+
+  gc_barrier_t *barrier = gc->barrier_context;
+  gc_gen_t *gen = gc->gen_context;
+
+  barrier->filtered = !barrier->stats_enabled && !gc->incremental && !gc->concurrent;
+  barrier->young_start = gen ? (uintptr_t) gen->nursery_start : 0;
+  barrier->young_size = gen ? (size_t)(gen->nursery_end - gen->nursery_start) : 0;
+}
+
+void gc_barrier_set_stats(gc_t *gc, bool enabled) {
+  if (!gc || !gc->barrier_context) return;
+
+  gc->barrier_context->stats_enabled = enabled;
+  gc_barrier_update_filter(gc);
+}
+
+static void gc_barrier_trace_old_to_young(gc_t *gc, void *from_obj) {
+  if (!gc->trace) return;
+
+  gc_trace_event_t event = {
+    .type = GC_EVENT_PROMOTION,
+    .data.promotion = {from_obj, GC_GEN_OLD, GC_GEN_YOUNG},
+  };
+  gc_trace_event(gc, &event);
+}
+
+// reached from the fast path; with the filter on the store is already
+// known to go from outside the nursery into it
+void gc_barrier_write_slow(gc_t *gc, void *from_obj, void *to_obj) {
+  if (!gc || !from_obj || !to_obj) return;
+
+  gc_barrier_t *barrier = gc->barrier_context;
+  if (!barrier || !barrier->enabled) return;
+
+  if (!barrier->filtered) {
+    gc_barrier_write(gc, from_obj, to_obj);
+    return;
+  }
+
+  if (barrier->type == GC_BARRIER_CARD_MARKING || barrier->type == GC_BARRIER_REMSET) {
+    gc_gen_remember(gc, from_obj);
+  }
+
+  gc_barrier_trace_old_to_young(gc, from_obj);
 }
 
 void gc_barrier_write(gc_t *gc, void *from_obj, void *to_obj) {
@@ -35,59 +93,109 @@ void gc_barrier_write(gc_t *gc, void *from_obj, void *to_obj) {
   gc_barrier_t *barrier = gc->barrier_context;
   if (!barrier || !barrier->enabled) return;
 
-  barrier->stats.total_writes++;
+  if (barrier->stats_enabled) barrier->stats.total_writes++;
+
+  // snapshot barrier: the stored target may only be held in an unscanned C
+  // local, so log it alongside deleted references
+  if (gc_concurrent_marking(gc)) {
+    gc_concurrent_satb_log(gc, to_obj);
+  }
 
   obj_header_t *from_header = simple_gc_find_header(gc, from_obj);
   obj_header_t *to_header = simple_gc_find_header(gc, to_obj);
   if (!from_header || !to_header) return;
 
-  // track cross-gen references
-  if (from_header->generation != to_header->generation) {
-    barrier->stats.barrier_hits++;
+  // Dijkstra insertion barrier: a marked (gray or black) source must never
+  // point to a white target between incremental steps
+  if (gc_incremental_marking(gc) && from_header->marked && !to_header->marked) {
+    gc_incremental_shade(gc, to_obj);
+    gc->incremental->stats.barrier_shades++;
+  }
+
+  // track cross-gen references, young means inside the nursery
+  gc_gen_t *gen = gc->gen_context;
+  bool from_young = gen && gc_gen_in_nursery(gen, from_obj);
+  bool to_young = gen && gc_gen_in_nursery(gen, to_obj);
+
+  bool counting = barrier->stats_enabled;
+
+  if (from_young != to_young) {
+    if (counting) barrier->stats.barrier_hits++;
 
     // track old->young references for minor GC
-    if (from_header->generation == GC_GEN_OLD && to_header->generation == GC_GEN_YOUNG) {
-      barrier->stats.old_to_young++;
-
-      if (barrier->type == GC_BARRIER_CARD_MARKING && gc->gen_context) {
-        gc_gen_t *gen = gc->gen_context;
-
-        // lazily initialize card table when we have heap bounds
-        if (!gen->cardtable.enabled && gc->heap_start && gc->heap_end) {
-          size_t heap_size = (char*)gc->heap_end - (char*)gc->heap_start;
-          if (gc_cardtable_init(&gen->cardtable, gc->heap_start, heap_size)) {
-            gen->cardtable.enabled = true;
-          }
-        }
-        if (gen->cardtable.enabled) {
-          gc_cardtable_mark_dirty(&gen->cardtable, from_obj);
-        }
-      }
+    if (to_young) {
+      if (counting) barrier->stats.old_to_young++;
 
-      if (gc->trace) {
-        gc_trace_event_t event = {
-          .type = GC_EVENT_PROMOTION,
-          .data.promotion = {from_obj, from_header->generation, to_header->generation},
-        };
-        gc_trace_event(gc, &event);
+      if (barrier->type == GC_BARRIER_CARD_MARKING || barrier->type == GC_BARRIER_REMSET) {
+        gc_gen_remember(gc, from_obj);
       }
-    } else if (from_header->generation == GC_GEN_YOUNG && to_header->generation == GC_GEN_OLD) {
-      // track old->young references
-      barrier->stats.young_to_old++;
+
+      gc_barrier_trace_old_to_young(gc, from_obj);
+    } else {
+      // track young->old references
+      if (counting) barrier->stats.young_to_old++;
     }
-  } else {
+  } else if (counting) {
     barrier->stats.same_generation++;
   }
 }
 
+void gc_barrier_delete(gc_t *gc, void *from_obj, void *to_obj) {
+  if (!gc || !from_obj || !to_obj) return;
+
+  gc_barrier_t *barrier = gc->barrier_context;
+  if (!barrier || !barrier->enabled) return;
+
+  // snapshot-at-the-beginning: whatever was reachable when marking started
+  // stays reachable, so the overwritten target must be traced
+  if (gc_concurrent_marking(gc)) {
+    gc_concurrent_satb_log(gc, to_obj);
+  }
+}
+
 void gc_barrier_array_write(gc_t *gc, void *array, size_t index, void *value) {
   if (!gc || !array || !value) return;
 
-  gc_barrier_write(gc, array, value);
+  gc_barrier_write_fast(gc, gc->barrier_context, array, value);
   void **arr = (void*) array;
   arr[index] = value;
 }
 
+void gc_barrier_range_write(gc_t *gc, void *array, size_t start, size_t count) {
+  if (!gc || !array || count == 0) return;
+
+  gc_barrier_t *barrier = gc->barrier_context;
+  if (!barrier || !barrier->enabled) return;
+
+  void **slots = (void**) array + start;
+  if (!barrier->filtered) {
+    for (size_t i = 0; i < count; ++i) {
+      gc_barrier_write(gc, array, slots[i]);
+    }
+    return;
+  }
+
+  // a young array is copied whole by the next minor collection
+  uintptr_t young_start = barrier->young_start;
+  size_t young_size = barrier->young_size;
+  if ((uintptr_t) array - young_start < young_size) return;
+
+  size_t first = count;
+  size_t last = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if ((uintptr_t) slots[i] - young_start < young_size) {
+      if (first == count) first = i;
+      last = i;
+    }
+  }
+  if (first == count) return;
+
+  if (barrier->type == GC_BARRIER_CARD_MARKING || barrier->type == GC_BARRIER_REMSET) {
+    gc_gen_remember_range(gc, array, slots + first, (last - first + 1) * sizeof(void*));
+  }
+  gc_barrier_trace_old_to_young(gc, array);
+}
+
 void gc_barrier_get_stats(gc_t *gc, gc_barrier_stats_t *stats) {
   if (!gc || !gc->barrier_context || !stats) return;
 
@@ -0,0 +1,15 @@
+#include "gc_bitmap.h"
+
+
+// a 4 KiB block holds at most a couple of bitmap words, plain word ops are
+// all the sweep needs
+size_t gc_bitmap_sweep(uint64_t *alloc, uint64_t *mark, size_t words) {
+  size_t dead_count = 0;
+  for (size_t i = 0; i < words; ++i) {
+    uint64_t dead = alloc[i] & ~mark[i];
+    alloc[i] &= mark[i];
+    mark[i] = dead;
+    dead_count += gc_bitmap_popcount(dead);
+  }
+  return dead_count;
+}
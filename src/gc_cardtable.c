@@ -1,114 +1,410 @@
 #include "gc_cardtable.h"
 #include "simple_gc.h"
+#include "gc_bitmap.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <sys/mman.h>
 
+#if defined(__SSE2__)
+#define GC_CARDTABLE_SSE2 1
+#include <emmintrin.h>
+#endif
 
-bool gc_cardtable_init(gc_cardtable_t *table, void *heap_start, size_t heap_size) {
-  if (!table || !heap_start || heap_size == 0) return false;
 
-  size_t num_cards = (heap_size + GC_CARD_SIZE - 1) >> GC_CARD_SHIFT;
+#define GC_CARD_REGION_MASK ((size_t) GC_CARD_REGION_CARDS - 1)
+
+
+// first committed region whose first card is not below first_card
+static size_t gc_cardtable_region_index(const gc_cardtable_t *table, size_t first_card) {
+  size_t lo = 0;
+  size_t hi = table->region_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (table->regions[mid]->first_card < first_card) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+static gc_card_region_t *gc_cardtable_find_region(gc_cardtable_t *table, size_t card) {
+  size_t first_card = card & ~GC_CARD_REGION_MASK;
+  if (table->last && table->last->first_card == first_card) return table->last;
+
+  size_t i = gc_cardtable_region_index(table, first_card);
+  if (i == table->region_count || table->regions[i]->first_card != first_card) return NULL;
+
+  table->last = table->regions[i];
+  return table->last;
+}
+
+// the region holding card, mapped on first use; its pages are only backed
+// once touched, so a region that never records objects leaves starts unbacked
+static gc_card_region_t *gc_cardtable_commit_region(gc_cardtable_t *table, size_t card) {
+  gc_card_region_t *region = gc_cardtable_find_region(table, card);
+  if (region) return region;
+
+  if (table->region_count == table->region_capacity) {
+    size_t capacity = table->region_capacity ? table->region_capacity * 2 : 8;
+    gc_card_region_t **regions = (gc_card_region_t**) realloc(table->regions,
+        capacity * sizeof(gc_card_region_t*));
+    if (!regions) return NULL;
+    table->regions = regions;
+    table->region_capacity = capacity;
+  }
+
+  void *memory = mmap(NULL, sizeof(gc_card_region_t),
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1, 0);
+  if (memory == MAP_FAILED) return NULL;
+
+  region = (gc_card_region_t*) memory;
+  region->first_card = card & ~GC_CARD_REGION_MASK;
 
-  table->cards = (uint8_t*) calloc(num_cards, sizeof(uint8_t));
-  if (!table->cards) return false;
+  size_t i = gc_cardtable_region_index(table, region->first_card);
+  memmove(&table->regions[i + 1], &table->regions[i],
+      (table->region_count - i) * sizeof(gc_card_region_t*));
+  table->regions[i] = region;
+  table->region_count++;
+  table->num_cards += GC_CARD_REGION_CARDS;
+  table->last = region;
+  return region;
+}
+
+bool gc_cardtable_init(gc_cardtable_t *table, void *heap_start, size_t heap_size) {
+  if (!table || !heap_start) return false;
 
-  table->num_cards = num_cards;
   table->heap_start = heap_start;
-  table->heap_end = (void*)((char*) heap_start + heap_size);
+  table->regions = NULL;
+  table->region_count = 0;
+  table->region_capacity = 0;
+  table->last = NULL;
+  table->num_cards = 0;
   table->dirty_count = 0;
   table->enabled = true;
 
+  size_t num_cards = (heap_size + GC_CARD_SIZE - 1) >> GC_CARD_SHIFT;
+  for (size_t c = 0; c < num_cards; c += GC_CARD_REGION_CARDS) {
+    if (!gc_cardtable_commit_region(table, c)) {
+      gc_cardtable_destroy(table);
+      return false;
+    }
+  }
+
   return true;
 }
 
 void gc_cardtable_destroy(gc_cardtable_t *table) {
   if (!table) return;
 
-  free(table->cards);
-  table->cards = NULL;
+  for (size_t i = 0; i < table->region_count; ++i) {
+    munmap(table->regions[i], sizeof(gc_card_region_t));
+  }
+  free(table->regions);
+  table->regions = NULL;
+  table->region_count = 0;
+  table->region_capacity = 0;
+  table->last = NULL;
   table->num_cards = 0;
+  table->dirty_count = 0;
   table->enabled = false;
 }
 
 size_t gc_cardtable_addr_to_card(gc_cardtable_t *table, void *addr) {
   if (!table || !addr) return 0;
-  if (addr < table->heap_start || addr >= table->heap_end) return 0;
 
-  ptrdiff_t offset = (char*)addr - (char*)table->heap_start;
+  uintptr_t offset = (uintptr_t) addr - (uintptr_t) table->heap_start;
   return (size_t)(offset >> GC_CARD_SHIFT);
 }
 
 void *gc_cardtable_card_to_addr(gc_cardtable_t *table, size_t card_index) {
-  if (!table || card_index >= table->num_cards) return NULL;
+  if (!table) return NULL;
+
+  uintptr_t offset = (uintptr_t) card_index << GC_CARD_SHIFT;
+  return (void*)((uintptr_t) table->heap_start + offset);
+}
 
-  size_t offset = card_index << GC_CARD_SHIFT;
-  return ((void*) ((char*)table->heap_start + offset));
+static void gc_cardtable_dirty_card(gc_cardtable_t *table, gc_card_region_t *region, size_t card) {
+  size_t k = card - region->first_card;
+  if (region->cards[k] == GC_CARD_CLEAN) {
+    table->dirty_count++;
+  }
+  region->cards[k] = GC_CARD_DIRTY;
+  region->summary |= (uint64_t) 1 << (k >> GC_CARD_CHUNK_SHIFT);
 }
 
-void gc_cardtable_mark_dirty(gc_cardtable_t *table, void *addr) {
-  if (!table || !table->enabled || !addr) return;
+bool gc_cardtable_mark_dirty(gc_cardtable_t *table, void *addr) {
+  if (!table || !table->enabled || !addr) return false;
 
   size_t c = gc_cardtable_addr_to_card(table, addr);
-  if (c < table->num_cards) {
-    if (table->cards[c] == GC_CARD_CLEAN) {
-      table->dirty_count++;
-    }
-    table->cards[c] = GC_CARD_DIRTY;
-  }
+  gc_card_region_t *region = gc_cardtable_commit_region(table, c);
+  if (!region) return false;
+
+  gc_cardtable_dirty_card(table, region, c);
+  return true;
 }
 
-void gc_cardtable_mark_range_dirty(gc_cardtable_t *table, void *start, size_t size) {
-  if (!table || !table->enabled || !start || size == 0) return;
+bool gc_cardtable_mark_range_dirty(gc_cardtable_t *table, void *start, size_t size) {
+  if (!table || !table->enabled || !start || size == 0) return false;
 
   size_t start_card = gc_cardtable_addr_to_card(table, start);
   void *end = (void*)((char*)start + size - 1);
   size_t end_card = gc_cardtable_addr_to_card(table, end);
 
-  for (size_t i = start_card; i <= end_card && i < table->num_cards ; ++i) {
-    if (table->cards[i] == GC_CARD_CLEAN) {
-      table->dirty_count++;
+  gc_card_region_t *region = NULL;
+  for (size_t i = start_card; i <= end_card; ++i) {
+    if (!region || (i & GC_CARD_REGION_MASK) == 0) {
+      region = gc_cardtable_commit_region(table, i);
+      if (!region) return false;
     }
-    table->cards[i] = GC_CARD_DIRTY;
+    gc_cardtable_dirty_card(table, region, i);
   }
+  return true;
 }
 
 bool gc_cardtable_is_dirty(gc_cardtable_t *table, void *addr) {
   if (!table || !addr) return false;
 
   size_t c = gc_cardtable_addr_to_card(table, addr);
-  if (c >= table->num_cards) return false;
+  gc_card_region_t *region = gc_cardtable_find_region(table, c);
+  if (!region) return false;
 
-  return (table->cards[c] == GC_CARD_DIRTY);
+  return (region->cards[c - region->first_card] == GC_CARD_DIRTY);
 }
 
 void gc_cardtable_clear(gc_cardtable_t *table) {
-  if (!table || !table->cards) return;
+  if (!table) return;
 
-  memset(table->cards, GC_CARD_CLEAN, table->num_cards);
+  for (size_t i = 0; i < table->region_count; ++i) {
+    gc_card_region_t *region = table->regions[i];
+    if (region->summary) {
+      memset(region->cards, GC_CARD_CLEAN, GC_CARD_REGION_CARDS);
+      region->summary = 0;
+    }
+  }
   table->dirty_count = 0;
 }
 
+// the chunk's summary bit stays, the next scan drops it when nothing is left
 void gc_cardtable_clear_card(gc_cardtable_t *table, size_t card_index) {
-  if (!table || card_index >= table->num_cards) return;
+  if (!table) return;
+
+  gc_card_region_t *region = gc_cardtable_find_region(table, card_index);
+  if (!region) return;
 
-  if (table->cards[card_index] == GC_CARD_DIRTY) {
+  size_t k = card_index - region->first_card;
+  if (region->cards[k] == GC_CARD_DIRTY) {
     table->dirty_count--;
   }
-  table->cards[card_index] = GC_CARD_CLEAN;
+  region->cards[k] = GC_CARD_CLEAN;
+}
+
+// first dirty card at or after c, num_cards when there is none; clean runs
+// are skipped 16 cards per compare with SSE2, 8 per word load otherwise
+static size_t gc_cardtable_next_dirty(const uint8_t *cards, size_t c, size_t num_cards) {
+#ifdef GC_CARDTABLE_SSE2
+  const __m128i clean = _mm_setzero_si128();
+  while (c + 16 <= num_cards) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(cards + c));
+    unsigned dirty = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v, clean)) ^ 0xFFFFu;
+    if (dirty) return c + gc_bitmap_ctz(dirty);
+    c += 16;
+  }
+#endif
+  while (c + sizeof(uint64_t) <= num_cards) {
+    uint64_t word;
+    memcpy(&word, cards + c, sizeof(word));
+    if (word) break;
+    c += sizeof(uint64_t);
+  }
+  while (c < num_cards && cards[c] == GC_CARD_CLEAN) ++c;
+  return c;
+}
+
+// first clean card at or after c, num_cards when the run reaches the end
+static size_t gc_cardtable_next_clean(const uint8_t *cards, size_t c, size_t num_cards) {
+  const uint64_t all_dirty = UINT64_C(0x0101010101010101) * GC_CARD_DIRTY;
+  while (c + sizeof(uint64_t) <= num_cards) {
+    uint64_t word;
+    memcpy(&word, cards + c, sizeof(word));
+    if (word != all_dirty) break;
+    c += sizeof(uint64_t);
+  }
+  while (c < num_cards && cards[c] == GC_CARD_DIRTY) ++c;
+  return c;
+}
+
+// visits the dirty cards in [c, end) of a region; a run of dirty cards is
+// cleared with one memset once all of its cards have been visited
+static void gc_cardtable_scan_range(gc_t *gc, gc_cardtable_t *table, gc_card_region_t *region,
+    size_t c, size_t end, gc_card_scan_fn callback, void *user_data) {
+  while ((c = gc_cardtable_next_dirty(region->cards, c, end)) < end) {
+    size_t run_end = gc_cardtable_next_clean(region->cards, c, end);
+
+    for (size_t i = c; i < run_end; ++i) {
+      void *start = gc_cardtable_card_to_addr(table, region->first_card + i);
+      void *card_end = (void*)((char*) start + GC_CARD_SIZE);
+      callback(gc, start, card_end, user_data);
+    }
+
+    size_t run = run_end - c;
+    memset(region->cards + c, GC_CARD_CLEAN, run);
+    table->dirty_count = table->dirty_count > run ? table->dirty_count - run : 0;
+    c = run_end;
+  }
 }
 
+// visits each dirty card in card order, region by region, descending only
+// into chunks the region's summary flags; a clean region costs one word test
 void gc_cardtable_scan_dirty(gc_t *gc, gc_cardtable_t *table, gc_card_scan_fn callback, void *user_data) {
   if (!gc || !table || !callback) return;
 
-  for (size_t c = 0; c < table->num_cards; ++c) {
-    if (table->cards[c] == GC_CARD_DIRTY) {
-      void *start = gc_cardtable_card_to_addr(table, c);
-      void *end = (void*)((char*) start + GC_CARD_SIZE);
-      callback(gc, start, end, user_data);
-      gc_cardtable_clear_card(table, c);
+  size_t i = 0;
+  while (i < table->region_count) {
+    gc_card_region_t *region = table->regions[i];
+
+    // reread the summary, a callback may dirty a later chunk
+    unsigned from = 0;
+    uint64_t bits;
+    while (from < GC_BITMAP_WORD_BITS &&
+        (bits = region->summary & (~(uint64_t) 0 << from)) != 0) {
+      unsigned bit = gc_bitmap_ctz(bits);
+      region->summary &= ~((uint64_t) 1 << bit);
+
+      size_t first = (size_t) bit << GC_CARD_CHUNK_SHIFT;
+      gc_cardtable_scan_range(gc, table, region, first, first + GC_CARD_CHUNK_CARDS,
+          callback, user_data);
+      from = bit + 1;
+    }
+
+    // a callback may commit regions, which shifts the array
+    i = gc_cardtable_region_index(table, region->first_card) + 1;
+  }
+}
+
+static bool gc_cardtable_granule(gc_cardtable_t *table, void *header, size_t *card, unsigned *bit) {
+  uintptr_t offset = (uintptr_t) header - (uintptr_t) table->heap_start;
+  if (offset % GC_CARD_GRANULE != 0) return false;
+
+  *card = (size_t)(offset >> GC_CARD_SHIFT);
+  *bit = (unsigned)((offset & (GC_CARD_SIZE - 1)) / GC_CARD_GRANULE);
+  return true;
+}
+
+// note where an object of bytes (header included) starts and which cards it
+// reaches into; starts left inside it by objects that used to live there are
+// dropped, so the last start before a card is always the one covering it
+bool gc_cardtable_record_object(gc_cardtable_t *table, void *header, size_t bytes) {
+  if (!table || !table->enabled || !header || bytes == 0) return false;
+
+  size_t card;
+  unsigned bit;
+  if (!gc_cardtable_granule(table, header, &card, &bit)) return false;
+
+  gc_card_region_t *region = gc_cardtable_commit_region(table, card);
+  if (!region) return false;
+
+  uintptr_t offset = (uintptr_t) header - (uintptr_t) table->heap_start;
+  uintptr_t end = offset + bytes;  // first byte past the object
+  size_t last = (size_t)((end - 1) >> GC_CARD_SHIFT);
+  size_t end_bit = (size_t)(((end - 1) & (GC_CARD_SIZE - 1)) / GC_CARD_GRANULE + 1);
+
+  size_t k = card - region->first_card;
+  uint64_t covered = ~(uint64_t) 0 << bit;
+  if (last == card && end_bit < 64) {
+    covered &= ((uint64_t) 1 << end_bit) - 1;
+  }
+  region->starts[k] = (region->starts[k] & ~covered) | ((uint64_t) 1 << bit);
+  if (bit == 0) region->crossing[k] = 0;
+
+  for (size_t c = card + 1; c <= last; ++c) {
+    if ((c & GC_CARD_REGION_MASK) == 0) {
+      region = gc_cardtable_commit_region(table, c);
+      if (!region) return false;
+    }
+    k = c - region->first_card;
+
+    size_t back = c - card;
+    region->crossing[k] = (uint8_t)(back < GC_CROSSING_MAX ? back : GC_CROSSING_MAX);
+
+    if (c < last) {
+      region->starts[k] = 0;
+    } else if (end_bit < 64) {
+      region->starts[k] &= ~(((uint64_t) 1 << end_bit) - 1);
+    } else {
+      region->starts[k] = 0;
     }
   }
+  return true;
+}
+
+bool gc_cardtable_has_object(gc_cardtable_t *table, void *header) {
+  if (!table || !header) return false;
+
+  size_t card;
+  unsigned bit;
+  if (!gc_cardtable_granule(table, header, &card, &bit)) return false;
+
+  gc_card_region_t *region = gc_cardtable_find_region(table, card);
+  if (!region) return false;
+  return (region->starts[card - region->first_card] >> bit) & 1;
+}
+
+void gc_cardtable_forget_objects(gc_cardtable_t *table) {
+  if (!table) return;
+
+  for (size_t i = 0; i < table->region_count; ++i) {
+    memset(table->regions[i]->starts, 0, sizeof(table->regions[i]->starts));
+    memset(table->regions[i]->crossing, 0, sizeof(table->regions[i]->crossing));
+  }
+}
+
+// header of the object reaching into card from an earlier one, NULL if none
+static void *gc_cardtable_covering_object(gc_cardtable_t *table, gc_card_region_t *region, size_t card) {
+  uint8_t back = region->crossing[card - region->first_card];
+  if (!back) return NULL;
+
+  size_t from = card;
+  while (back == GC_CROSSING_MAX) {
+    from -= GC_CROSSING_MAX - 1;
+    region = gc_cardtable_find_region(table, from);
+    if (!region) return NULL;
+    back = region->crossing[from - region->first_card];
+  }
+  from -= back;
+
+  region = gc_cardtable_find_region(table, from);
+  if (!region) return NULL;
+
+  // the covering object is the last one starting in its card
+  uint64_t bits = region->starts[from - region->first_card];
+  if (!bits) return NULL;
+
+  unsigned bit = 63 - gc_bitmap_clz(bits);
+  return (char*) gc_cardtable_card_to_addr(table, from) + bit * GC_CARD_GRANULE;
+}
+
+// visit every recorded object overlapping the card: the one reaching in from
+// an earlier card, found through the crossing map, then those starting here
+void gc_cardtable_for_each_object(gc_t *gc, gc_cardtable_t *table, void *card_start,
+    gc_card_object_fn callback, void *user_data) {
+  if (!table || !card_start || !callback) return;
+
+  size_t card = gc_cardtable_addr_to_card(table, card_start);
+  gc_card_region_t *region = gc_cardtable_find_region(table, card);
+  if (!region) return;
+
+  void *covering = gc_cardtable_covering_object(table, region, card);
+  if (covering) callback(gc, covering, user_data);
+
+  char *base = (char*) gc_cardtable_card_to_addr(table, card);
+  uint64_t bits = region->starts[card - region->first_card];
+  while (bits) {
+    unsigned bit = gc_bitmap_ctz(bits);
+    bits &= bits - 1;
+    callback(gc, base + bit * GC_CARD_GRANULE, user_data);
+  }
 }
 
 size_t gc_cardtable_dirty_count(gc_cardtable_t *table) {
@@ -128,6 +424,7 @@ void gc_cardtable_print_stats(gc_cardtable_t *table) {
   printf("Dirty cards:   %zu\n", table->dirty_count);
   printf("Dirty ratio:   %.2f%%\n", gc_cardtable_dirty_ratio(table) * 100.0f);
   printf("Card size:     %d bytes\n", GC_CARD_SIZE);
-  printf("Heap tracked:  %zu bytes\n", (size_t)((char *)table->heap_end - (char *)table->heap_start));
+  printf("Regions:       %zu\n", table->region_count);
+  printf("Heap tracked:  %zu bytes\n", table->num_cards * (size_t) GC_CARD_SIZE);
   printf("=============================\n\n");
 }
@@ -0,0 +1,980 @@
+#include "gc_compact.h"
+#include "simple_gc.h"
+#include "gc_bitmap.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+void gc_compact_init(compaction_ctx_t *ctx) {
+  if (!ctx) return;
+
+  memset(ctx, 0, sizeof(compaction_ctx_t));
+  ctx->mode = GC_COMPACT_SLIDE;
+  ctx->evacuate_budget = GC_EVACUATE_DEFAULT_BUDGET;
+}
+
+void gc_compact_destroy(compaction_ctx_t *ctx) {
+  if (!ctx) return;
+
+  gc_compact_clear_relocations(ctx);
+  free(ctx->stack_pins);
+  ctx->stack_pins = NULL;
+  ctx->stack_pin_count = 0;
+  ctx->stack_pin_capacity = 0;
+}
+
+// the header stays valid until the end of the cycle: anything found on the
+// stack was marked and survives the sweep
+bool gc_compact_pin_stack(compaction_ctx_t *ctx, obj_header_t *header) {
+  if (!ctx || !header) return false;
+  if (header->pinned & GC_PIN_STACK) return true;
+
+  if (ctx->stack_pin_count == ctx->stack_pin_capacity) {
+    size_t capacity = ctx->stack_pin_capacity ? ctx->stack_pin_capacity * 2 : 64;
+    obj_header_t **pins = (obj_header_t**) realloc(ctx->stack_pins, sizeof(obj_header_t*) * capacity);
+    if (!pins) {
+      ctx->pins_incomplete = true;
+      return false;
+    }
+    ctx->stack_pins = pins;
+    ctx->stack_pin_capacity = capacity;
+  }
+
+  header->pinned |= GC_PIN_STACK;
+  ctx->stack_pins[ctx->stack_pin_count++] = header;
+  return true;
+}
+
+void gc_compact_unpin_stack(compaction_ctx_t *ctx) {
+  if (!ctx) return;
+
+  for (size_t i = 0; i < ctx->stack_pin_count; ++i) {
+    ctx->stack_pins[i]->pinned &= (unsigned char) ~GC_PIN_STACK;
+  }
+  ctx->stack_pin_count = 0;
+  ctx->pins_incomplete = false;
+}
+
+bool gc_compact_can_move(const compaction_ctx_t *ctx) {
+  return (ctx && !ctx->pins_incomplete);
+}
+
+// keep the table at most half full so probe sequences stay short
+bool gc_compact_relocations_init(compaction_ctx_t *ctx, size_t live_count) {
+  if (!ctx) return false;
+
+  size_t capacity = 16;
+  while (capacity < live_count * 2) capacity <<= 1;
+
+  ctx->relocations = (relocation_entry_t*) calloc(capacity, sizeof(relocation_entry_t));
+  if (!ctx->relocations) return false;
+
+  ctx->relocation_capacity = capacity;
+  ctx->relocation_count = 0;
+  return true;
+}
+
+static size_t gc_compact_slot(const compaction_ctx_t *ctx, const void *addr) {
+  // fibonacci hashing, the low bits of slot addresses are always zero
+  uint64_t key = (uint64_t)(uintptr_t) addr >> 4;
+  return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (ctx->relocation_capacity - 1);
+}
+
+// entries the table still takes before it refuses inserts
+static size_t gc_compact_relocations_free(const compaction_ctx_t *ctx) {
+  size_t limit = ctx->relocation_capacity / 2;
+  return ctx->relocation_count < limit ? limit - ctx->relocation_count : 0;
+}
+
+bool gc_compact_add_relocation(compaction_ctx_t *ctx, void *old_addr, void *new_addr) {
+  if (!ctx || !old_addr || !new_addr || !ctx->relocations) return false;
+  if ((ctx->relocation_count + 1) * 2 > ctx->relocation_capacity) return false;
+
+  size_t mask = ctx->relocation_capacity - 1;
+  size_t i = gc_compact_slot(ctx, old_addr);
+  while (ctx->relocations[i].old_addr && ctx->relocations[i].old_addr != old_addr) {
+    i = (i + 1) & mask;
+  }
+
+  if (!ctx->relocations[i].old_addr) ctx->relocation_count++;
+  ctx->relocations[i].old_addr = old_addr;
+  ctx->relocations[i].new_addr = new_addr;
+
+  return true;
+}
+
+void *gc_compact_find_new_address(compaction_ctx_t *ctx, void *old_addr) {
+  if (!ctx || !old_addr || ctx->relocation_count == 0) return old_addr;
+
+  size_t mask = ctx->relocation_capacity - 1;
+  size_t i = gc_compact_slot(ctx, old_addr);
+  while (ctx->relocations[i].old_addr) {
+    if (ctx->relocations[i].old_addr == old_addr) {
+      return ctx->relocations[i].new_addr;
+    }
+    i = (i + 1) & mask;
+  }
+
+  // did not relocate
+  return old_addr;
+}
+
+void gc_compact_clear_relocations(compaction_ctx_t *ctx) {
+  if (!ctx) return;
+
+  free(ctx->relocations);
+  ctx->relocations = NULL;
+  ctx->relocation_count = 0;
+  ctx->relocation_capacity = 0;
+}
+
+// destination of the next survivor, walks slots in block list order
+typedef struct gc_compact_cursor {
+  pool_block_t *block;
+  size_t index;
+} gc_compact_cursor_t;
+
+// a slot is pinned while its object is live and flagged; pinned slots are
+// never written, so the flag reads the same in the plan and the move pass
+static bool gc_compact_slot_pinned(pool_block_t *block, size_t index, obj_header_t *header) {
+  return gc_bitmap_test(block->alloc_bits, index) && header->pinned;
+}
+
+static obj_header_t *gc_compact_cursor_next(gc_compact_cursor_t *cursor, size_t *index) {
+  for (;;) {
+    while (cursor->block && cursor->index >= cursor->block->capacity) {
+      cursor->block = cursor->block->next;
+      cursor->index = 0;
+    }
+    if (!cursor->block) return NULL;
+
+    size_t i = cursor->index++;
+    obj_header_t *slot = (obj_header_t*)((char*) cursor->block->memory + i * cursor->block->slot_size);
+    if (!gc_compact_slot_pinned(cursor->block, i, slot)) {
+      if (index) *index = i;
+      return slot;
+    }
+  }
+}
+
+static size_t gc_compact_blocks_needed(const size_class_t *sc, size_t *block_count) {
+  size_t needed = 0;
+  size_t placed = 0;
+  size_t count = 0;
+
+  for (pool_block_t *block = sc->blocks; block; block = block->next) {
+    if (placed < sc->total_used) {
+      placed += block->capacity;
+      ++needed;
+    }
+    ++count;
+  }
+
+  *block_count = count;
+  return needed;
+}
+
+bool gc_compact_class_needed(const size_class_t *sc) {
+  if (!sc || sc->total_used == 0) return false;
+
+  // survivors fit in fewer blocks, the rest can be released
+  size_t block_count = 0;
+  if (gc_compact_blocks_needed(sc, &block_count) < block_count) return true;
+
+  // otherwise only worth it for a sparse class
+  return gc_pool_utilization((size_class_t*) sc) <= 0.7f;
+}
+
+// pass 1: assign every survivor its slot in the packed layout; false when
+// the relocation table refused one, nothing has moved yet then
+bool gc_compact_plan_class(gc_t *gc, size_class_t *sc) {
+  if (!gc || !sc) return false;
+
+  gc_compact_cursor_t dest = {sc->blocks, 0};
+
+  for (pool_block_t *block = sc->blocks; block; block = block->next) {
+    char *base = (char*) block->memory;
+
+    for (size_t w = 0; w < block->bitmap_words; ++w) {
+      uint64_t alloc = block->alloc_bits[w];
+
+      while (alloc) {
+        unsigned bit = gc_bitmap_ctz(alloc);
+        alloc &= alloc - 1;
+
+        obj_header_t *old_header = (obj_header_t*)(base + (w * GC_BITMAP_WORD_BITS + bit) * block->slot_size);
+        if (old_header->pinned) {
+          gc->compaction.pinned_skipped++;
+          continue;
+        }
+
+        obj_header_t *new_header = gc_compact_cursor_next(&dest, NULL);
+        if (old_header != new_header &&
+            !gc_compact_add_relocation(&gc->compaction, (void*)(old_header + 1), (void*)(new_header + 1))) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+static void gc_compact_update_pointer(compaction_ctx_t *ctx, void **ptr_ref) {
+  if (!ctx || !ptr_ref || !*ptr_ref) return;
+
+  void *new_addr = gc_compact_find_new_address(ctx, *ptr_ref);
+  if (new_addr != *ptr_ref) *ptr_ref = new_addr;
+}
+
+// pass 2: objects have not moved yet, only the pointers to them change
+void gc_compact_update_references(gc_t *gc) {
+  if (!gc) return;
+
+  compaction_ctx_t *ctx = &gc->compaction;
+
+  // update roots
+  for (size_t i = 0; i < gc->root_count; ++i) {
+    gc_compact_update_pointer(ctx, &gc->roots[i]);
+  }
+
+  // update reference graph, the slot index is keyed by the old addresses
+  gc->slot_index.valid = false;
+  ref_node_t *ref = gc->references;
+  while (ref) {
+    gc_compact_update_pointer(ctx, &ref->from_obj);
+    gc_compact_update_pointer(ctx, &ref->to_obj);
+    ref = ref->next;
+  }
+
+  // update heap bounds
+  gc_compact_update_pointer(ctx, &gc->heap_start);
+  gc_compact_update_pointer(ctx, &gc->heap_end);
+}
+
+// once everything has moved: array slots recorded as edges still hold the
+// old address of their target
+static void gc_compact_update_slots(gc_t *gc) {
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) {
+    if (ref->slot == GC_REF_NO_SLOT) continue;
+
+    void **slot = (void**) ref->from_obj + ref->slot;
+    if (*slot != ref->to_obj &&
+        gc_compact_find_new_address(&gc->compaction, *slot) == ref->to_obj) {
+      *slot = ref->to_obj;
+    }
+  }
+}
+
+// the survivors' slots were collected in mark_bits; rebuild bitmaps and free
+// lists from them, free slots are handed out in address order
+static void gc_compact_rebuild_class(size_class_t *sc) {
+  for (pool_block_t *block = sc->blocks; block; block = block->next) {
+    memcpy(block->alloc_bits, block->mark_bits, block->bitmap_words * sizeof(uint64_t));
+
+    block->used = 0;
+    block->free_list = NULL;
+    free_node_t **link = &block->free_list;
+    char *slot = (char*) block->memory;
+    for (size_t i = 0; i < block->capacity; ++i) {
+      if (gc_bitmap_test(block->alloc_bits, i)) {
+        ++block->used;
+      } else {
+        free_node_t *node = (free_node_t*) slot;
+        *link = node;
+        link = &node->next;
+      }
+      slot += block->slot_size;
+    }
+    *link = NULL;
+  }
+}
+
+// pass 3: slide survivors in the same order as the plan; a destination is
+// never ahead of its source, so every overwritten slot is dead or already moved
+void gc_compact_move_class(size_class_t *sc) {
+  if (!sc) return;
+
+  // the new allocation bitmap is built in the sweep scratch bits
+  for (pool_block_t *block = sc->blocks; block; block = block->next) {
+    memset(block->mark_bits, 0, block->bitmap_words * sizeof(uint64_t));
+  }
+
+  gc_compact_cursor_t dest = {sc->blocks, 0};
+
+  for (pool_block_t *block = sc->blocks; block; block = block->next) {
+    char *base = (char*) block->memory;
+
+    for (size_t w = 0; w < block->bitmap_words; ++w) {
+      uint64_t alloc = block->alloc_bits[w];
+
+      while (alloc) {
+        unsigned bit = gc_bitmap_ctz(alloc);
+        alloc &= alloc - 1;
+
+        size_t old_index = w * GC_BITMAP_WORD_BITS + bit;
+        obj_header_t *old_header = (obj_header_t*)(base + old_index * block->slot_size);
+        if (old_header->pinned) {
+          gc_bitmap_set(block->mark_bits, old_index);
+          continue;
+        }
+
+        // the cursor stays on the block of the slot it returned
+        size_t new_index = 0;
+        obj_header_t *new_header = gc_compact_cursor_next(&dest, &new_index);
+
+        if (old_header != new_header) {
+          memmove(new_header, old_header, sizeof(obj_header_t) + old_header->size);
+          gc_handle_relocate(new_header);
+        }
+        gc_bitmap_set(dest.block->mark_bits, new_index);
+      }
+    }
+  }
+
+  gc_compact_rebuild_class(sc);
+}
+
+static size_t gc_compact_block_bytes(const pool_block_t *block) {
+  return block->capacity * block->slot_size + block->bitmap_words * 2 * sizeof(uint64_t);
+}
+
+// hand emptied blocks back to the allocator, the head block is always kept
+size_t gc_compact_release_blocks(gc_t *gc, size_class_t *sc) {
+  if (!gc || !sc || !sc->blocks) return 0;
+
+  size_t released = 0;
+  pool_block_t **link = &sc->blocks->next;
+  while (*link) {
+    pool_block_t *block = *link;
+
+    if (block->used == 0) {
+      *link = block->next;
+      sc->total_capacity -= block->capacity;
+      gc->compaction.bytes_released += gc_compact_block_bytes(block);
+      gc_pool_free_block(block);
+      ++released;
+    } else {
+      link = &block->next;
+    }
+  }
+
+  gc->compaction.blocks_released += released;
+  return released;
+}
+
+void gc_compact_pools(gc_t *gc) {
+  if (!gc || !gc->use_pools || !gc_compact_can_move(&gc->compaction)) return;
+
+  bool selected[GC_NUM_SIZE_CLASSES];
+  size_t live_count = 0;
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    selected[i] = gc_compact_class_needed(&gc->size_classes[i]);
+    if (selected[i]) live_count += gc->size_classes[i].total_used;
+  }
+  if (live_count == 0) return;
+
+  // every selected survivor moves at most once
+  if (!gc_compact_relocations_init(&gc->compaction, live_count)) return;
+
+  // a plan that does not fit the table is dropped before any object moves
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    if (selected[i] && !gc_compact_plan_class(gc, &gc->size_classes[i])) {
+      gc_compact_clear_relocations(&gc->compaction);
+      return;
+    }
+  }
+
+  gc_compact_update_references(gc);
+
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    if (!selected[i]) continue;
+
+    gc_compact_move_class(&gc->size_classes[i]);
+    gc_compact_release_blocks(gc, &gc->size_classes[i]);
+  }
+
+  gc_compact_update_slots(gc);
+  gc_compact_clear_relocations(&gc->compaction);
+}
+
+typedef struct gc_compact_edge {
+  void *from;
+  void *to;
+  size_t seq;  // keeps the children of one object in the order they were added
+} gc_compact_edge_t;
+
+// survivors placed in the order a traversal reaches them; an unplaced
+// survivor is tagged with its marked flag, which the sweep left clear
+typedef struct gc_compact_layout {
+  gc_t *gc;
+  gc_compact_edge_t *edges;
+  size_t edge_count;
+  void **work;  // stack or queue, every push is a seed or an edge
+  size_t work_count;
+  gc_compact_cursor_t dest[GC_NUM_SIZE_CLASSES];
+  obj_header_t **order[GC_NUM_SIZE_CLASSES];
+  size_t placed[GC_NUM_SIZE_CLASSES];
+  bool failed;  // the relocation table refused an entry, the layout is dropped
+} gc_compact_layout_t;
+
+static int gc_compact_edge_compare(const void *a, const void *b) {
+  const gc_compact_edge_t *ea = (const gc_compact_edge_t*) a;
+  const gc_compact_edge_t *eb = (const gc_compact_edge_t*) b;
+
+  if (ea->from != eb->from) return (uintptr_t) ea->from > (uintptr_t) eb->from ? 1 : -1;
+  return (ea->seq > eb->seq) - (ea->seq < eb->seq);
+}
+
+// first edge leaving ptr, edges are sorted by source
+static size_t gc_compact_first_edge(const gc_compact_layout_t *layout, const void *ptr) {
+  size_t lo = 0;
+  size_t hi = layout->edge_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if ((uintptr_t) layout->edges[mid].from < (uintptr_t) ptr) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+static void gc_compact_place(gc_compact_layout_t *layout, obj_header_t *header) {
+  gc_t *gc = layout->gc;
+  size_t c = (size_t)(gc_pool_get_size_class(gc->size_classes, header->size) - gc->size_classes);
+
+  header->marked = false;
+  layout->order[c][layout->placed[c]++] = header;
+
+  obj_header_t *new_header = gc_compact_cursor_next(&layout->dest[c], NULL);
+  if (new_header != header &&
+      !gc_compact_add_relocation(&gc->compaction, (void*)(header + 1), (void*)(new_header + 1))) {
+    layout->failed = true;
+  }
+}
+
+// the tag only means something on pool slots: nursery headers stay marked
+// after a full collection and other tiers are never placed
+static bool gc_compact_in_pool(gc_t *gc, obj_header_t *header) {
+  size_class_t *sc = gc_pool_get_size_class(gc->size_classes, header->size);
+  if (!sc) return false;
+
+  for (pool_block_t *block = sc->blocks; block; block = block->next) {
+    if (gc_pool_pointer_in_block(block, header)) return true;
+  }
+  return false;
+}
+
+// place ptr if it is still waiting, false for objects that stay where they are
+static bool gc_compact_visit(gc_compact_layout_t *layout, void *ptr) {
+  obj_header_t *header = simple_gc_find_header(layout->gc, ptr);
+  if (!header || !header->marked || !gc_compact_in_pool(layout->gc, header)) return false;
+
+  gc_compact_place(layout, header);
+  return true;
+}
+
+static void gc_compact_seed_handle(gc_handle_t handle, void *ctx) {
+  gc_compact_layout_t *layout = (gc_compact_layout_t*) ctx;
+  layout->work[layout->work_count++] = *handle;
+}
+
+static void gc_compact_traverse(gc_compact_layout_t *layout, bool breadth_first) {
+  gc_t *gc = layout->gc;
+
+  for (size_t i = 0; i < gc->root_count; ++i) {
+    layout->work[layout->work_count++] = gc->roots[i];
+  }
+  gc_handle_for_each(gc->handles, gc_compact_seed_handle, layout);
+
+  if (breadth_first) {
+    for (size_t head = 0; head < layout->work_count; ++head) {
+      void *ptr = layout->work[head];
+      if (!gc_compact_visit(layout, ptr)) continue;
+
+      for (size_t e = gc_compact_first_edge(layout, ptr); e < layout->edge_count && layout->edges[e].from == ptr; ++e) {
+        layout->work[layout->work_count++] = layout->edges[e].to;
+      }
+    }
+    return;
+  }
+
+  // depth first: the first seed and the first child are popped first
+  for (size_t i = 0, j = layout->work_count; i + 1 < j; ++i, --j) {
+    void *tmp = layout->work[i];
+    layout->work[i] = layout->work[j - 1];
+    layout->work[j - 1] = tmp;
+  }
+
+  while (layout->work_count > 0) {
+    void *ptr = layout->work[--layout->work_count];
+    if (!gc_compact_visit(layout, ptr)) continue;
+
+    size_t first = gc_compact_first_edge(layout, ptr);
+    size_t last = first;
+    while (last < layout->edge_count && layout->edges[last].from == ptr) ++last;
+    while (last > first) {
+      layout->work[layout->work_count++] = layout->edges[--last].to;
+    }
+  }
+}
+
+// write the placed survivors of one class through a copy, the layout is an
+// arbitrary permutation so sliding in place could overwrite a live source
+static void gc_compact_reorder_class(size_class_t *sc, obj_header_t **order, size_t count, char *scratch) {
+  for (size_t k = 0; k < count; ++k) {
+    memcpy(scratch + k * sc->slot_size, order[k], sizeof(obj_header_t) + order[k]->size);
+  }
+
+  // pinned survivors keep their slots
+  for (pool_block_t *block = sc->blocks; block; block = block->next) {
+    char *base = (char*) block->memory;
+
+    for (size_t w = 0; w < block->bitmap_words; ++w) {
+      uint64_t alloc = block->alloc_bits[w];
+      block->mark_bits[w] = 0;
+
+      while (alloc) {
+        unsigned bit = gc_bitmap_ctz(alloc);
+        alloc &= alloc - 1;
+
+        size_t index = w * GC_BITMAP_WORD_BITS + bit;
+        obj_header_t *header = (obj_header_t*)(base + index * block->slot_size);
+        if (header->pinned) gc_bitmap_set(block->mark_bits, index);
+      }
+    }
+  }
+
+  gc_compact_cursor_t dest = {sc->blocks, 0};
+  for (size_t k = 0; k < count; ++k) {
+    size_t index = 0;
+    obj_header_t *new_header = gc_compact_cursor_next(&dest, &index);
+    obj_header_t *copy = (obj_header_t*)(scratch + k * sc->slot_size);
+
+    memcpy(new_header, copy, sizeof(obj_header_t) + copy->size);
+    gc_handle_relocate(new_header);
+    gc_bitmap_set(dest.block->mark_bits, index);
+  }
+
+  gc_compact_rebuild_class(sc);
+}
+
+void gc_compact_locality(gc_t *gc, bool breadth_first) {
+  if (!gc || !gc->use_pools || !gc_compact_can_move(&gc->compaction)) return;
+
+  gc_compact_layout_t layout;
+  memset(&layout, 0, sizeof(gc_compact_layout_t));
+  layout.gc = gc;
+
+  // every buffer is reserved before the first object is planned
+  size_t live_count = 0;
+  char *scratch[GC_NUM_SIZE_CLASSES] = {NULL};
+  bool ok = true;
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES && ok; ++i) {
+    size_class_t *sc = &gc->size_classes[i];
+    layout.dest[i].block = sc->blocks;
+    if (sc->total_used == 0) continue;
+
+    live_count += sc->total_used;
+    layout.order[i] = (obj_header_t**) malloc(sizeof(obj_header_t*) * sc->total_used);
+    scratch[i] = (char*) malloc(sc->total_used * sc->slot_size);
+    ok = layout.order[i] && scratch[i];
+  }
+
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) ++layout.edge_count;
+  size_t seeds = gc->root_count + (gc->handles ? gc->handles->count : 0);
+
+  if (ok && live_count > 0) {
+    layout.edges = (gc_compact_edge_t*) malloc(sizeof(gc_compact_edge_t) * (layout.edge_count + 1));
+    layout.work = (void**) malloc(sizeof(void*) * (seeds + layout.edge_count + 1));
+    ok = layout.edges && layout.work && gc_compact_relocations_init(&gc->compaction, live_count);
+  }
+
+  if (ok && live_count > 0) {
+    // the reference list is newest first
+    size_t n = 0;
+    for (ref_node_t *ref = gc->references; ref; ref = ref->next, ++n) {
+      layout.edges[n].from = ref->from_obj;
+      layout.edges[n].to = ref->to_obj;
+      layout.edges[n].seq = layout.edge_count - n;
+    }
+    qsort(layout.edges, layout.edge_count, sizeof(gc_compact_edge_t), gc_compact_edge_compare);
+
+    // tag everything that may move
+    for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+      for (pool_block_t *block = gc->size_classes[i].blocks; block; block = block->next) {
+        char *base = (char*) block->memory;
+
+        for (size_t w = 0; w < block->bitmap_words; ++w) {
+          uint64_t alloc = block->alloc_bits[w];
+
+          while (alloc) {
+            unsigned bit = gc_bitmap_ctz(alloc);
+            alloc &= alloc - 1;
+
+            obj_header_t *header = (obj_header_t*)(base + (w * GC_BITMAP_WORD_BITS + bit) * block->slot_size);
+            if (header->pinned) gc->compaction.pinned_skipped++;
+            else header->marked = true;
+          }
+        }
+      }
+    }
+
+    gc_compact_traverse(&layout, breadth_first);
+
+    // unreachable from roots through recorded edges (only seen by the stack
+    // scan or through a large object), these follow in slot order
+    for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+      for (pool_block_t *block = gc->size_classes[i].blocks; block; block = block->next) {
+        char *base = (char*) block->memory;
+
+        for (size_t w = 0; w < block->bitmap_words; ++w) {
+          uint64_t alloc = block->alloc_bits[w];
+
+          while (alloc) {
+            unsigned bit = gc_bitmap_ctz(alloc);
+            alloc &= alloc - 1;
+
+            obj_header_t *header = (obj_header_t*)(base + (w * GC_BITMAP_WORD_BITS + bit) * block->slot_size);
+            if (header->marked) gc_compact_place(&layout, header);
+          }
+        }
+      }
+    }
+
+    // placing only tagged and planned, nothing has moved if it failed
+    if (!layout.failed) {
+      gc_compact_update_references(gc);
+
+      for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+        size_class_t *sc = &gc->size_classes[i];
+        if (sc->total_used == 0) continue;
+
+        gc_compact_reorder_class(sc, layout.order[i], layout.placed[i], scratch[i]);
+        gc_compact_release_blocks(gc, sc);
+      }
+      gc_compact_update_slots(gc);
+    }
+    gc_compact_clear_relocations(&gc->compaction);
+  }
+
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    free(layout.order[i]);
+    free(scratch[i]);
+  }
+  free(layout.edges);
+  free(layout.work);
+}
+
+typedef struct gc_evac_block {
+  pool_block_t *block;
+  size_t position;  // in the class's block list
+  float occupancy;
+  bool candidate;
+  bool pinned;
+} gc_evac_block_t;
+
+static bool gc_compact_block_pinned(pool_block_t *block) {
+  char *base = (char*) block->memory;
+
+  for (size_t w = 0; w < block->bitmap_words; ++w) {
+    uint64_t alloc = block->alloc_bits[w];
+
+    while (alloc) {
+      unsigned bit = gc_bitmap_ctz(alloc);
+      alloc &= alloc - 1;
+
+      obj_header_t *header = (obj_header_t*)(base + (w * GC_BITMAP_WORD_BITS + bit) * block->slot_size);
+      if (header->pinned) return true;
+    }
+  }
+  return false;
+}
+
+static int gc_evac_compare(const void *a, const void *b) {
+  float oa = ((const gc_evac_block_t*) a)->occupancy;
+  float ob = ((const gc_evac_block_t*) b)->occupancy;
+  return (oa > ob) - (oa < ob);
+}
+
+// copy every survivor of block into the densest non-candidate blocks, false
+// when no slot or relocation entry was left for one: the copies made so far
+// are the live objects from then on and the originals are left for the next
+// sweep
+static bool gc_compact_evacuate_block(gc_t *gc, size_class_t *sc, pool_block_t *block,
+    gc_evac_block_t *ranked, size_t *target) {
+  char *base = (char*) block->memory;
+  size_t copied = 0;
+
+  for (size_t w = 0; w < block->bitmap_words; ++w) {
+    uint64_t alloc = block->alloc_bits[w];
+
+    while (alloc) {
+      unsigned bit = gc_bitmap_ctz(alloc);
+      alloc &= alloc - 1;
+
+      obj_header_t *old_header = (obj_header_t*)(base + (w * GC_BITMAP_WORD_BITS + bit) * block->slot_size);
+
+      // the free slot accounting promised a destination; if it is ever
+      // wrong, stop at the first block instead of running past it
+      while (*target > 0 && (ranked[*target].candidate || !ranked[*target].block->free_list)) --*target;
+      pool_block_t *dest = ranked[*target].block;
+      void *new_data = NULL;
+      if (!ranked[*target].candidate) {
+        new_data = gc_pool_alloc_from_block(dest, old_header->type, old_header->size);
+      }
+      if (!new_data) {
+        sc->total_used += copied;
+        return false;
+      }
+
+      obj_header_t *new_header = (obj_header_t*) new_data - 1;
+      if (!gc_compact_add_relocation(&gc->compaction, (void*)(old_header + 1), new_data)) {
+        // the copies stay allocated next to their originals
+        gc_pool_free_to_block(dest, sc, new_header);
+        sc->total_used += copied + 1;
+        return false;
+      }
+      memcpy(new_header, old_header, sizeof(obj_header_t) + old_header->size);
+      gc_handle_relocate(new_header);
+      ++copied;
+
+      gc->compaction.bytes_evacuated += block->slot_size;
+    }
+  }
+  return true;
+}
+
+size_t gc_compact_evacuate_class(gc_t *gc, size_class_t *sc, size_t *budget) {
+  if (!gc || !sc || !budget) return 0;
+
+  size_t count = gc_pool_count_blocks(sc);
+  if (count < 2) return 0;
+
+  gc_evac_block_t *ranked = (gc_evac_block_t*) malloc(sizeof(gc_evac_block_t) * count);
+  if (!ranked) return 0;
+
+  size_t n = 0;
+  for (pool_block_t *block = sc->blocks; block; block = block->next) {
+    ranked[n].block = block;
+    ranked[n].position = n;
+    ranked[n].occupancy = (float) block->used / (float) block->capacity;
+    ranked[n].candidate = false;
+    ranked[n].pinned = gc_compact_block_pinned(block);
+    ++n;
+  }
+  qsort(ranked, count, sizeof(gc_evac_block_t), gc_evac_compare);
+
+  // sparsest first, while the survivors fit into the blocks that stay
+  size_t free_slots = sc->total_capacity - sc->total_used;
+  size_t moving = 0;
+  size_t candidates = 0;
+  for (size_t i = 0; i + 1 < count; ++i) {
+    pool_block_t *block = ranked[i].block;
+    if (ranked[i].occupancy >= GC_COMPACT_SPARSE_OCCUPANCY) break;
+
+    // a block holding a pinned object can only receive survivors
+    if (ranked[i].pinned) {
+      gc->compaction.pinned_skipped++;
+      continue;
+    }
+
+    size_t live_bytes = block->used * block->slot_size;
+    if (live_bytes > *budget) break;
+
+    size_t remaining_free = free_slots - (block->capacity - block->used);
+    if (moving + block->used > remaining_free) break;
+
+    free_slots = remaining_free;
+    moving += block->used;
+    *budget -= live_bytes;
+    ranked[i].candidate = true;
+    ++candidates;
+  }
+
+  // candidates by list position, for unlinking them afterwards
+  bool *evacuated = candidates ? (bool*) calloc(count, sizeof(bool)) : NULL;
+  if (!evacuated) {
+    free(ranked);
+    return 0;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (ranked[i].candidate) evacuated[ranked[i].position] = true;
+  }
+
+  // copy survivors into the densest blocks that still have room; a block
+  // whose survivors do not all fit the relocation table stays where it is
+  size_t target = count - 1;
+  for (size_t i = 0; i < count; ++i) {
+    if (!ranked[i].candidate) continue;
+
+    if (ranked[i].block->used > gc_compact_relocations_free(&gc->compaction) ||
+        !gc_compact_evacuate_block(gc, sc, ranked[i].block, ranked, &target)) {
+      evacuated[ranked[i].position] = false;
+      --candidates;
+    }
+  }
+
+  // unlink and free the evacuated blocks, total_used is unchanged
+  pool_block_t **link = &sc->blocks;
+  size_t position = 0;
+  while (*link) {
+    pool_block_t *block = *link;
+
+    if (evacuated[position++]) {
+      *link = block->next;
+      sc->total_capacity -= block->capacity;
+      gc->compaction.bytes_released += gc_compact_block_bytes(block);
+      gc_pool_free_block(block);
+    } else {
+      link = &block->next;
+    }
+  }
+
+  gc->compaction.blocks_evacuated += candidates;
+  gc->compaction.blocks_released += candidates;
+  free(evacuated);
+  free(ranked);
+  return candidates;
+}
+
+void gc_compact_evacuate(gc_t *gc) {
+  if (!gc || !gc->use_pools || !gc_compact_can_move(&gc->compaction)) return;
+
+  size_t live_count = 0;
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    live_count += gc->size_classes[i].total_used;
+  }
+
+  // at most the budget's worth of objects is copied
+  size_t budget = gc->compaction.evacuate_budget;
+  size_t smallest_slot = gc->size_classes[0].slot_size;
+  if (live_count > budget / smallest_slot) live_count = budget / smallest_slot;
+  if (!gc_compact_relocations_init(&gc->compaction, live_count)) return;
+
+  // fixup only compares pointers against the table, so the evacuated blocks
+  // are already gone when it runs
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES && budget > 0; ++i) {
+    gc_compact_evacuate_class(gc, &gc->size_classes[i], &budget);
+  }
+
+  gc_compact_update_references(gc);
+  gc_compact_update_slots(gc);
+  gc_compact_clear_relocations(&gc->compaction);
+}
+
+size_t gc_compact_large_free_bytes(const gc_t *gc) {
+  if (!gc) return 0;
+
+  size_t bytes = 0;
+  for (large_block_t *block = gc->large_blocks; block; block = block->next) {
+    if (!block->in_use) bytes += sizeof(obj_header_t) + block->size;
+  }
+  return bytes;
+}
+
+// the sweep keeps dead large blocks around for reuse, hand them back
+size_t gc_compact_release_large(gc_t *gc) {
+  if (!gc) return 0;
+
+  size_t released = 0;
+  large_block_t **link = &gc->large_blocks;
+  while (*link) {
+    large_block_t *block = *link;
+
+    if (!block->in_use) {
+      *link = block->next;
+      gc->large_block_count--;
+      gc->compaction.large_bytes_released += sizeof(obj_header_t) + block->size;
+      gc_large_free_block(block);
+      ++released;
+    } else {
+      link = &block->next;
+    }
+  }
+
+  gc->compaction.large_blocks_released += released;
+  return released;
+}
+
+void gc_compact_large(gc_t *gc) {
+  if (!gc || !gc->use_pools) return;
+
+  gc_compact_release_large(gc);
+  if (!gc_compact_can_move(&gc->compaction)) return;
+
+  // already packed when every movable survivor sits in one arena that holds
+  // nothing else and no block is larger than its object
+  size_t live_count = 0;
+  size_t live_bytes = 0;
+  large_arena_t *shared = NULL;
+  bool same_arena = true;
+  bool slack = false;
+  for (large_block_t *block = gc->large_blocks; block; block = block->next) {
+    if (block->header->pinned) continue;
+
+    if (block->size != block->header->size) slack = true;
+    if (live_count > 0 && block->arena != shared) same_arena = false;
+    shared = block->arena;
+    live_bytes += gc_large_arena_footprint(block->header);
+    ++live_count;
+  }
+  if (live_count == 0) return;
+
+  // a lone object in its own allocation gains nothing from a copy either
+  if (!slack && same_arena && (shared ? shared->size == live_bytes : live_count == 1)) return;
+
+  if (!gc_compact_relocations_init(&gc->compaction, live_count)) return;
+
+  large_arena_t *arena = gc_large_arena_create(live_bytes);
+  if (!arena) {
+    gc_compact_clear_relocations(&gc->compaction);
+    return;
+  }
+
+  // every destination is recorded before the first object is copied
+  char *cursor = (char*) arena->memory;
+  for (large_block_t *block = gc->large_blocks; block; block = block->next) {
+    if (block->header->pinned) continue;
+
+    if (!gc_compact_add_relocation(&gc->compaction, (void*)(block->header + 1), (void*)((obj_header_t*) cursor + 1))) {
+      free(arena->memory);
+      free(arena);
+      gc_compact_clear_relocations(&gc->compaction);
+      return;
+    }
+    cursor += gc_large_arena_footprint(block->header);
+  }
+
+  cursor = (char*) arena->memory;
+  for (large_block_t *block = gc->large_blocks; block; block = block->next) {
+    if (block->header->pinned) continue;
+
+    size_t footprint = gc_large_arena_footprint(block->header);
+    obj_header_t *new_header = gc_large_move_block(block, arena, cursor);
+    cursor += footprint;
+
+    gc_handle_relocate(new_header);
+    gc->compaction.large_objects_moved++;
+  }
+
+  gc_compact_update_references(gc);
+  gc_compact_update_slots(gc);
+  gc_compact_clear_relocations(&gc->compaction);
+}
+
+void gc_compact_histogram(gc_t *gc, gc_frag_histogram_t *histogram) {
+  if (!histogram) return;
+
+  memset(histogram, 0, sizeof(gc_frag_histogram_t));
+  if (!gc || !gc->use_pools) return;
+
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    for (pool_block_t *block = gc->size_classes[i].blocks; block; block = block->next) {
+      size_t bucket = block->used * GC_FRAG_BUCKETS / block->capacity;
+      if (bucket >= GC_FRAG_BUCKETS) bucket = GC_FRAG_BUCKETS - 1;
+
+      histogram->blocks[bucket]++;
+      histogram->free_bytes[bucket] += (block->capacity - block->used) * block->slot_size;
+    }
+  }
+}
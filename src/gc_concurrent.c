@@ -0,0 +1,321 @@
+#include "gc_concurrent.h"
+#include "simple_gc.h"
+#include "gc_mark.h"
+#include "gc_sweep.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+static uint64_t gc_conc_now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000ULL + (uint64_t) ts.tv_nsec / 1000ULL;
+}
+
+bool gc_concurrent_init(gc_t *gc) {
+  if (!gc) return false;
+  if (gc->concurrent) return true;
+
+  gc_concurrent_t *conc = (gc_concurrent_t*) calloc(1, sizeof(gc_concurrent_t));
+  if (!conc) return false;
+
+  if (pthread_key_create(&conc->satb_key, NULL) != 0) {
+    free(conc);
+    return false;
+  }
+
+  conc->phase = GC_CONC_IDLE;
+  conc->thread_running = false;
+  conc->buffers = NULL;
+  conc->filled = NULL;
+  pthread_mutex_init(&conc->heap_lock, NULL);
+  pthread_mutex_init(&conc->pause_lock, NULL);
+  pthread_mutex_init(&conc->satb_lock, NULL);
+  memset(&conc->stats, 0, sizeof(gc_concurrent_stats_t));
+
+  gc->concurrent = conc;
+  return true;
+}
+
+static void gc_conc_free_buffers(gc_satb_buffer_t *buf) {
+  while (buf) {
+    gc_satb_buffer_t *next = buf->next;
+    free(buf);
+    buf = next;
+  }
+}
+
+void gc_concurrent_destroy(gc_t *gc) {
+  if (!gc || !gc->concurrent) return;
+
+  gc_concurrent_t *conc = gc->concurrent;
+  pthread_mutex_lock(&conc->pause_lock);
+  gc_concurrent_abort(gc);
+  pthread_mutex_unlock(&conc->pause_lock);
+
+  gc_conc_free_buffers(conc->buffers);
+  gc_conc_free_buffers(conc->filled);
+  pthread_key_delete(conc->satb_key);
+  pthread_mutex_destroy(&conc->heap_lock);
+  pthread_mutex_destroy(&conc->pause_lock);
+  pthread_mutex_destroy(&conc->satb_lock);
+  free(conc);
+  gc->concurrent = NULL;
+}
+
+bool gc_concurrent_marking(const gc_t *gc) {
+  return (gc && gc->concurrent && gc->concurrent->phase == GC_CONC_MARKING);
+}
+
+void gc_concurrent_lock(gc_t *gc) {
+  if (gc && gc->concurrent) pthread_mutex_lock(&gc->concurrent->heap_lock);
+}
+
+void gc_concurrent_unlock(gc_t *gc) {
+  if (gc && gc->concurrent) pthread_mutex_unlock(&gc->concurrent->heap_lock);
+}
+
+void gc_concurrent_pause_lock(gc_t *gc) {
+  if (gc && gc->concurrent) pthread_mutex_lock(&gc->concurrent->pause_lock);
+}
+
+void gc_concurrent_pause_unlock(gc_t *gc) {
+  if (gc && gc->concurrent) pthread_mutex_unlock(&gc->concurrent->pause_lock);
+}
+
+// shading and scanning go through the collector's mark stack, caller holds
+// heap_lock (or is the only thread running)
+static size_t gc_conc_drain(gc_t *gc, size_t max_objects) {
+  size_t scanned = gc_mark_drain(gc, max_objects);
+  gc->concurrent->stats.objects_scanned += scanned;
+  return scanned;
+}
+
+static void gc_conc_shade_buffer(gc_t *gc, gc_satb_buffer_t *buf) {
+  for (size_t i = 0; i < buf->count; ++i) {
+    gc_mark_shade(gc, buf->entries[i]);
+  }
+  gc->concurrent->stats.satb_drained += buf->count;
+  buf->count = 0;
+}
+
+// shade entries from buffers mutators have handed over, caller holds heap_lock
+static size_t gc_conc_pull_filled(gc_t *gc) {
+  gc_concurrent_t *conc = gc->concurrent;
+
+  pthread_mutex_lock(&conc->satb_lock);
+  gc_satb_buffer_t *filled = conc->filled;
+  conc->filled = NULL;
+  pthread_mutex_unlock(&conc->satb_lock);
+
+  size_t pulled = 0;
+  while (filled) {
+    gc_satb_buffer_t *next = filled->next;
+    pulled += filled->count;
+    gc_conc_shade_buffer(gc, filled);
+    free(filled);
+    filled = next;
+  }
+  return pulled;
+}
+
+static void *gc_conc_marker(void *arg) {
+  gc_t *gc = (gc_t*) arg;
+  gc_concurrent_t *conc = gc->concurrent;
+  uint64_t start = gc_conc_now_us();
+
+  // leaves the loop holding heap_lock, the stats are read under it
+  for (;;) {
+    pthread_mutex_lock(&conc->heap_lock);
+
+    if (conc->stop_requested) break;
+
+    if (gc->mark_stack.count == 0 && gc_conc_pull_filled(gc) == 0 &&
+        !gc_mark_recover_overflow(gc) && gc->mark_stack.count == 0) {
+      // nothing left to trace; the final pause drains what remains
+      conc->mark_done = true;
+      break;
+    }
+
+    gc_conc_drain(gc, GC_CONCURRENT_BATCH);
+
+    pthread_mutex_unlock(&conc->heap_lock);
+  }
+
+  conc->stats.concurrent_mark_us += gc_conc_now_us() - start;
+  pthread_mutex_unlock(&conc->heap_lock);
+  return NULL;
+}
+
+bool gc_concurrent_start(gc_t *gc) {
+  if (!gc || !gc->concurrent || gc_concurrent_marking(gc)) return false;
+
+  gc_concurrent_t *conc = gc->concurrent;
+  uint64_t start = gc_conc_now_us();
+
+  // live objects in unswept blocks still carry the last cycle's mark
+  gc_sweep_finish(gc);
+
+  // initial pause: snapshot the roots
+  conc->phase = GC_CONC_MARKING;
+  gc_mark_stack_clear(&gc->mark_stack);
+  conc->stop_requested = false;
+  conc->mark_done = false;
+  conc->cycle_objects_before = gc->object_count;
+  conc->stats.cycles++;
+
+  gc_mark_shade_roots(gc);
+
+  // without a marker thread the final pause does all the tracing
+  conc->thread_running = (pthread_create(&conc->thread, NULL, gc_conc_marker, gc) == 0);
+
+  conc->stats.initial_pause_us += gc_conc_now_us() - start;
+  return true;
+}
+
+bool gc_concurrent_mark_done(gc_t *gc) {
+  if (!gc || !gc->concurrent) return false;
+
+  gc_concurrent_t *conc = gc->concurrent;
+  pthread_mutex_lock(&conc->heap_lock);
+  bool done = gc_concurrent_marking(gc) && (conc->mark_done || !conc->thread_running);
+  pthread_mutex_unlock(&conc->heap_lock);
+  return done;
+}
+
+// waits for the marker to drain its worklist if it hasn't yet
+void gc_concurrent_join(gc_t *gc) {
+  if (!gc || !gc->concurrent) return;
+
+  gc_concurrent_t *conc = gc->concurrent;
+  pthread_mutex_lock(&conc->heap_lock);
+  bool running = conc->thread_running;
+  pthread_mutex_unlock(&conc->heap_lock);
+  if (!running) return;
+
+  pthread_join(conc->thread, NULL);
+  pthread_mutex_lock(&conc->heap_lock);
+  conc->thread_running = false;
+  pthread_mutex_unlock(&conc->heap_lock);
+}
+
+void gc_concurrent_final_mark(gc_t *gc) {
+  if (!gc_concurrent_marking(gc)) return;
+
+  gc_concurrent_t *conc = gc->concurrent;
+  uint64_t start = gc_conc_now_us();
+
+  // drain SATB buffers and rescan roots until nothing new turns gray; every
+  // mutator writes its buffer under heap_lock, so they are all quiet here
+  do {
+    gc_conc_pull_filled(gc);
+    gc_satb_buffer_t *buf = conc->buffers;
+    while (buf) {
+      conc->stats.satb_logged += buf->logged;
+      buf->logged = 0;
+      gc_conc_shade_buffer(gc, buf);
+      buf = buf->next;
+    }
+
+    gc_mark_shade_roots(gc);
+
+    do {
+      gc_conc_drain(gc, SIZE_MAX);
+    } while (gc_mark_recover_overflow(gc) || gc->mark_stack.count > 0);
+  } while (conc->filled);
+
+  conc->phase = GC_CONC_IDLE;
+
+  if (gc->auto_root_scan_enabled) {
+    simple_gc_scan_stack(gc);
+  }
+
+  conc->stats.final_pause_us += gc_conc_now_us() - start;
+}
+
+void gc_concurrent_abort(gc_t *gc) {
+  if (!gc || !gc->concurrent) return;
+
+  gc_concurrent_t *conc = gc->concurrent;
+  pthread_mutex_lock(&conc->heap_lock);
+  conc->stop_requested = true;
+  pthread_mutex_unlock(&conc->heap_lock);
+  gc_concurrent_join(gc);
+
+  pthread_mutex_lock(&conc->heap_lock);
+
+  // gray objects are marked but unscanned and would cut off a later trace
+  if (gc_concurrent_marking(gc)) gc_unmark_all(gc);
+
+  gc_conc_free_buffers(conc->filled);
+  conc->filled = NULL;
+  gc_satb_buffer_t *buf = conc->buffers;
+  while (buf) {
+    buf->count = 0;
+    buf = buf->next;
+  }
+  gc_mark_stack_clear(&gc->mark_stack);
+  conc->phase = GC_CONC_IDLE;
+  pthread_mutex_unlock(&conc->heap_lock);
+}
+
+static gc_satb_buffer_t *gc_conc_thread_buffer(gc_concurrent_t *conc) {
+  gc_satb_buffer_t *buf = (gc_satb_buffer_t*) pthread_getspecific(conc->satb_key);
+  if (buf) return buf;
+
+  buf = (gc_satb_buffer_t*) calloc(1, sizeof(gc_satb_buffer_t));
+  if (!buf) return NULL;
+
+  pthread_mutex_lock(&conc->satb_lock);
+  buf->next = conc->buffers;
+  conc->buffers = buf;
+  pthread_mutex_unlock(&conc->satb_lock);
+
+  pthread_setspecific(conc->satb_key, buf);
+  return buf;
+}
+
+// hand a full buffer's entries to the marker through the filled queue
+static bool gc_conc_flush_buffer(gc_concurrent_t *conc, gc_satb_buffer_t *buf) {
+  gc_satb_buffer_t *full = (gc_satb_buffer_t*) malloc(sizeof(gc_satb_buffer_t));
+  if (!full) return false;
+
+  memcpy(full->entries, buf->entries, sizeof(void*) * buf->count);
+  full->count = buf->count;
+  full->logged = 0;
+
+  pthread_mutex_lock(&conc->satb_lock);
+  full->next = conc->filled;
+  conc->filled = full;
+  pthread_mutex_unlock(&conc->satb_lock);
+
+  buf->count = 0;
+  return true;
+}
+
+void gc_concurrent_satb_log(gc_t *gc, void *ptr) {
+  if (!gc_concurrent_marking(gc) || !ptr) return;
+
+  gc_concurrent_t *conc = gc->concurrent;
+  gc_satb_buffer_t *buf = gc_conc_thread_buffer(conc);
+
+  if (!buf || (buf->count == GC_SATB_BUFFER_SIZE && !gc_conc_flush_buffer(conc, buf))) {
+    // no memory to log into; we hold the heap lock so shade directly
+    conc->stats.satb_logged++;
+    gc_mark_shade(gc, ptr);
+    return;
+  }
+
+  buf->entries[buf->count++] = ptr;
+  buf->logged++;
+}
+
+void gc_concurrent_get_stats(gc_t *gc, gc_concurrent_stats_t *stats) {
+  if (!gc || !gc->concurrent || !stats) return;
+
+  // the marker thread adds its time when it finishes
+  pthread_mutex_lock(&gc->concurrent->heap_lock);
+  *stats = gc->concurrent->stats;
+  pthread_mutex_unlock(&gc->concurrent->heap_lock);
+}
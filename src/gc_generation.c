@@ -3,15 +3,18 @@
 #include "gc_types.h"
 #include "gc_pool.h"
 #include "gc_large.h"
+#include "gc_bitmap.h"
+#include "gc_barrier.h"
 // probably delete these check after compiling
 #include "gc_mark.h"
 #include "gc_sweep.h"
 #include "gc_trace.h"
 #include "gc_debug.h"
+#include "gc_report.h"
 
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include <sys/mman.h>
 
 
 bool gc_gen_init(gc_t *gc, size_t young_size) {
@@ -20,14 +23,44 @@ bool gc_gen_init(gc_t *gc, size_t young_size) {
   gc_gen_t *gen = (gc_gen_t*) calloc(1, sizeof(gc_gen_t));
   if (!gen) return false;
 
-  if (!gc_pool_init_all_classes(gen->young_pools)) {
+  // reserve eden and both survivor spaces up front, pages are only touched
+  // as the bump pointers reach them
+  size_t page_size = 4096;
+  size_t eden_size = (young_size + page_size - 1) / page_size * page_size;
+  size_t survivor_size = (young_size / GC_SURVIVOR_RATIO + page_size - 1) / page_size * page_size;
+  if (survivor_size == 0) survivor_size = page_size;
+  size_t reserved = eden_size + 2 * survivor_size;
+  void *memory = mmap(NULL, reserved,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1, 0);
+  if (memory == MAP_FAILED) {
+    free(gen);
+    return false;
+  }
+
+  size_t granules = reserved / GC_NURSERY_ALIGN;
+  gen->nursery_starts = (uint64_t*) calloc(GC_BITMAP_WORDS(granules), sizeof(uint64_t));
+  if (!gen->nursery_starts) {
+    munmap(memory, reserved);
     free(gen);
     return false;
   }
 
   gen->enabled = true;
-  gen->young_large = NULL;
-  gen->young_large_count = 0;
+  gen->nursery_start = (char*) memory;
+  gen->nursery_end = gen->nursery_start + reserved;
+  char *space = gen->nursery_start;
+  gen->eden = (gc_gen_space_t){space, space, space + eden_size};
+  space += eden_size;
+  for (int i = 0; i < 2; ++i) {
+    gen->survivor[i] = (gc_gen_space_t){space, space, space + survivor_size};
+    space += survivor_size;
+  }
+  gen->survivor_from = 0;
+  gen->kept = false;
+  gen->kept_used = 0;
+  gen->kept_retry = false;
   gen->young_capacity = young_size;
   gen->young_used = 0;
   gen->minor_count= 0;
@@ -35,15 +68,13 @@ bool gc_gen_init(gc_t *gc, size_t young_size) {
 
   memset(gen->stats, 0, sizeof(gen->stats));
 
-  // don't initialize card table yet - wait until we have heap bounds
-  gen->cardtable.cards = NULL;
-  gen->cardtable.num_cards = 0;
-  gen->cardtable.enabled = false;
-  gen->cardtable.heap_start = NULL;
-  gen->cardtable.heap_end = NULL;
-  gen->cardtable.dirty_count = 0;
+  // the card table is set up once the old generation has something to card
+  memset(&gen->cardtable, 0, sizeof(gen->cardtable));
+  gc_remset_init(&gen->remset);
+  gen->remembered = false;
 
   gc->gen_context = gen;
+  gc_barrier_update_filter(gc);
   return true;
 }
 
@@ -52,58 +83,265 @@ void gc_gen_destroy(gc_t *gc) {
 
   gc_gen_t *gen = gc->gen_context;
 
-  gc_pool_destroy_all_classes(gen->young_pools);
-  gc_large_destroy_all(gen->young_large);
+  munmap(gen->nursery_start, (size_t)(gen->nursery_end - gen->nursery_start));
+  free(gen->nursery_starts);
   gc_cardtable_destroy(&gen->cardtable);
+  gc_remset_destroy(&gen->remset);
 
   free(gen);
   gc->gen_context = NULL;
+  gc_barrier_update_filter(gc);
 }
 
 bool gc_gen_enabled(const gc_t *gc) {
   return (gc && gc->gen_context && gc->gen_context->enabled);
 }
 
-static obj_header_t* gc_gen_find_header_young(gc_t *gc, void *ptr) {
-  if (!gc || !gc->gen_context || !ptr) return NULL;
+static size_t gc_gen_nursery_footprint(size_t size) {
+  size_t bytes = sizeof(obj_header_t) + size;
+  return (bytes + GC_NURSERY_ALIGN - 1) & ~(size_t)(GC_NURSERY_ALIGN - 1);
+}
 
-  gc_gen_t *gen = gc->gen_context;
+static size_t gc_gen_nursery_index(const gc_gen_t *gen, const obj_header_t *header) {
+  return (size_t)((const char*) header - gen->nursery_start) / GC_NURSERY_ALIGN;
+}
+
+// O(1): the header sits right before the data and its granule has a start bit
+obj_header_t* gc_gen_nursery_header(gc_gen_t *gen, void *ptr) {
+  if (!gen || !ptr || !gc_gen_in_nursery(gen, ptr)) return NULL;
+
+  char *start = (char*) ptr - sizeof(obj_header_t);
+  if (start < gen->nursery_start) return NULL;
+
+  size_t offset = (size_t)(start - gen->nursery_start);
+  if (offset % GC_NURSERY_ALIGN != 0) return NULL;
+  if (!gc_bitmap_test(gen->nursery_starts, offset / GC_NURSERY_ALIGN)) return NULL;
+
+  return (obj_header_t*) start;
+}
+
+static bool gc_gen_space_contains(const gc_gen_space_t *space, const void *ptr) {
+  return (const char*) ptr >= space->start && (const char*) ptr < space->top;
+}
+
+static size_t gc_gen_space_used(const gc_gen_space_t *space) {
+  return (size_t)(space->top - space->start);
+}
+
+// the to space is empty unless the nursery was kept
+static void gc_gen_update_young_used(gc_gen_t *gen) {
+  gen->young_used = gc_gen_space_used(&gen->eden) +
+    gc_gen_space_used(&gen->survivor[0]) + gc_gen_space_used(&gen->survivor[1]);
+}
+
+// pointer increment plus compare; the caller fills in the header
+static obj_header_t* gc_gen_space_bump(gc_gen_t *gen, gc_gen_space_t *space, size_t size) {
+  size_t bytes = gc_gen_nursery_footprint(size);
+  if ((size_t)(space->end - space->top) < bytes) return NULL;
+
+  obj_header_t *header = (obj_header_t*) space->top;
+  space->top += bytes;
+  gc_bitmap_set(gen->nursery_starts, gc_gen_nursery_index(gen, header));
+  return header;
+}
+
+static void *gc_gen_nursery_alloc(gc_gen_t *gen, obj_type_t type, size_t size) {
+  obj_header_t *header = gc_gen_space_bump(gen, &gen->eden, size);
+  if (!header) return NULL;
+
+  gc_init_header(header, type, size);
+  header->generation = GC_GEN_YOUNG;
+
+  gc_gen_update_young_used(gen);
+  return (void*)(header + 1);
+}
+
+// forget every object in a space, its memory is reused from the start
+static void gc_gen_space_reset(gc_gen_t *gen, gc_gen_space_t *space) {
+  uint64_t *bits = gen->nursery_starts;
+  size_t first = gc_gen_nursery_index(gen, (obj_header_t*) space->start);
+  size_t last = gc_gen_nursery_index(gen, (obj_header_t*) space->top);
+
+  while (first < last && first % GC_BITMAP_WORD_BITS != 0) {
+    gc_bitmap_clear(bits, first++);
+  }
+  while (first + GC_BITMAP_WORD_BITS <= last) {
+    bits[first / GC_BITMAP_WORD_BITS] = 0;
+    first += GC_BITMAP_WORD_BITS;
+  }
+  while (first < last) {
+    gc_bitmap_clear(bits, first++);
+  }
+
+  space->top = space->start;
+}
+
+// how old->young stores are remembered: cards, a set of sources, or not at
+// all (GC_BARRIER_NONE) and minor GC scans every edge
+static gc_barrier_type_t gc_gen_barrier_mode(const gc_t *gc) {
+  const gc_barrier_t *barrier = gc->barrier_context;
+  if (!barrier || !barrier->enabled) return GC_BARRIER_NONE;
+  if (barrier->type == GC_BARRIER_CARD_MARKING || barrier->type == GC_BARRIER_REMSET) {
+    return barrier->type;
+  }
+  return GC_BARRIER_NONE;
+}
+
+// a header the crossing map misses could never be found from its card
+static void gc_gen_record_old(gc_gen_t *gen, obj_header_t *header) {
+  if (gen->cardtable.enabled &&
+      !gc_cardtable_record_object(&gen->cardtable, header, sizeof(obj_header_t) + header->size)) {
+    gen->cards_stale = true;
+    gen->remembered = false;
+  }
+}
+
+static void gc_gen_mark_card(gc_gen_t *gen, void *from_obj) {
+  if (!gc_cardtable_mark_dirty(&gen->cardtable, from_obj)) gen->remembered = false;
+}
+
+// set up the card table anew: record every old header in its crossing map
+// and dirty the source card of every old->young edge. The table is sparse,
+// regions are committed where old objects actually live, wherever that is.
+static void gc_gen_rebuild_cards(gc_t *gc, gc_gen_t *gen) {
+  gc_cardtable_t *table = &gen->cardtable;
+  gc_cardtable_destroy(table);
+  gen->cards_stale = false;
+  gen->remembered = false;
+
+  // any card-aligned origin works, the nursery's keeps indices small
+  if (!gc_cardtable_init(table, gen->nursery_start, 0)) return;
+  gen->remembered = true;
 
-  // search young pools
   for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
-    size_class_t *sc = &gen->young_pools[i];
-    pool_block_t *block = sc->blocks;
-
-    while (block) {
-      if (gc_pool_pointer_in_block(block, ptr)) {
-        char *base = (char*) block->memory;
-        char *mem_start = (char*) ptr;
-        ptrdiff_t offset = mem_start - base;
-        size_t slot_index = offset / block->slot_size;
-        char *slot_start = base + (slot_index * block->slot_size);
-
-        obj_header_t *header = (obj_header_t*) slot_start;
-        void *expected_data_ptr = (void*)(header + 1);
-        if (expected_data_ptr == ptr) {
-          return header;
+    for (pool_block_t *block = gc->size_classes[i].blocks; block; block = block->next) {
+      char *base = (char*) block->memory;
+      for (size_t w = 0; w < block->bitmap_words; ++w) {
+        uint64_t alloc = block->alloc_bits[w];
+        while (alloc) {
+          unsigned bit = gc_bitmap_ctz(alloc);
+          alloc &= alloc - 1;
+          gc_gen_record_old(gen, (obj_header_t*)(base + (w * GC_BITMAP_WORD_BITS + bit) * block->slot_size));
         }
-        return NULL;
       }
-      block = block->next;
     }
   }
+  for (large_block_t *block = gc->large_blocks; block; block = block->next) {
+    if (block->in_use) gc_gen_record_old(gen, block->header);
+  }
+  for (huge_object_t *huge = gc->huge_objects; huge; huge = huge->next) {
+    gc_gen_record_old(gen, huge->header);
+  }
+  for (obj_header_t *obj = gc->objects; obj; obj = obj->next) {
+    gc_gen_record_old(gen, obj);
+  }
+
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) {
+    if (!gc_gen_in_nursery(gen, ref->from_obj) && gc_gen_in_nursery(gen, ref->to_obj)) {
+      gc_gen_mark_card(gen, ref->from_obj);
+    }
+  }
+}
+
+static void gc_gen_remember_source(gc_gen_t *gen, gc_barrier_type_t mode, void *from_obj) {
+  if (mode == GC_BARRIER_REMSET) {
+    if (!gc_remset_add(&gen->remset, from_obj)) gen->remembered = false;
+  } else {
+    gc_gen_mark_card(gen, from_obj);
+  }
+}
+
+// the mode a store is remembered in, with the card table brought up to date
+static gc_barrier_type_t gc_gen_remember_mode(gc_t *gc, gc_gen_t *gen) {
+  gc_barrier_type_t mode = gc_gen_barrier_mode(gc);
+  if (mode == GC_BARRIER_CARD_MARKING && (!gen->cardtable.enabled || gen->cards_stale)) {
+    gc_gen_rebuild_cards(gc, gen);
+  }
+  return mode;
+}
+
+void gc_gen_remember(gc_t *gc, void *from_obj) {
+  if (!gc || !gc->gen_context || !from_obj) return;
+
+  gc_gen_t *gen = gc->gen_context;
+  gc_barrier_type_t mode = gc_gen_remember_mode(gc, gen);
+  if (mode == GC_BARRIER_NONE) return;
+
+  gc_gen_remember_source(gen, mode, from_obj);
+}
+
+// cards the slots themselves rather than the header, the crossing map leads
+// a scan of any of those cards back to from_obj
+void gc_gen_remember_range(gc_t *gc, void *from_obj, void *start, size_t size) {
+  if (!gc || !gc->gen_context || !from_obj || !start || size == 0) return;
+
+  gc_gen_t *gen = gc->gen_context;
+  gc_barrier_type_t mode = gc_gen_remember_mode(gc, gen);
+  if (mode == GC_BARRIER_NONE) return;
+
+  if (mode == GC_BARRIER_REMSET) {
+    gc_gen_remember_source(gen, mode, from_obj);
+  } else if (!gc_cardtable_mark_range_dirty(&gen->cardtable, start, size)) {
+    gen->remembered = false;
+  }
+}
+
+// sweeping freed old objects: card starts are stale and remembered sources
+// may be gone, both are built again from the surviving edges
+void gc_gen_after_full_collection(gc_t *gc) {
+  if (!gc_gen_enabled(gc)) return;
+
+  gc_gen_t *gen = gc->gen_context;
+  gc_barrier_type_t mode = gc_gen_barrier_mode(gc);
+  gc_remset_clear(&gen->remset);
+
+  // objects that could not be promoted may fit now
+  if (gen->kept) gen->kept_retry = true;
+
+  if (mode == GC_BARRIER_CARD_MARKING) {
+    gc_gen_rebuild_cards(gc, gen);
+    return;
+  }
+
+  gc_cardtable_destroy(&gen->cardtable);
+  gen->remembered = mode == GC_BARRIER_REMSET;
+  if (mode == GC_BARRIER_REMSET) {
+    for (ref_node_t *ref = gc->references; ref; ref = ref->next) {
+      if (!gc_gen_in_nursery(gen, ref->from_obj) && gc_gen_in_nursery(gen, ref->to_obj)) {
+        gc_gen_remember_source(gen, mode, ref->from_obj);
+      }
+    }
+  }
+}
+
+void gc_gen_unpinned(gc_t *gc, void *ptr) {
+  if (!gc_gen_enabled(gc)) return;
+
+  gc_gen_t *gen = gc->gen_context;
+  if (gen->kept && gc_gen_in_nursery(gen, ptr)) gen->kept_retry = true;
+}
 
-  // search young large blocks
-  large_block_t *large = gen->young_large;
-  while (large) {
-    void *data = (void*)(large->header + 1);
-    if (data == ptr) {
-      return large->header;
+// old generation allocation for promoted and pretenured objects
+static void *gc_gen_alloc_old(gc_t *gc, obj_type_t type, size_t size) {
+  void *result = NULL;
+  if (size <= GC_SIZE_CLASS_SIZES[GC_NUM_SIZE_CLASSES - 1]) { // small object
+    size_class_t *sc = gc_pool_get_size_class(gc->size_classes, size);
+    if (sc) {
+      result = gc_pool_alloc_from_size_class(sc, type, size);
     }
-    large = large->next;
+  } else if (size >= GC_LARGE_OBJECT_THRESHOLD && size < GC_HUGE_OBJECT_THRESHOLD) { // large object
+    result = gc_large_alloc(&gc->large_blocks, &gc->large_block_count, type, size);
+  } else { // huge object
+    result = gc_huge_alloc(&gc->huge_objects, &gc->huge_object_count, type, size);
   }
 
-  return NULL;
+  if (result) {
+    obj_header_t *header = (obj_header_t*) result - 1;
+    header->generation = GC_GEN_OLD;
+    header->age = GC_PROMOTION_AGE;
+    gc_gen_record_old(gc->gen_context, header);
+  }
+  return result;
 }
 
 void *gc_gen_alloc(gc_t *gc, obj_type_t type, size_t size) {
@@ -112,20 +350,12 @@ void *gc_gen_alloc(gc_t *gc, obj_type_t type, size_t size) {
   gc_gen_t *gen = gc->gen_context;
   void *result = NULL;
 
-  size_class_t *sc = gc_pool_get_size_class(gen->young_pools, size);
-  if (sc) { // young small
-    result = gc_pool_alloc_from_size_class(sc, type, size);
+  if (size < GC_HUGE_OBJECT_THRESHOLD) {
+    result = gc_gen_nursery_alloc(gen, type, size);
     if (result) {
-      gen->young_used += sizeof(obj_header_t) + size;
       gen->stats[GC_GEN_YOUNG].objects++;
       gen->stats[GC_GEN_YOUNG].bytes_used += size;
 
-      obj_header_t *header = gc_gen_find_header_young(gc, result);
-      if (header) {
-        header->generation = GC_GEN_YOUNG;
-        header->age = 0;
-      }
-
       if (gc->trace) {
         gc_trace_event_t event = {
           .type = GC_EVENT_ALLOC,
@@ -142,19 +372,16 @@ void *gc_gen_alloc(gc_t *gc, obj_type_t type, size_t size) {
       if (!gc->heap_end || result_end > gc->heap_end) {
         gc->heap_end = result_end;
       }
+      return result;
     }
-  } else if (size >= GC_LARGE_OBJECT_THRESHOLD && size < GC_HUGE_OBJECT_THRESHOLD) { // young large
-    result = gc_large_alloc(&gen->young_large, &gen->young_large_count, type, size);
-    if (result) {
-      gen->young_used += sizeof(obj_header_t) + size;
-      gen->stats[GC_GEN_YOUNG].objects++;
-      gen->stats[GC_GEN_YOUNG].bytes_used += size;
 
-      obj_header_t *header = gc_gen_find_header_young(gc, result);
-      if (header) {
-        header->generation = GC_GEN_YOUNG;
-        header->age = 0;
-      }
+    // nursery is full, the object starts out old
+    result = gc_gen_alloc_old(gc, type, size);
+    if (result) {
+      gc->object_count++;
+      gc->heap_used += sizeof(obj_header_t) + size;
+      gen->stats[GC_GEN_OLD].objects++;
+      gen->stats[GC_GEN_OLD].bytes_used += size;
 
       if (gc->trace) {
         gc_trace_event_t event = {
@@ -173,6 +400,7 @@ void *gc_gen_alloc(gc_t *gc, obj_type_t type, size_t size) {
       if (header) {
         header->generation = GC_GEN_OLD;
         header->age = GC_PROMOTION_AGE;
+        gc_gen_record_old(gen, header);
       }
       gen->stats[GC_GEN_OLD].objects++;
       gen->stats[GC_GEN_OLD].bytes_used += size;
@@ -194,6 +422,18 @@ bool gc_gen_should_collect_minor(gc_t *gc) {
   if (!gc || !gc->gen_context) return false;
 
   gc_gen_t *gen = gc->gen_context;
+  if (gen->kept) {
+    // whatever held the nursery may be gone, try to empty it
+    if (gen->kept_retry) return true;
+
+    // what was kept cannot be dropped yet, only fresh eden allocation counts;
+    // each kept cycle leaves less room, the last of it is tenured as soon as
+    // it is used and later allocations start out old
+    size_t room = (size_t)(gen->eden.end - gen->eden.start) - gen->kept_used;
+    size_t used = gc_gen_space_used(&gen->eden) - gen->kept_used;
+    return used > 0 && (float) used >= 0.8f * (float) room;
+  }
+
   float util = (float) gen->young_used / (float) gen->young_capacity;
   return util >= 0.8f;
 }
@@ -206,358 +446,404 @@ bool gc_gen_should_collect_major(gc_t *gc) {
   return gen->minor_count > 0 && gen->minor_count % 10 == 0;
 }
 
-static bool gc_gen_promote_object(gc_t *gc, obj_header_t *header, void *data) {
-  if (!gc || !header || !data) return false;
+static void gc_gen_record_promotion(gc_t *gc, gc_gen_t *gen, void *data, size_t size) {
+  gen->stats[GC_GEN_YOUNG].promotions++;
+  gen->stats[GC_GEN_OLD].objects++;
+  gen->stats[GC_GEN_OLD].bytes_used += size;
 
-  // allocate directly in old generation
-  void *promoted = NULL;
-  if (header->size <= GC_SIZE_CLASS_SIZES[GC_NUM_SIZE_CLASSES - 1]) { // small object
-    size_class_t *sc = gc_pool_get_size_class(gc->size_classes, header->size);
-    if (sc) {
-      promoted = gc_pool_alloc_from_size_class(sc, header->type, header->size);
+  if (gc->trace) {
+    gc_trace_event_t event = {
+      .type = GC_EVENT_PROMOTION,
+      .data.promotion = {data, GC_GEN_YOUNG, GC_GEN_OLD},
+    };
+    gc_trace_event(gc, &event);
+  }
+}
+
+typedef struct gc_gen_evac {
+  gc_gen_space_t *to;  // empty survivor space receiving young copies, NULL tenures all
+
+  // gray worklist: original addresses of copied objects whose edges have
+  // not been followed yet; when it cannot grow, an edge rescan recovers
+  void **gray;
+  size_t gray_count;
+  size_t gray_capacity;
+  bool overflowed;
+
+  // every edge, sorted by source
+  ref_node_t **edges;
+  size_t edge_count;
+
+  size_t survived;
+  size_t survived_bytes;
+  size_t promoted;
+  size_t promoted_bytes;
+  size_t retained;
+  size_t retained_bytes;
+} gc_gen_evac_t;
+
+static void gc_gen_gray_push(gc_gen_evac_t *ev, void *data) {
+  if (ev->gray_count == ev->gray_capacity) {
+    size_t capacity = ev->gray_capacity ? ev->gray_capacity * 2 : 64;
+    void **gray = (void**) realloc(ev->gray, sizeof(void*) * capacity);
+    if (!gray) {
+      ev->overflowed = true;
+      return;
     }
-  } else if (header->size >= GC_LARGE_OBJECT_THRESHOLD && header->size < GC_HUGE_OBJECT_THRESHOLD) { // large object
-    promoted = gc_large_alloc(&gc->large_blocks, &gc->large_block_count, header->type, header->size);
-  } else { // huge object
-    promoted = gc_huge_alloc(&gc->huge_objects, &gc->huge_object_count, header->type, header->size);
+    ev->gray = gray;
+    ev->gray_capacity = capacity;
   }
+  ev->gray[ev->gray_count++] = data;
+}
 
-  if (!promoted) return false;
+// a pinned object, or one the old generation has no room for, survives
+// where it is and the space holding it is kept past the flip
+static void *gc_gen_retain(gc_gen_evac_t *ev, obj_header_t *header, void *data) {
+  header->forwarded = GC_FORWARD_RETAINED;
+  ev->retained++;
+  ev->retained_bytes += header->size;
+  gc_gen_gray_push(ev, data);
+  return data;
+}
+
+// copy a young object out of eden or the from space and leave a forwarding
+// pointer behind; it stays young in the to space until it is old enough or
+// the to space is full, then it is tenured into the old generation.
+// Anything that is not an uncopied young object comes back unchanged.
+static void *gc_gen_evacuate(gc_t *gc, gc_gen_t *gen, gc_gen_evac_t *ev, void *data) {
+  if (ev->to && gc_gen_space_contains(ev->to, data)) return data;
+
+  obj_header_t *header = gc_gen_nursery_header(gen, data);
+  if (!header) return data;
+  if (header->forwarded == GC_FORWARD_COPIED) return header->forward;
+  if (header->forwarded == GC_FORWARD_RETAINED) return data;
+  if (header->pinned) return gc_gen_retain(ev, header, data);
+
+  unsigned char age = header->age + 1;
+  size_t size = header->size;
+  obj_header_t *copy = NULL;
+
+  if (ev->to && age < GC_PROMOTION_AGE) {
+    copy = gc_gen_space_bump(gen, ev->to, size);
+    if (copy) {
+      memcpy(copy, header, sizeof(obj_header_t) + size);
+      copy->age = age;
+      copy->marked = false;
+      ev->survived++;
+      ev->survived_bytes += size;
+    }
+  }
 
-  memcpy(promoted, data, header->size);
+  if (!copy) {
+    void *promoted = gc_gen_alloc_old(gc, header->type, size);
+    if (!promoted) return gc_gen_retain(ev, header, data);  // out of memory
 
-  // get the new header and set generation
-  obj_header_t *new_header = simple_gc_find_header(gc, promoted);
-  if (new_header) {
-    new_header->generation = GC_GEN_OLD;
-    new_header->age = GC_PROMOTION_AGE;
-    new_header->marked = false;
-    new_header->type = header->type;
-    new_header->size = header->size;
+    copy = (obj_header_t*) promoted - 1;
+    memcpy(promoted, data, size);
+    copy->marked = false;
+    copy->handle = header->handle;
+
+    gc->object_count++;
+    gc->heap_used += sizeof(obj_header_t) + size;
+    ev->promoted++;
+    ev->promoted_bytes += size;
+    gc_gen_record_promotion(gc, gen, promoted, size);
   }
 
-  // update references to new location
-  ref_node_t *ref = gc->references;
-  while (ref) {
-    if (ref->to_obj == data) {
-      ref->to_obj = promoted;
-    }
-    if (ref->from_obj == data) {
-      ref->from_obj = promoted;
-    }
-    ref = ref->next;
+  // a handle follows the object
+  gc_handle_relocate(copy);
+
+  header->forwarded = GC_FORWARD_COPIED;
+  header->forward = (void*)(copy + 1);
+  gc_gen_gray_push(ev, data);
+  return header->forward;
+}
+
+static int gc_gen_edge_compare(const void *a, const void *b) {
+  const ref_node_t *ea = *(const ref_node_t* const*) a;
+  const ref_node_t *eb = *(const ref_node_t* const*) b;
+
+  if (ea->from_obj == eb->from_obj) return 0;
+  return (uintptr_t) ea->from_obj > (uintptr_t) eb->from_obj ? 1 : -1;
+}
+
+// index the edges by source once per minor collection, gray objects and
+// objects on dirty cards both look theirs up
+static void gc_gen_index_edges(gc_t *gc, gc_gen_evac_t *ev) {
+  size_t count = 0;
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) ++count;
+  if (count == 0) return;
+
+  ev->edges = (ref_node_t**) malloc(sizeof(ref_node_t*) * count);
+  if (!ev->edges) {
+    ev->overflowed = true;
+    return;
   }
 
-  // update roots
-  for (size_t i = 0; i < gc->root_count; ++i) {
-    if (gc->roots[i] == data) {
-      gc->roots[i] = promoted;
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) {
+    ev->edges[ev->edge_count++] = ref;
+  }
+  qsort(ev->edges, ev->edge_count, sizeof(ref_node_t*), gc_gen_edge_compare);
+}
+
+// first edge leaving ptr
+static size_t gc_gen_first_edge(const gc_gen_evac_t *ev, const void *ptr) {
+  size_t lo = 0;
+  size_t hi = ev->edge_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if ((uintptr_t) ev->edges[mid]->from_obj < (uintptr_t) ptr) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+// pop gray objects and copy what they reference, each young edge is
+// followed once
+static void gc_gen_drain(gc_t *gc, gc_gen_t *gen, gc_gen_evac_t *ev) {
+  while (ev->gray_count > 0) {
+    void *data = ev->gray[--ev->gray_count];
+    if (!ev->edges) continue;  // only the rescan can find its edges
+
+    for (size_t i = gc_gen_first_edge(ev, data);
+        i < ev->edge_count && ev->edges[i]->from_obj == data; ++i) {
+      gc_gen_evacuate(gc, gen, ev, ev->edges[i]->to_obj);
     }
   }
+}
 
-  gc->object_count++;
-  gc->heap_used += sizeof(obj_header_t) + header->size;
+// objects dropped from a full worklist are copied but unscanned: a forwarded
+// source with an uncopied young target finds them again
+static bool gc_gen_recover_overflow(gc_t *gc, gc_gen_t *gen, gc_gen_evac_t *ev) {
+  if (!ev->overflowed) return false;
 
+  ev->overflowed = false;
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) {
+    obj_header_t *from_header = gc_gen_nursery_header(gen, ref->from_obj);
+    if (from_header && from_header->forwarded) {
+      gc_gen_evacuate(gc, gen, ev, ref->to_obj);
+    }
+  }
   return true;
 }
 
-static void gc_gen_record_promotion(gc_t *gc, gc_gen_t *gen, void *data, size_t size) {
-  gen->stats[GC_GEN_YOUNG].promotions++;
-  gen->stats[GC_GEN_OLD].objects++;
-  gen->stats[GC_GEN_OLD].bytes_used += size;
+typedef struct gc_gen_minor_ctx {
+  gc_t *gc;
+  gc_gen_t *gen;
+  gc_gen_evac_t *ev;
+} gc_gen_minor_ctx_t;
+
+// an edge recorded for an array slot carries the new address into the slot,
+// unless the slot was overwritten since
+static void gc_gen_retarget(ref_node_t *ref, void *to_obj) {
+  if (ref->slot != GC_REF_NO_SLOT && to_obj != ref->to_obj) {
+    void **slot = (void**) ref->from_obj + ref->slot;
+    if (*slot == ref->to_obj) *slot = to_obj;
+  }
+  ref->to_obj = to_obj;
+}
 
-  if (gc->trace) {
-    gc_trace_event_t event = {
-      .type = GC_EVENT_PROMOTION,
-      .data.promotion = {data, GC_GEN_YOUNG, GC_GEN_OLD},
-    };
-    gc_trace_event(gc, &event);
+// copy the young targets of an old object's edges
+static void gc_gen_scan_old_source(gc_t *gc, void *data, void *user_data) {
+  gc_gen_minor_ctx_t *ctx = (gc_gen_minor_ctx_t*) user_data;
+  gc_gen_evac_t *ev = ctx->ev;
+
+  for (size_t i = gc_gen_first_edge(ev, data);
+      i < ev->edge_count && ev->edges[i]->from_obj == data; ++i) {
+    gc_gen_retarget(ev->edges[i], gc_gen_evacuate(gc, ctx->gen, ev, ev->edges[i]->to_obj));
   }
 }
 
-static bool gc_gen_try_promote(gc_t *gc, gc_gen_t *gen, obj_header_t *header, size_t *promoted_count) {
-  void *data = (void*)(header + 1);
-  void *old_data = data;  // memo old pointer for trace
+static void gc_gen_scan_old_object(gc_t *gc, void *header, void *user_data) {
+  gc_gen_scan_old_source(gc, (void*)((obj_header_t*) header + 1), user_data);
+}
 
-  if (gc_gen_promote_object(gc, header, data)) {
-    (*promoted_count)++;
+// only the old objects overlapping the card, found through the crossing map
+static void gc_gen_scan_card(gc_t *gc, void *card_start, void *card_end, void *user_data) {
+  if (!gc || !card_start || !card_end || !user_data) return;
 
-    // get new pointer, may have changed due to reference updates
-    void *new_data = old_data;
-    for (size_t i = 0; i < gc->root_count; ++i) {
-      if (gc->roots[i] != old_data) {
+  gc_gen_minor_ctx_t *ctx = (gc_gen_minor_ctx_t*) user_data;
+  gc_cardtable_for_each_object(gc, &ctx->gen->cardtable, card_start, gc_gen_scan_old_object, ctx);
+}
 
-        // root was updated, find the new location
-        obj_header_t *check = simple_gc_find_header(gc, gc->roots[i]);
-        if (check && check->generation == GC_GEN_OLD && check->size == header->size) {
-          new_data = gc->roots[i];
-          break;
-        }
+static void gc_gen_evacuate_handle(gc_handle_t handle, void *ctx) {
+  gc_gen_minor_ctx_t *minor = (gc_gen_minor_ctx_t*) ctx;
+  // relocation through the header rewrites the slot
+  gc_gen_evacuate(minor->gc, minor->gen, minor->ev, *handle);
+}
+
+// address an edge endpoint has after the copy, NULL once it died young
+static void *gc_gen_forwarded(gc_gen_t *gen, gc_gen_evac_t *ev, void *ptr) {
+  if (!gc_gen_in_nursery(gen, ptr)) return ptr;
+  if (ev->to && gc_gen_space_contains(ev->to, ptr)) return ptr;
+
+  obj_header_t *header = gc_gen_nursery_header(gen, ptr);
+  if (!header) return NULL;
+  if (header->forwarded == GC_FORWARD_RETAINED) return ptr;
+  return header->forwarded == GC_FORWARD_COPIED ? header->forward : NULL;
+}
+
+static void gc_gen_track_dead(gc_t *gc, gc_gen_t *gen, gc_gen_space_t *space) {
+  size_t first = gc_gen_nursery_index(gen, (obj_header_t*) space->start);
+  size_t last = gc_gen_nursery_index(gen, (obj_header_t*) space->top);
+
+  for (size_t i = first; i < last; ++i) {
+    if (gc_bitmap_test(gen->nursery_starts, i)) {
+      obj_header_t *header = (obj_header_t*)(gen->nursery_start + i * GC_NURSERY_ALIGN);
+      if (!header->forwarded) {
+        gc_debug_track_free(gc, (void*)(header + 1));
       }
     }
-
-    gc_gen_record_promotion(gc, gen, new_data, header->size);
-    return true;
   }
-  return false;
 }
 
-static void gc_gen_scan_card(gc_t *gc, void *card_start, void *card_end, void *user_data) {
-  if (!gc || !card_start || !card_end) return;
-
-  (void)user_data;
-
-  // scan all objects in card range
-  obj_header_t *obj = gc->objects;
-  while (obj) {
-    void *obj_ptr = (void *)(obj + 1);
-
-    // check if object is in card range and in old gen
-    if (obj_ptr >= card_start && obj_ptr < card_end && obj->generation == GC_GEN_OLD) {
-      // scan references from this object
-      ref_node_t *ref = gc->references;
-      while (ref) {
-        if (ref->from_obj == obj_ptr) {
-          obj_header_t *to_header = simple_gc_find_header(gc, ref->to_obj);
-          if (to_header && to_header->generation == GC_GEN_YOUNG) {
-            // found old->young reference, mark young object
-            gc_mark_object(gc, ref->to_obj);
-          }
-        }
-        ref = ref->next;
+// retained objects are ordinary young objects again for the next cycle
+static void gc_gen_space_unretain(gc_gen_t *gen, gc_gen_space_t *space) {
+  size_t first = gc_gen_nursery_index(gen, (obj_header_t*) space->start);
+  size_t last = gc_gen_nursery_index(gen, (obj_header_t*) space->top);
+
+  for (size_t i = first; i < last; ++i) {
+    if (gc_bitmap_test(gen->nursery_starts, i)) {
+      obj_header_t *header = (obj_header_t*)(gen->nursery_start + i * GC_NURSERY_ALIGN);
+      if (header->forwarded == GC_FORWARD_RETAINED) {
+        header->forwarded = 0;
       }
     }
-
-    obj = obj->next;
   }
 }
 
+// copying collection of the nursery: roots, handles and old->young edges
+// copy their young targets into the empty survivor space (or tenure them),
+// a gray worklist pulls in what the copies reference, then eden and the
+// from space are dropped wholesale. Dead objects are never visited.
+// Pinned objects and objects the old generation cannot take stay in place,
+// then no space is dropped until a later cycle leaves nothing behind.
 void gc_gen_collect_minor(gc_t *gc) {
   if (!gc || !gc->gen_context) return;
 
   gc_gen_t *gen = gc->gen_context;
 
-  clock_t start = clock();
   size_t objects_before = gen->stats[GC_GEN_YOUNG].objects;
   size_t bytes_before = gen->stats[GC_GEN_YOUNG].bytes_used;
-  size_t promoted_count = 0;
-  size_t collected_count = 0;
 
   if (gc->trace) {
     GC_TRACE_COLLECT_START(gc, "minor", objects_before, bytes_before);
   }
-
-  // mark roots that point to young generation
-  for (size_t i = 0; i < gc->root_count; ++i) {
-    obj_header_t *header = gc_gen_find_header_young(gc, gc->roots[i]);
-    if (header && header->generation == GC_GEN_YOUNG) {
-      header->marked = true;
-    }
+  gc_report_begin(gc, "minor");
+  uint64_t phase_start = gc_report_now_us();
+
+  gc_gen_space_t *from = &gen->survivor[gen->survivor_from];
+  gc_gen_space_t *other = &gen->survivor[1 - gen->survivor_from];
+  gc_gen_evac_t ev = {0};
+  ev.to = gen->kept ? NULL : other;
+  gen->kept_retry = false;
+  gc_gen_minor_ctx_t ctx = {gc, gen, &ev};
+  gc_barrier_type_t mode = gc_gen_barrier_mode(gc);
+  if (mode == GC_BARRIER_CARD_MARKING && (!gen->cardtable.enabled || gen->cards_stale)) {
+    gc_gen_rebuild_cards(gc, gen);
   }
+  gc_gen_index_edges(gc, &ev);
+  bool indexed = !ev.overflowed;
 
-  if (gen->cardtable.enabled) {
-    gc_cardtable_scan_dirty(gc, &gen->cardtable, gc_gen_scan_card, NULL);
+  // copy objects held by roots and handles
+  for (size_t i = 0; i < gc->root_count; ++i) {
+    gc->roots[i] = gc_gen_evacuate(gc, gen, &ev, gc->roots[i]);
   }
-
-  // mark young objects referenced by old generation
-  ref_node_t *ref = gc->references;
-  while (ref) {
-    obj_header_t *from_header = simple_gc_find_header(gc, ref->from_obj);
-
-    if (from_header && from_header->generation == GC_GEN_OLD) {
-      obj_header_t *to_header = gc_gen_find_header_young(gc, ref->to_obj);
-
-      if (to_header && to_header->generation == GC_GEN_YOUNG) {
-        to_header->marked = true;
+  gc_handle_for_each(gc->handles, gc_gen_evacuate_handle, &ctx);
+
+  // copy young objects referenced by old generation: dirty cards or the
+  // remembered set hold every such source unless recording one ran out of
+  // memory, then all edges are scanned
+  ref_node_t *ref;
+  bool remembered = gen->remembered && indexed;
+  if (remembered && mode == GC_BARRIER_CARD_MARKING) {
+    gc_cardtable_scan_dirty(gc, &gen->cardtable, gc_gen_scan_card, &ctx);
+  } else if (remembered && mode == GC_BARRIER_REMSET) {
+    gc_remset_for_each(gc, &gen->remset, gc_gen_scan_old_source, &ctx);
+  } else {
+    if (gen->cardtable.enabled) {
+      gc_cardtable_clear(&gen->cardtable);
+    }
+    for (ref = gc->references; ref; ref = ref->next) {
+      if (!gc_gen_in_nursery(gen, ref->from_obj)) {
+        gc_gen_retarget(ref, gc_gen_evacuate(gc, gen, &ev, ref->to_obj));
       }
     }
-    ref = ref->next;
   }
 
-  // transitive marking within young generation
-  bool marked_something;
+  uint64_t copy_start = gc_report_now_us();
+  gc_report_phase(gc, GC_PHASE_ROOTS, copy_start - phase_start);
+
+  // transitive copying from the gray worklist
   do {
-    marked_something = false;
-    ref = gc->references;
-    while (ref) {
-      obj_header_t *from_header = gc_gen_find_header_young(gc, ref->from_obj);
-      obj_header_t *to_header = gc_gen_find_header_young(gc, ref->to_obj);
-
-      if (from_header && to_header &&
-          from_header->generation == GC_GEN_YOUNG &&
-          to_header->generation == GC_GEN_YOUNG &&
-          from_header->marked && !to_header->marked) {
-        to_header->marked = true;
-        marked_something = true;
-      }
-      ref = ref->next;
+    gc_gen_drain(gc, gen, &ev);
+  } while (gc_gen_recover_overflow(gc, gen, &ev) || ev.gray_count > 0);
+  free(ev.gray);
+  free(ev.edges);
+
+  phase_start = gc_report_now_us();
+  gc_report_phase(gc, GC_PHASE_MARK, phase_start - copy_start);
+
+  // one pass moves every edge to the copies; edges of dead objects go away
+  // and surviving old->young edges are remembered for the next cycle
+  gc_remset_clear(&gen->remset);
+  gen->remembered = mode == GC_BARRIER_REMSET ||
+    (mode == GC_BARRIER_CARD_MARKING && gen->cardtable.enabled && !gen->cards_stale);
+  gc->slot_index.valid = false;
+  ref_node_t **link = &gc->references;
+  while (*link) {
+    ref = *link;
+    void *from_obj = gc_gen_forwarded(gen, &ev, ref->from_obj);
+    void *to_obj = gc_gen_forwarded(gen, &ev, ref->to_obj);
+    if (!from_obj || !to_obj) {
+      gc_ref_unlink(ref);
+      free(ref);
+      continue;
     }
-  } while (marked_something);
-
-  // sweep young pools - TWO PHASE to avoid corrupting during iteration
-  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
-    size_class_t *sc = &gen->young_pools[i];
-    pool_block_t *block = sc->blocks;
-
-    while (block) {
-      // Phase 1: Collect objects to free/promote (don't modify free list yet)
-      typedef struct {
-        obj_header_t *header;
-        bool should_promote;
-        size_t size;
-      } young_action_t;
-
-      young_action_t actions[block->capacity];
-      size_t action_count = 0;
-
-      char *slot = (char*) block->memory;
-      for (size_t j = 0; j < block->capacity; ++j) {
-        obj_header_t *header = (obj_header_t*) slot;
-
-        // check if slot is in use
-        bool in_use = true;
-        free_node_t *free_node = block->free_list;
-        while (free_node) {
-          if ((void*) free_node == (void*) header) {
-            in_use = false;
-            break;
-          }
-          free_node = free_node->next;
-        }
-
-        if (in_use && header->generation == GC_GEN_YOUNG) {
-          if (!header->marked) {
-            // died young - will free it
-            actions[action_count].header = header;
-            actions[action_count].should_promote = false;
-            actions[action_count].size = header->size;
-            action_count++;
-          } else {
-            // survived - increment age
-            header->age++;
-
-            if (header->age >= GC_PROMOTION_AGE) {
-              // will try to promote
-              actions[action_count].header = header;
-              actions[action_count].should_promote = true;
-              actions[action_count].size = header->size;
-              action_count++;
-            } else {
-              // not old enough - unmark for next cycle
-              header->marked = false;
-            }
-          }
-        }
-
-        slot += block->slot_size;
-      }
-
-      // Phase 2: Execute actions (safe to modify free list now)
-      for (size_t k = 0; k < action_count; ++k) {
-        obj_header_t *header = actions[k].header;
-        size_t size = actions[k].size;
-
-        if (actions[k].should_promote) {
-          // try to promote
-          if (gc_gen_try_promote(gc, gen, header, &promoted_count)) {
-            // promotion succeeded
-            gen->young_used -= sizeof(obj_header_t) + size;
-            gen->stats[GC_GEN_YOUNG].objects--;
-            gen->stats[GC_GEN_YOUNG].bytes_used -= size;
-
-            // free from young gen
-            gc_pool_free_to_block(block, sc, header);
-          } else {
-            // promotion failed - unmark for next cycle
-            header->marked = false;
-          }
-        } else {
-          // died young - free it
-          if (gc->debug) {
-            void *data_ptr = (void*)(header + 1);
-            gc_debug_track_free(gc, data_ptr);
-          }
-
-          // update stats before freeing
-          gen->young_used -= sizeof(obj_header_t) + size;
-          gen->stats[GC_GEN_YOUNG].objects--;
-          gen->stats[GC_GEN_YOUNG].bytes_used -= size;
-          collected_count++;
-
-          // now safe to free
-          gc_pool_free_to_block(block, sc, header);
-        }
-      }
-
-      block = block->next;
+    ref->from_obj = from_obj;
+    gc_gen_retarget(ref, to_obj);
+    if (gen->remembered && !gc_gen_in_nursery(gen, from_obj) && gc_gen_in_nursery(gen, to_obj)) {
+      gc_gen_remember_source(gen, mode, from_obj);
     }
+    link = &ref->next;
   }
 
-  // sweep young large blocks (this part looks OK)
-  large_block_t *large = gen->young_large;
-  large_block_t *prev_large = NULL;
-
-  while (large) {
-    if (large->in_use && large->header && large->header->generation == GC_GEN_YOUNG) {
-      if (!large->header->marked) {
-        // died young
-        if (gc->debug) {
-          void *data_ptr = (void*)(large->header + 1);
-          gc_debug_track_free(gc, data_ptr);
-        }
-
-        large->in_use = false;
-        collected_count++;
-        gen->young_used -= sizeof(obj_header_t) + large->header->size;
-        gen->stats[GC_GEN_YOUNG].objects--;
-        gen->stats[GC_GEN_YOUNG].bytes_used -= large->header->size;
-
-        prev_large = large;
-        large = large->next;
-      } else {
-        // survived
-        large->header->age++;
-
-        if (large->header->age >= GC_PROMOTION_AGE) {
-          // try to promote
-          if (gc_gen_try_promote(gc, gen, large->header, &promoted_count)) {
-            // promotion succeeded
-            gen->young_used -= sizeof(obj_header_t) + large->header->size;
-            gen->stats[GC_GEN_YOUNG].objects--;
-            gen->stats[GC_GEN_YOUNG].bytes_used -= large->header->size;
-
-            // remove from young large list
-            if (prev_large) {
-              prev_large->next = large->next;
-            } else {
-              gen->young_large = large->next;
-            }
-
-            large_block_t *to_free = large;
-            large = large->next;
-            gen->young_large_count--;
-            gc_large_free_block(to_free);
-            continue;
-          } else {
-            // promotion failed
-            large->header->marked = false;
-          }
-        } else {
-          // not old enough
-          large->header->marked = false;
-        }
-
-        prev_large = large;
-        large = large->next;
-      }
-    } else {
-      prev_large = large;
-      large = large->next;
+  if (ev.retained > 0) {
+    // something stayed behind: every space is kept, the copies in the to
+    // space are the current survivors
+    gc_gen_space_unretain(gen, &gen->eden);
+    gc_gen_space_unretain(gen, from);
+    gc_gen_space_unretain(gen, other);
+    if (ev.to) gen->survivor_from = 1 - gen->survivor_from;
+    gen->kept = true;
+    gen->kept_used = gc_gen_space_used(&gen->eden);
+  } else {
+    if (gc->debug) {
+      gc_gen_track_dead(gc, gen, &gen->eden);
+      gc_gen_track_dead(gc, gen, from);
+      if (gen->kept) gc_gen_track_dead(gc, gen, other);
     }
+
+    // flip: eden and the from space are empty, the to space holds survivors;
+    // after a kept nursery everything was tenured and all of it is empty
+    gc_gen_space_reset(gen, &gen->eden);
+    gc_gen_space_reset(gen, from);
+    if (gen->kept) gc_gen_space_reset(gen, other);
+    else gen->survivor_from = 1 - gen->survivor_from;
+    gen->kept = false;
   }
+  gc_gen_update_young_used(gen);
 
-  clock_t end = clock();
-  double duration = (double)(end - start) / CLOCKS_PER_SEC * 1000.0;
+  size_t collected_count = objects_before - ev.survived - ev.promoted - ev.retained;
+  gen->stats[GC_GEN_YOUNG].objects = ev.survived + ev.retained;
+  gen->stats[GC_GEN_YOUNG].bytes_used = ev.survived_bytes + ev.retained_bytes;
+
+  // the dropped spaces are the sweep of a copying collection
+  gc_report_phase(gc, GC_PHASE_SWEEP, gc_report_now_us() - phase_start);
+  gc_report_reclaim(gc, GC_TIER_NURSERY, -1, collected_count,
+      bytes_before - ev.survived_bytes - ev.promoted_bytes - ev.retained_bytes);
+  gc_report_end(gc);
+  double duration = (double) gc_report_last(gc)->total_us / 1000.0;
 
   gen->minor_count++;
   gen->stats[GC_GEN_YOUNG].collections++;
@@ -568,7 +854,7 @@ void gc_gen_collect_minor(gc_t *gc) {
         gen->stats[GC_GEN_YOUNG].objects,
         gen->stats[GC_GEN_YOUNG].bytes_used,
         collected_count,
-        promoted_count,
+        ev.promoted,
         duration);
   }
 
@@ -582,7 +868,7 @@ void gc_gen_collect_major(gc_t *gc) {
 
   gc_gen_t *gen = gc->gen_context;
 
-  clock_t start = clock();
+  uint64_t start = gc_report_now_us();
   size_t objects_before = gen->stats[GC_GEN_OLD].objects;
   size_t bytes_before = gen->stats[GC_GEN_OLD].bytes_used;
 
@@ -592,12 +878,7 @@ void gc_gen_collect_major(gc_t *gc) {
 
   simple_gc_collect(gc);
 
-  if (gen->cardtable.enabled) {
-    gc_cardtable_clear(&gen->cardtable);
-  }
-
-  clock_t end = clock();
-  double duration = (double)(end - start) / CLOCKS_PER_SEC * 1000.0;
+  double duration = (double)(gc_report_now_us() - start) / 1000.0;
 
   gen->major_count++;
   gen->stats[GC_GEN_OLD].collections++;
@@ -617,32 +898,7 @@ void gc_gen_collect_major(gc_t *gc) {
 
 gc_generation_id_t gc_gen_which_generation(gc_t *gc, void *ptr) {
   if (!gc || !gc->gen_context || !ptr) return GC_GEN_OLD;
-
-  // young pools
-  gc_gen_t *gen = gc->gen_context;
-  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
-    size_class_t *sc = &gen->young_pools[i];
-    pool_block_t *block = sc->blocks;
-
-    while (block) {
-      if (gc_pool_pointer_in_block(block, ptr)) {
-        return GC_GEN_YOUNG;
-      }
-      block = block->next;
-    }
-  }
-
-  // young large blocks
-  large_block_t *large = gen->young_large;
-  while (large) {
-    void *check = (void*)(large->header + 1);
-    if (check == ptr) {
-      return GC_GEN_YOUNG;
-    }
-    large = large->next;
-  }
-
-  return GC_GEN_OLD;
+  return gc_gen_in_nursery(gc->gen_context, ptr) ? GC_GEN_YOUNG : GC_GEN_OLD;
 }
 
 size_t gc_gen_young_size(gc_t *gc) {
@@ -702,6 +958,9 @@ void gc_gen_print_stats(gc_t *gc) {
   if (gen->cardtable.enabled) {
     gc_cardtable_print_stats(&gen->cardtable);
   }
+  if (gen->remset.capacity > 0) {
+    gc_remset_print_stats(&gen->remset);
+  }
 
   printf("==================================\n\n");
 }
@@ -0,0 +1,90 @@
+#include "gc_handle.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+
+#define GC_HANDLE_FREE_TAG ((uintptr_t) 1)
+
+static inline void *gc_handle_tag(void **next) {
+  return (void*) ((uintptr_t) next | GC_HANDLE_FREE_TAG);
+}
+
+static inline void **gc_handle_untag(void *value) {
+  return (void**) ((uintptr_t) value & ~GC_HANDLE_FREE_TAG);
+}
+
+bool gc_handle_table_init(gc_handle_table_t *table) {
+  if (!table) return false;
+
+  table->chunks = NULL;
+  table->free_list = NULL;
+  table->count = 0;
+  table->capacity = 0;
+  return true;
+}
+
+void gc_handle_table_destroy(gc_handle_table_t *table) {
+  if (!table) return;
+
+  gc_handle_chunk_t *chunk = table->chunks;
+  while (chunk) {
+    gc_handle_chunk_t *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  table->chunks = NULL;
+  table->free_list = NULL;
+  table->count = 0;
+  table->capacity = 0;
+}
+
+static bool gc_handle_grow(gc_handle_table_t *table) {
+  gc_handle_chunk_t *chunk = (gc_handle_chunk_t*) malloc(sizeof(gc_handle_chunk_t));
+  if (!chunk) return false;
+
+  // chain back to front so handles are handed out in address order
+  for (size_t i = GC_HANDLE_CHUNK_SLOTS; i > 0; --i) {
+    chunk->slots[i - 1] = gc_handle_tag(table->free_list);
+    table->free_list = &chunk->slots[i - 1];
+  }
+
+  chunk->next = table->chunks;
+  table->chunks = chunk;
+  table->capacity += GC_HANDLE_CHUNK_SLOTS;
+  return true;
+}
+
+gc_handle_t gc_handle_new(gc_handle_table_t *table, void *ptr) {
+  if (!table || !gc_handle_is_live(ptr)) return NULL;
+
+  if (!table->free_list && !gc_handle_grow(table)) return NULL;
+
+  void **slot = table->free_list;
+  table->free_list = gc_handle_untag(*slot);
+  *slot = ptr;
+  table->count++;
+  return slot;
+}
+
+void gc_handle_free(gc_handle_table_t *table, gc_handle_t handle) {
+  if (!table || !handle || !gc_handle_is_live(*handle)) return;
+
+  *handle = gc_handle_tag(table->free_list);
+  table->free_list = handle;
+  table->count--;
+}
+
+void gc_handle_for_each(gc_handle_table_t *table,
+    void (*visit)(gc_handle_t handle, void *ctx), void *ctx) {
+  if (!table || !visit) return;
+
+  gc_handle_chunk_t *chunk = table->chunks;
+  while (chunk) {
+    for (size_t i = 0; i < GC_HANDLE_CHUNK_SLOTS; ++i) {
+      if (gc_handle_is_live(chunk->slots[i])) {
+        visit(&chunk->slots[i], ctx);
+      }
+    }
+    chunk = chunk->next;
+  }
+}
@@ -0,0 +1,140 @@
+#include "gc_incremental.h"
+#include "simple_gc.h"
+#include "gc_mark.h"
+#include "gc_sweep.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+static uint64_t gc_inc_now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000ULL + (uint64_t) ts.tv_nsec / 1000ULL;
+}
+
+bool gc_incremental_init(gc_t *gc) {
+  if (!gc) return false;
+  if (gc->incremental) return true;
+
+  gc_incremental_t *inc = (gc_incremental_t*) calloc(1, sizeof(gc_incremental_t));
+  if (!inc) return false;
+
+  inc->phase = GC_INC_IDLE;
+  inc->budget_us = GC_INCREMENTAL_DEFAULT_BUDGET_US;
+  memset(&inc->stats, 0, sizeof(gc_incremental_stats_t));
+
+  gc->incremental = inc;
+  return true;
+}
+
+void gc_incremental_destroy(gc_t *gc) {
+  if (!gc || !gc->incremental) return;
+
+  free(gc->incremental);
+  gc->incremental = NULL;
+}
+
+bool gc_incremental_marking(const gc_t *gc) {
+  return (gc && gc->incremental && gc->incremental->phase == GC_INC_MARKING);
+}
+
+void gc_incremental_shade(gc_t *gc, void *ptr) {
+  if (!gc_incremental_marking(gc) || !ptr) return;
+
+  gc_mark_shade(gc, ptr);
+}
+
+void gc_incremental_start(gc_t *gc) {
+  if (!gc || !gc->incremental || gc_incremental_marking(gc)) return;
+
+  // live objects in unswept blocks still carry the last cycle's mark
+  gc_sweep_finish(gc);
+
+  gc_incremental_t *inc = gc->incremental;
+  inc->phase = GC_INC_MARKING;
+  gc_mark_stack_clear(&gc->mark_stack);
+  inc->cycle_objects_before = gc->object_count;
+  inc->cycle_pause_us = 0;
+  inc->stats.cycles++;
+
+  gc_mark_shade_roots(gc);
+}
+
+size_t gc_incremental_mark(gc_t *gc, size_t max_objects) {
+  if (!gc_incremental_marking(gc)) return 0;
+
+  size_t scanned = gc_mark_drain(gc, max_objects);
+  gc->incremental->stats.objects_scanned += scanned;
+  return scanned;
+}
+
+// the mark stack is empty; roots are not barriered so rescan them (and any
+// objects that overflowed the stack) before declaring marking complete
+static bool gc_inc_try_terminate(gc_t *gc) {
+  gc_incremental_t *inc = gc->incremental;
+
+  gc_mark_recover_overflow(gc);
+  gc_mark_shade_roots(gc);
+  if (gc->mark_stack.count > 0) return false;
+
+  if (gc->auto_root_scan_enabled) {
+    simple_gc_scan_stack(gc);
+  }
+
+  inc->phase = GC_INC_IDLE;
+  return true;
+}
+
+bool gc_incremental_step(gc_t *gc, size_t budget_us) {
+  if (!gc || !gc->incremental) return false;
+
+  gc_incremental_t *inc = gc->incremental;
+  uint64_t start = gc_inc_now_us();
+  uint64_t deadline = start + budget_us;
+  bool done = false;
+
+  if (inc->phase == GC_INC_IDLE) {
+    gc_incremental_start(gc);
+  }
+
+  inc->stats.steps++;
+
+  for (;;) {
+    gc_incremental_mark(gc, GC_INCREMENTAL_CHECK_INTERVAL);
+
+    if (gc->mark_stack.count == 0 && gc_inc_try_terminate(gc)) {
+      done = true;
+      break;
+    }
+    if (budget_us != GC_INCREMENTAL_UNBOUNDED && gc_inc_now_us() >= deadline) {
+      break;
+    }
+  }
+
+  uint64_t elapsed = gc_inc_now_us() - start;
+  inc->cycle_pause_us += elapsed;
+  inc->stats.last_step_us = elapsed;
+  if (elapsed > inc->stats.max_step_us) {
+    inc->stats.max_step_us = elapsed;
+  }
+
+  return done;
+}
+
+void gc_incremental_abort(gc_t *gc) {
+  if (!gc || !gc->incremental) return;
+
+  if (!gc_incremental_marking(gc)) return;
+
+  // gray objects are marked but unscanned and would cut off a later trace
+  gc->incremental->phase = GC_INC_IDLE;
+  gc_mark_stack_clear(&gc->mark_stack);
+  gc_unmark_all(gc);
+}
+
+void gc_incremental_get_stats(gc_t *gc, gc_incremental_stats_t *stats) {
+  if (!gc || !gc->incremental || !stats) return;
+
+  *stats = gc->incremental->stats;
+}
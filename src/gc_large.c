@@ -1,5 +1,6 @@
 #include "gc_large.h"
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 
 
@@ -22,6 +23,7 @@ large_block_t* gc_large_create_block(obj_type_t type, size_t size) {
   block->size = size;
   block->in_use = true;
   block->header = (obj_header_t*) memory;
+  block->arena = NULL;
   block->next = NULL;
 
   if (!gc_init_header(block->header, type, size)) {
@@ -33,15 +35,66 @@ large_block_t* gc_large_create_block(obj_type_t type, size_t size) {
   return block;
 }
 
+static void gc_large_release_memory(large_block_t *block) {
+  if (block->arena) {
+    large_arena_t *arena = block->arena;
+    if (--arena->blocks == 0) {
+      free(arena->memory);
+      free(arena);
+    }
+  } else if (block->memory) {
+    free(block->memory);
+  }
+  block->memory = NULL;
+  block->arena = NULL;
+}
+
 void gc_large_free_block(large_block_t *block) {
   if (!block) return;
 
-  if (block->memory) {
-    free(block->memory);
-  }
+  gc_large_release_memory(block);
   free(block);
 }
 
+large_arena_t* gc_large_arena_create(size_t size) {
+  if (size == 0) return NULL;
+
+  large_arena_t *arena = (large_arena_t*) malloc(sizeof(large_arena_t));
+  if (!arena) return NULL;
+
+  arena->memory = malloc(size);
+  if (!arena->memory) {
+    free(arena);
+    return NULL;
+  }
+  arena->size = size;
+  arena->blocks = 0;
+  return arena;
+}
+
+// bytes the object takes in an arena, the next header stays aligned
+size_t gc_large_arena_footprint(const obj_header_t *header) {
+  size_t bytes = sizeof(obj_header_t) + header->size;
+  return (bytes + GC_LARGE_ARENA_ALIGN - 1) & ~(size_t)(GC_LARGE_ARENA_ALIGN - 1);
+}
+
+// copy the object to memory inside arena and drop the old storage; the
+// block shrinks to the object, slack left by a best-fit reuse is gone
+obj_header_t* gc_large_move_block(large_block_t *block, large_arena_t *arena, void *memory) {
+  if (!block || !arena || !memory) return NULL;
+
+  memcpy(memory, block->header, sizeof(obj_header_t) + block->header->size);
+  size_t size = block->header->size;
+
+  gc_large_release_memory(block);
+  block->memory = memory;
+  block->header = (obj_header_t*) memory;
+  block->size = size;
+  block->arena = arena;
+  arena->blocks++;
+  return block->header;
+}
+
 large_block_t* gc_large_find_best_fit(large_block_t *blocks, size_t size) {
   if (!blocks) return NULL;
 
@@ -1,90 +1,148 @@
 #include "gc_mark.h"
 #include "simple_gc.h"
+#include <stdint.h>
 #include <stdlib.h>
 
 
-void gc_mark_object(gc_t *gc, void *ptr) {
-  if (!gc || !ptr) return;
+bool gc_mark_stack_init(gc_mark_stack_t *stack, size_t capacity) {
+  if (!stack || capacity == 0) return false;
+
+  stack->entries = (void**) malloc(sizeof(void*) * capacity);
+  if (!stack->entries) return false;
+
+  stack->count = 0;
+  stack->capacity = capacity;
+  stack->overflowed = false;
+  stack->overflow_count = 0;
+  return true;
+}
+
+void gc_mark_stack_destroy(gc_mark_stack_t *stack) {
+  if (!stack) return;
+
+  free(stack->entries);
+  stack->entries = NULL;
+  stack->count = 0;
+  stack->capacity = 0;
+}
 
-  obj_header_t* header = simple_gc_find_header(gc, ptr);
-  if (!header || header->marked) return;
+void gc_mark_stack_clear(gc_mark_stack_t *stack) {
+  if (!stack) return;
+
+  stack->count = 0;
+  stack->overflowed = false;
+}
+
+// white -> gray: mark the object and queue it for scanning
+bool gc_mark_shade(gc_t *gc, void *ptr) {
+  if (!gc || !ptr) return false;
+
+  obj_header_t *header = simple_gc_find_header(gc, ptr);
+  if (!header || header->marked) return false;
 
-  // object is reachable
   header->marked = true;
 
-  ref_node_t* ref = gc->references;
+  gc_mark_stack_t *stack = &gc->mark_stack;
+  if (stack->count < stack->capacity) {
+    stack->entries[stack->count++] = ptr;
+  } else {
+    // marked but unscanned, gc_mark_recover_overflow finds its children
+    stack->overflowed = true;
+    stack->overflow_count++;
+  }
+  return true;
+}
+
+// gray -> black: shade every child of the object
+void gc_mark_scan(gc_t *gc, void *ptr) {
+  if (!gc || !ptr) return;
+
+  ref_node_t *ref = gc->references;
   while (ref) {
     if (ref->from_obj == ptr) {
-      gc_mark_object(gc, ref->to_obj);
+      gc_mark_shade(gc, ref->to_obj);
     }
     ref = ref->next;
   }
 }
 
-void gc_mark_all_roots(gc_t *gc) {
-  if (!gc) return;
+size_t gc_mark_drain(gc_t *gc, size_t max_objects) {
+  if (!gc) return 0;
 
-  for (size_t i = 0; i < gc->root_count; ++i) {
-    gc_mark_object(gc, gc->roots[i]);
+  gc_mark_stack_t *stack = &gc->mark_stack;
+  size_t scanned = 0;
+  while (stack->count > 0 && scanned < max_objects) {
+    void *ptr = stack->entries[--stack->count];
+    gc_mark_scan(gc, ptr);
+    ++scanned;
   }
+  return scanned;
 }
 
-// iterative marking using explicit stack (avoid stack overflow)
-void gc_mark_object_iterative(gc_t *gc, void *ptr) {
-  if (!gc || !ptr) return;
-
-  void **worklist = (void**) malloc(sizeof(void*) * 1024);
-  if (!worklist) return;
+// after an overflow some marked objects were never scanned; any edge from a
+// marked object to an unmarked one belongs to such an object
+bool gc_mark_recover_overflow(gc_t *gc) {
+  if (!gc || !gc->mark_stack.overflowed) return false;
 
-  size_t worklist_size = 0;
-  size_t worklist_capacity = 1024;
+  gc_mark_stack_t *stack = &gc->mark_stack;
+  stack->overflowed = false;
 
-  // add initial object to worklist
-  worklist[worklist_size++] = ptr;
-
-  while (worklist_size > 0) {
-    // pop from worklist
-    void *current = worklist[--worklist_size];
-
-    obj_header_t *header = simple_gc_find_header(gc, current);
-    if (!header || header->marked) {
-      continue;
+  bool shaded = false;
+  ref_node_t *ref = gc->references;
+  while (ref) {
+    obj_header_t *from = simple_gc_find_header(gc, ref->from_obj);
+    if (from && from->marked && gc_mark_shade(gc, ref->to_obj)) {
+      shaded = true;
     }
+    ref = ref->next;
+  }
+  return shaded;
+}
 
-    // mark object
-    header->marked = true;
-
-    // add children to worklist
-    ref_node_t *ref = gc->references;
-    while (ref) {
-      if (ref->from_obj == current) {
-        // grow worklist if needed
-        if (worklist_size >= worklist_capacity) {
-          size_t new_capacity = worklist_capacity * 2;
-          void **new_worklist = (void**) realloc(worklist, sizeof(void*) * new_capacity);
-          if (!new_worklist) {
-            free(worklist);
-            return;
-          }
-          worklist = new_worklist;
-          worklist_capacity = new_capacity;
-        }
+void gc_mark_complete(gc_t *gc) {
+  do {
+    gc_mark_drain(gc, SIZE_MAX);
+  } while (gc_mark_recover_overflow(gc) || gc->mark_stack.count > 0);
+}
 
-        worklist[worklist_size++] = ref->to_obj;
-      }
-      ref = ref->next;
-    }
+void gc_mark_object(gc_t *gc, void *ptr) {
+  if (!gc || !ptr) return;
+
+  if (gc_mark_shade(gc, ptr)) {
+    gc_mark_complete(gc);
   }
+}
 
-  free(worklist);
+static void gc_mark_shade_handle(gc_handle_t handle, void *ctx) {
+  gc_mark_shade((gc_t*) ctx, *handle);
 }
 
-void gc_mark_all_roots_iterative(gc_t *gc) {
+void gc_mark_shade_roots(gc_t *gc) {
   if (!gc) return;
 
   for (size_t i = 0; i < gc->root_count; ++i) {
-    gc_mark_object_iterative(gc, gc->roots[i]);
+    gc_mark_shade(gc, gc->roots[i]);
   }
+
+  // live handles are roots too
+  gc_handle_for_each(gc->handles, gc_mark_shade_handle, gc);
+}
+
+void gc_mark_all_roots(gc_t *gc) {
+  if (!gc) return;
+
+  gc_mark_shade_roots(gc);
+  gc_mark_complete(gc);
+}
+
+// marking never recurses and never allocates, the iterative entry points
+// are kept for existing callers
+void gc_mark_object_iterative(gc_t *gc, void *ptr) {
+  gc_mark_object(gc, ptr);
+}
+
+void gc_mark_all_roots_iterative(gc_t *gc) {
+  gc_mark_all_roots(gc);
 }
 
 bool gc_is_marked(gc_t *gc, void *ptr) {
@@ -110,18 +168,7 @@ void gc_unmark_all(gc_t *gc) {
         for (size_t j = 0; j < block->capacity; ++j) {
           obj_header_t *header = (obj_header_t*)slot;
 
-          // check if slot is in use
-          bool in_use = true;
-          free_node_t *free_node = block->free_list;
-          while (free_node) {
-            if ((void*)free_node == (void*)header) {
-              in_use = false;
-              break;
-            }
-            free_node = free_node->next;
-          }
-
-          if (in_use) {
+          if (gc_pool_slot_in_use(block, header)) {
             header->marked = false;
           }
 
@@ -174,17 +221,7 @@ size_t gc_count_marked(gc_t *gc) {
         for (size_t j = 0; j < block->capacity; ++j) {
           obj_header_t *header = (obj_header_t*)slot;
 
-          bool in_use = true;
-          free_node_t *free_node = block->free_list;
-          while (free_node) {
-            if ((void*)free_node == (void*)header) {
-              in_use = false;
-              break;
-            }
-            free_node = free_node->next;
-          }
-
-          if (in_use && header->marked) {
+          if (gc_pool_slot_in_use(block, header) && header->marked) {
             count++;
           }
 
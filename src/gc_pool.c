@@ -1,5 +1,6 @@
 #include "gc_pool.h"
 #include "simple_gc.h"
+#include "gc_bitmap.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -46,9 +47,20 @@ pool_block_t* gc_pool_create_block(size_t slot_size, size_t capacity) {
     return NULL;
   }
 
+  // allocation and mark bitmaps share one allocation
+  block->bitmap_words = GC_BITMAP_WORDS(capacity);
+  block->alloc_bits = (uint64_t*) calloc(block->bitmap_words * 2, sizeof(uint64_t));
+  if (!block->alloc_bits) {
+    free(block->memory);
+    free(block);
+    return NULL;
+  }
+  block->mark_bits = block->alloc_bits + block->bitmap_words;
+
   block->slot_size = slot_size;
   block->capacity = capacity;
   block->used = 0;
+  block->needs_sweep = false;
   block->next = NULL;
 
   // initialize free list
@@ -72,6 +84,7 @@ void gc_pool_free_block(pool_block_t *block) {
   if (block->memory) {
     free(block->memory);
   }
+  free(block->alloc_bits);
   free(block);
 }
 
@@ -84,6 +97,26 @@ bool gc_pool_pointer_in_block(pool_block_t *block, void *ptr) {
   return (p >= start && p < end);
 }
 
+size_t gc_pool_slot_index(const pool_block_t *block, const void *slot) {
+  return (size_t) ((const char*) slot - (const char*) block->memory) / block->slot_size;
+}
+
+bool gc_pool_slot_in_use(const pool_block_t *block, const void *slot) {
+  if (!block || !slot) return false;
+
+  return gc_bitmap_test(block->alloc_bits, gc_pool_slot_index(block, slot));
+}
+
+void gc_pool_set_allocated(pool_block_t *block, size_t index, bool allocated) {
+  if (!block || index >= block->capacity) return;
+
+  if (allocated) {
+    gc_bitmap_set(block->alloc_bits, index);
+  } else {
+    gc_bitmap_clear(block->alloc_bits, index);
+  }
+}
+
 void* gc_pool_alloc_from_block(pool_block_t *block, obj_type_t type, size_t size) {
   if (!block || !block->free_list) return NULL;
 
@@ -101,6 +134,7 @@ void* gc_pool_alloc_from_block(pool_block_t *block, obj_type_t type, size_t size
     block->used--;
     return NULL;
   }
+  gc_bitmap_set(block->alloc_bits, gc_pool_slot_index(block, header));
 
   header->generation = GC_GEN_YOUNG;
   header->age = 0;
@@ -114,7 +148,13 @@ void* gc_pool_alloc_from_size_class(size_class_t *sc, obj_type_t type, size_t si
   // try to allocate from existing blocks
   pool_block_t *block = sc->blocks;
   while (block) {
-    if (block->free_list) {
+    // lazily swept blocks are reclaimed right before they are reused
+    if (block->needs_sweep && sc->sweep_fn) {
+      sc->sweep_fn(sc->sweep_ctx, sc, block);
+    }
+
+    // a block that is still flagged belongs to the background sweeper
+    if (block->free_list && !block->needs_sweep) {
       void *ptr = gc_pool_alloc_from_block(block, type, size);
       if (ptr) {
         sc->total_used++;
@@ -152,6 +192,8 @@ void* gc_pool_alloc_from_size_class(size_class_t *sc, obj_type_t type, size_t si
 void gc_pool_free_to_block(pool_block_t *block, size_class_t *sc, obj_header_t *header) {
   if (!block || !sc || !header) return;
 
+  gc_bitmap_clear(block->alloc_bits, gc_pool_slot_index(block, header));
+
   free_node_t *node = (free_node_t*) header;
   node->next = block->free_list;
   block->free_list = node;
@@ -168,6 +210,8 @@ bool gc_pool_init_size_class(size_class_t *sc, size_t object_size) {
   sc->total_capacity = 0;
   sc->total_used = 0;
   sc->total_allocated = 0;
+  sc->sweep_fn = NULL;
+  sc->sweep_ctx = NULL;
 
   return true;
 }
@@ -0,0 +1,103 @@
+#include "gc_remset.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+
+void gc_remset_init(gc_remset_t *set) {
+  if (!set) return;
+
+  set->entries = NULL;
+  set->capacity = 0;
+  set->count = 0;
+  set->inserts = 0;
+}
+
+void gc_remset_destroy(gc_remset_t *set) {
+  if (!set) return;
+
+  free(set->entries);
+  gc_remset_init(set);
+}
+
+// objects are at least 8 byte aligned, drop the zero bits before mixing
+static size_t gc_remset_hash(const void *obj, size_t capacity) {
+  uint64_t h = ((uint64_t)(uintptr_t) obj >> 3) * UINT64_C(0x9E3779B97F4A7C15);
+  return (size_t)(h >> 32) & (capacity - 1);
+}
+
+static void gc_remset_insert(void **entries, size_t capacity, void *obj) {
+  size_t i = gc_remset_hash(obj, capacity);
+  while (entries[i]) i = (i + 1) & (capacity - 1);
+  entries[i] = obj;
+}
+
+static bool gc_remset_grow(gc_remset_t *set) {
+  size_t capacity = set->capacity ? set->capacity * 2 : GC_REMSET_INITIAL_CAPACITY;
+  void **entries = (void**) calloc(capacity, sizeof(void*));
+  if (!entries) return false;
+
+  for (size_t i = 0; i < set->capacity; ++i) {
+    if (set->entries[i]) gc_remset_insert(entries, capacity, set->entries[i]);
+  }
+  free(set->entries);
+  set->entries = entries;
+  set->capacity = capacity;
+  return true;
+}
+
+bool gc_remset_add(gc_remset_t *set, void *obj) {
+  if (!set || !obj) return false;
+
+  set->inserts++;
+  if (gc_remset_contains(set, obj)) return true;
+
+  if ((set->count + 1) * 4 > set->capacity * 3 && !gc_remset_grow(set)) {
+    return false;
+  }
+  gc_remset_insert(set->entries, set->capacity, obj);
+  set->count++;
+  return true;
+}
+
+bool gc_remset_contains(const gc_remset_t *set, const void *obj) {
+  if (!set || !obj || set->count == 0) return false;
+
+  size_t i = gc_remset_hash(obj, set->capacity);
+  while (set->entries[i]) {
+    if (set->entries[i] == obj) return true;
+    i = (i + 1) & (set->capacity - 1);
+  }
+  return false;
+}
+
+// keeps the table, the next cycle remembers about as many objects
+void gc_remset_clear(gc_remset_t *set) {
+  if (!set || set->count == 0) return;
+
+  memset(set->entries, 0, set->capacity * sizeof(void*));
+  set->count = 0;
+}
+
+void gc_remset_for_each(gc_t *gc, gc_remset_t *set, gc_remset_fn callback, void *user_data) {
+  if (!set || !callback) return;
+
+  for (size_t i = 0; i < set->capacity; ++i) {
+    if (set->entries[i]) callback(gc, set->entries[i], user_data);
+  }
+}
+
+size_t gc_remset_count(const gc_remset_t *set) {
+  return set ? set->count : 0;
+}
+
+void gc_remset_print_stats(const gc_remset_t *set) {
+  if (!set) return;
+
+  printf("\n=== Remembered Set Statistics ===\n");
+  printf("Remembered:    %zu objects\n", set->count);
+  printf("Capacity:      %zu entries\n", set->capacity);
+  printf("Inserts:       %zu\n", set->inserts);
+  printf("=================================\n\n");
+}
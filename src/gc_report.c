@@ -0,0 +1,95 @@
+#include "gc_report.h"
+#include "simple_gc.h"
+#include <string.h>
+#include <time.h>
+
+
+void gc_report_init(gc_report_t *report) {
+  if (!report) return;
+
+  memset(report, 0, sizeof(gc_report_t));
+}
+
+uint64_t gc_report_now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000ULL + (uint64_t) ts.tv_nsec / 1000ULL;
+}
+
+static gc_cycle_report_t *gc_report_latest(gc_report_t *report) {
+  if (report->cycles == 0) return NULL;
+
+  return &report->entries[(report->cycles - 1) % GC_CYCLE_HISTORY];
+}
+
+void gc_report_begin(gc_t *gc, const char *kind) {
+  if (!gc) return;
+
+  // an aborted cycle is closed where it stopped
+  gc_report_end(gc);
+
+  gc_report_t *report = &gc->report;
+  report->cycles++;
+  report->in_cycle = true;
+
+  gc_cycle_report_t *entry = gc_report_latest(report);
+  memset(entry, 0, sizeof(gc_cycle_report_t));
+  entry->cycle = report->cycles;
+  entry->kind = kind;
+  entry->start_us = gc_report_now_us();
+  entry->objects_before = gc->object_count;
+  entry->bytes_before = gc->heap_used;
+}
+
+void gc_report_phase(gc_t *gc, gc_phase_t phase, uint64_t elapsed_us) {
+  if (!gc || !gc->report.in_cycle || phase >= GC_PHASE_COUNT) return;
+
+  gc_report_latest(&gc->report)->phase_us[phase] += elapsed_us;
+}
+
+void gc_report_end(gc_t *gc) {
+  if (!gc || !gc->report.in_cycle) return;
+
+  gc_cycle_report_t *entry = gc_report_latest(&gc->report);
+  entry->total_us = gc_report_now_us() - entry->start_us;
+  entry->objects_after = gc->object_count;
+  entry->bytes_after = gc->heap_used;
+  gc->report.in_cycle = false;
+}
+
+void gc_report_reclaim(gc_t *gc, gc_tier_t tier, int class_index, size_t objects, size_t bytes) {
+  if (!gc || objects == 0) return;
+
+  gc_cycle_report_t *entry = gc_report_latest(&gc->report);
+  if (!entry) return;
+
+  entry->reclaimed.objects += objects;
+  entry->reclaimed.bytes += bytes;
+  if (tier < GC_TIER_COUNT) {
+    entry->tier[tier].objects += objects;
+    entry->tier[tier].bytes += bytes;
+  }
+  if (class_index >= 0 && class_index < GC_NUM_SIZE_CLASSES) {
+    entry->size_class[class_index].objects += objects;
+    entry->size_class[class_index].bytes += bytes;
+  }
+}
+
+const gc_cycle_report_t *gc_report_last(const gc_t *gc) {
+  if (!gc || gc->report.cycles == 0) return NULL;
+
+  return &gc->report.entries[(gc->report.cycles - 1) % GC_CYCLE_HISTORY];
+}
+
+size_t gc_report_history(const gc_t *gc, gc_cycle_report_t *reports, size_t max) {
+  if (!gc || !reports) return 0;
+
+  size_t available = gc->report.cycles < GC_CYCLE_HISTORY ? gc->report.cycles : GC_CYCLE_HISTORY;
+  size_t count = available < max ? available : max;
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t cycle = gc->report.cycles - 1 - i;
+    reports[i] = gc->report.entries[cycle % GC_CYCLE_HISTORY];
+  }
+  return count;
+}
@@ -1,73 +1,213 @@
 #include <sys/mman.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "gc_sweep.h"
 #include "simple_gc.h"
 #include "gc_pool.h"
 #include "gc_large.h"
 #include "gc_debug.h"
+#include "gc_bitmap.h"
+#include "gc_sweeper.h"
+#include "gc_workers.h"
+#include "gc_report.h"
+
+
+// frees the unmarked objects of one block and unmarks the survivors; the
+// size class and heap counters are left to the caller so that parallel
+// workers never share a cache line (gc is only used for debug tracking)
+static size_t gc_sweep_block_slots(gc_t *gc, pool_block_t *block, size_t *bytes_freed) {
+  char *base = (char*) block->memory;
+  size_t words = block->bitmap_words;
+
+  // gather marks of allocated slots, survivors are unmarked for next cycle
+  for (size_t w = 0; w < words; ++w) {
+    uint64_t alloc = block->alloc_bits[w];
+    uint64_t mark = 0;
+
+    while (alloc) {
+      unsigned bit = gc_bitmap_ctz(alloc);
+      alloc &= alloc - 1;
+
+      obj_header_t *header = (obj_header_t*)(base + (w * GC_BITMAP_WORD_BITS + bit) * block->slot_size);
+      if (header->marked) {
+        mark |= (uint64_t) 1 << bit;
+        header->marked = false;
+      }
+    }
+    block->mark_bits[w] = mark;
+  }
+
+  // alloc &= mark over the whole block, mark_bits is left holding the dead set
+  size_t free_count = gc_bitmap_sweep(block->alloc_bits, block->mark_bits, words);
+  if (free_count == 0) {
+    *bytes_freed = 0;
+    return 0;
+  }
+
+  size_t bytes = 0;
+  for (size_t w = 0; w < words; ++w) {
+    uint64_t dead = block->mark_bits[w];
+
+    while (dead) {
+      unsigned bit = gc_bitmap_ctz(dead);
+      dead &= dead - 1;
+
+      obj_header_t *header = (obj_header_t*)(base + (w * GC_BITMAP_WORD_BITS + bit) * block->slot_size);
+
+      if (gc && gc->debug) {
+        void *data_ptr = (void*)(header + 1);
+        gc_debug_track_free(gc, data_ptr);
+      }
+
+      bytes += (sizeof(obj_header_t) + header->size);
+
+      free_node_t *node = (free_node_t*) header;
+      node->next = block->free_list;
+      block->free_list = node;
+    }
+  }
+  block->used -= free_count;
+
+  *bytes_freed = bytes;
+  return free_count;
+}
+
+void gc_sweep_pool_block(gc_t *gc, size_class_t *sc, pool_block_t *block) {
+  if (!gc || !sc || !block) return;
+
+  size_t bytes_freed = 0;
+  size_t freed = gc_sweep_block_slots(gc, block, &bytes_freed);
+
+  sc->total_used -= freed;
+  gc->object_count -= freed;
+  gc->heap_used -= bytes_freed;
+  gc->total_bytes_freed += bytes_freed;
+  gc_report_reclaim(gc, GC_TIER_POOL, (int)(sc - gc->size_classes), freed, bytes_freed);
+
+  if (block->needs_sweep) {
+    block->needs_sweep = false;
+    gc->sweep_pending--;
+  }
+}
+
+typedef struct gc_sweep_item {
+  pool_block_t *block;
+  int class_index;
+} gc_sweep_item_t;
+
+// per-worker totals, padded so that workers don't share cache lines
+typedef struct gc_sweep_partial {
+  _Alignas(GC_SWEEP_CACHE_LINE) size_t objects_freed;
+  size_t bytes_freed;
+  size_t flagged_swept;
+  size_t class_freed[GC_NUM_SIZE_CLASSES];
+  size_t class_bytes[GC_NUM_SIZE_CLASSES];
+} gc_sweep_partial_t;
+
+typedef struct gc_sweep_job {
+  gc_sweep_item_t *items;
+  size_t item_count;
+  size_t workers;
+  gc_sweep_partial_t *partials;
+} gc_sweep_job_t;
+
+static void gc_sweep_worker(void *ctx, size_t worker) {
+  gc_sweep_job_t *job = (gc_sweep_job_t*) ctx;
+  gc_sweep_partial_t *partial = &job->partials[worker];
+
+  // contiguous block range, size classes are laid out one after another
+  size_t first = job->item_count * worker / job->workers;
+  size_t last = job->item_count * (worker + 1) / job->workers;
+
+  for (size_t i = first; i < last; ++i) {
+    pool_block_t *block = job->items[i].block;
+
+    size_t bytes_freed = 0;
+    size_t freed = gc_sweep_block_slots(NULL, block, &bytes_freed);
+
+    partial->objects_freed += freed;
+    partial->bytes_freed += bytes_freed;
+    partial->class_freed[job->items[i].class_index] += freed;
+    partial->class_bytes[job->items[i].class_index] += bytes_freed;
+
+    if (block->needs_sweep) {
+      block->needs_sweep = false;
+      partial->flagged_swept++;
+    }
+  }
+}
 
+static bool gc_sweep_pools_parallel(gc_t *gc) {
+  size_t item_count = 0;
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    item_count += gc_pool_count_blocks(&gc->size_classes[i]);
+  }
+
+  // not worth waking the workers for a small heap
+  size_t workers = gc->workers->count;
+  if (item_count < workers * GC_SWEEP_PARALLEL_MIN_BLOCKS) return false;
+
+  gc_sweep_item_t *items = (gc_sweep_item_t*) malloc(sizeof(gc_sweep_item_t) * item_count);
+  gc_sweep_partial_t *partials = (gc_sweep_partial_t*) aligned_alloc(GC_SWEEP_CACHE_LINE,
+      sizeof(gc_sweep_partial_t) * workers);
+  if (!items || !partials) {
+    free(items);
+    free(partials);
+    return false;
+  }
+  memset(partials, 0, sizeof(gc_sweep_partial_t) * workers);
+
+  size_t n = 0;
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    pool_block_t *block = gc->size_classes[i].blocks;
+    while (block) {
+      items[n].block = block;
+      items[n].class_index = i;
+      ++n;
+      block = block->next;
+    }
+  }
+
+  gc_sweep_job_t job = {items, item_count, workers, partials};
+  gc_workers_run(gc->workers, gc_sweep_worker, &job);
+
+  // reduce once instead of touching the shared counters per object
+  for (size_t w = 0; w < workers; ++w) {
+    gc_sweep_partial_t *partial = &partials[w];
+
+    gc->object_count -= partial->objects_freed;
+    gc->heap_used -= partial->bytes_freed;
+    gc->total_bytes_freed += partial->bytes_freed;
+    gc->sweep_pending -= partial->flagged_swept;
+    for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+      gc->size_classes[i].total_used -= partial->class_freed[i];
+      gc_report_reclaim(gc, GC_TIER_POOL, i, partial->class_freed[i], partial->class_bytes[i]);
+    }
+  }
+
+  free(items);
+  free(partials);
+  return true;
+}
 
 void gc_sweep_pools(gc_t *gc) {
   if (!gc) return;
 
+  // blocks handed to the sweeper thread must come back first
+  gc_sweeper_wait(gc);
+
+  // debug tracking is not thread safe, keep it on the serial path
+  if (gc->workers && !gc->debug && gc_sweep_pools_parallel(gc)) return;
+
   // sweep size classes
   for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
     size_class_t *sc = &gc->size_classes[i];
     pool_block_t *block = sc->blocks;
 
     while (block) {
-      char *slot = (char*) block->memory;
-
-      // collect unmarked objects first, then free them
-      // this avoids corrupting the free list during iteration
-      obj_header_t *to_free[block->capacity];
-      size_t free_count = 0;
-
-      for (size_t j = 0; j < block->capacity; ++j) {
-        obj_header_t *header = (obj_header_t*) slot;
-        // slot is in use if not in the free list
-        bool in_use = true;
-        free_node_t *free_node = block->free_list;
-
-        while (free_node) {
-          if ((void*) free_node == (void*) header) {
-            in_use = false;
-            break;
-          }
-          free_node = free_node->next;
-        }
-
-        if (in_use) {
-          // slot is used - check if marked
-          if (!header->marked) {
-            // unmarked, collect for freeing
-            to_free[free_count++] = header;
-          } else {
-            // marked, unmark for next cycle
-            header->marked = false;
-          }
-        }
-
-        slot += block->slot_size;
-      }
-
-      // free all the collected objects
-      for (size_t j = 0; j < free_count; ++j) {
-        obj_header_t *header = to_free[j];
-
-        if (gc->debug) {
-          void *data_ptr = (void*)(header + 1);
-          gc_debug_track_free(gc, data_ptr);
-        }
-
-        size_t bytes_changed = (sizeof(obj_header_t) + header->size);
-        gc_pool_free_to_block(block, sc, header);
-        gc->object_count--;
-        gc->heap_used -= bytes_changed;
-        gc->total_bytes_freed += bytes_changed;
-      }
-
+      gc_sweep_pool_block(gc, sc, block);
       block = block->next;
     }
   }
@@ -83,9 +223,11 @@ void gc_sweep_large_blocks(gc_t *gc) {
 
       if (!header->marked) {
         // unmarked, mark as free so we can reuse it
+        size_t bytes = sizeof(obj_header_t) + header->size;
         block->in_use = false;
         gc->object_count--;
-        gc->heap_used -= (sizeof(obj_header_t) + header->size);
+        gc->heap_used -= bytes;
+        gc_report_reclaim(gc, GC_TIER_LARGE, -1, 1, bytes);
       } else {
         // marked, unmark for next cycle
         header->marked = false;
@@ -122,6 +264,7 @@ void gc_sweep_huge_objects(gc_t *gc) {
       gc->object_count--;
       gc->huge_object_count--;
       gc->heap_used -= to_free->size;
+      gc_report_reclaim(gc, GC_TIER_HUGE, -1, 1, to_free->size);
       munmap(to_free->memory, to_free->size);
       free(to_free);
     } else {
@@ -159,8 +302,10 @@ void gc_sweep_legacy(gc_t *gc) {
 
       *curr = (*curr)->next;
 
+      size_t bytes = sizeof(obj_header_t) + tmp->size;
       gc->object_count--;
-      gc->heap_used -= (sizeof(obj_header_t) + tmp->size);
+      gc->heap_used -= bytes;
+      gc_report_reclaim(gc, GC_TIER_LEGACY, -1, 1, bytes);
 
       free(tmp);
     } else {
@@ -184,16 +329,94 @@ void gc_sweep_all(gc_t *gc) {
   gc_sweep_legacy(gc);
 }
 
-size_t gc_count_swept(gc_t *gc) {
-  if (!gc) return 0;
+// size class hook, sweeps a block the allocator is about to reuse
+static void gc_sweep_on_demand(void *ctx, size_class_t *sc, pool_block_t *block) {
+  gc_t *gc = (gc_t*) ctx;
 
-  // TODO
-  return 0;
+  // with a sweeper thread, only pick up the blocks it has finished
+  if (gc_sweeper_active(gc)) {
+    gc_sweeper_collect(gc);
+    return;
+  }
+
+  gc_sweep_pool_block(gc, sc, block);
 }
 
-size_t gc_bytes_freed_last_sweep(gc_t *gc) {
+void gc_sweep_lazy_init(gc_t *gc) {
+  if (!gc) return;
+
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    gc->size_classes[i].sweep_fn = gc_sweep_on_demand;
+    gc->size_classes[i].sweep_ctx = gc;
+  }
+}
+
+void gc_sweep_lazy_begin(gc_t *gc) {
+  if (!gc) return;
+
+  if (!gc->use_pools) {
+    gc_sweep_legacy(gc);
+    return;
+  }
+
+  // pool blocks are deferred to allocation; large blocks and huge objects
+  // are short lists and are swept right away
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    pool_block_t *block = gc->size_classes[i].blocks;
+    while (block) {
+      if (!block->needs_sweep) {
+        block->needs_sweep = true;
+        gc->sweep_pending++;
+      }
+      block = block->next;
+    }
+  }
+
+  gc_sweep_large_blocks(gc);
+
+  if (gc_sweeper_active(gc)) {
+    gc_sweeper_submit(gc);
+  } else {
+    gc_sweep_huge_objects(gc);
+  }
+}
+
+size_t gc_sweep_lazy_step(gc_t *gc, size_t max_blocks) {
   if (!gc) return 0;
+  if (gc_sweeper_active(gc)) return gc_sweeper_collect(gc);
+
+  size_t swept = 0;
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES && gc->sweep_pending > 0; ++i) {
+    size_class_t *sc = &gc->size_classes[i];
+    pool_block_t *block = sc->blocks;
+
+    while (block && swept < max_blocks) {
+      if (block->needs_sweep) {
+        gc_sweep_pool_block(gc, sc, block);
+        ++swept;
+      }
+      block = block->next;
+    }
+    if (swept >= max_blocks) break;
+  }
+  return swept;
+}
+
+void gc_sweep_finish(gc_t *gc) {
+  if (!gc) return;
+
+  // also waits for dead huge objects to be unmapped
+  gc_sweeper_wait(gc);
 
-  // TODO
-  return gc->total_bytes_freed;
+  if (gc->sweep_pending > 0) gc_sweep_lazy_step(gc, SIZE_MAX);
+}
+
+size_t gc_count_swept(gc_t *gc) {
+  const gc_cycle_report_t *report = gc_report_last(gc);
+  return report ? report->reclaimed.objects : 0;
+}
+
+size_t gc_bytes_freed_last_sweep(gc_t *gc) {
+  const gc_cycle_report_t *report = gc_report_last(gc);
+  return report ? report->reclaimed.bytes : 0;
 }
@@ -0,0 +1,287 @@
+#include "gc_sweeper.h"
+#include "simple_gc.h"
+#include "gc_sweep.h"
+#include "gc_debug.h"
+#include "gc_bitmap.h"
+#include "gc_report.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// runs on the sweeper thread: only reads the block and writes dead slots,
+// the free list and all counters are left to the mutator
+static void gc_sweeper_sweep_block(gc_swept_block_t *item) {
+  pool_block_t *block = item->block;
+  char *base = (char*) block->memory;
+
+  item->dead_head = NULL;
+  item->dead_tail = NULL;
+  item->dead_count = 0;
+  item->dead_bytes = 0;
+
+  // the allocation bitmap is stable while the sweeper owns the block
+  for (size_t w = 0; w < block->bitmap_words; ++w) {
+    uint64_t alloc = block->alloc_bits[w];
+
+    while (alloc) {
+      unsigned bit = gc_bitmap_ctz(alloc);
+      alloc &= alloc - 1;
+
+      obj_header_t *header = (obj_header_t*)(base + (w * GC_BITMAP_WORD_BITS + bit) * block->slot_size);
+      if (!header->marked) {
+        item->dead_bytes += sizeof(obj_header_t) + header->size;
+        item->dead_count++;
+
+        // the header is dead, reuse it as a private free node
+        free_node_t *node = (free_node_t*) header;
+        node->next = item->dead_head;
+        item->dead_head = node;
+        if (!item->dead_tail) item->dead_tail = node;
+      } else {
+        header->marked = false;
+      }
+    }
+  }
+}
+
+static void *gc_sweeper_thread(void *arg) {
+  gc_sweeper_t *sw = (gc_sweeper_t*) arg;
+
+  pthread_mutex_lock(&sw->lock);
+  while (!sw->stop_requested) {
+    if (sw->dead_huge) {
+      huge_object_t *huge = sw->dead_huge;
+      sw->dead_huge = NULL;
+      sw->unmapping = true;
+      pthread_mutex_unlock(&sw->lock);
+
+      size_t unmapped = 0;
+      while (huge) {
+        huge_object_t *next = huge->next;
+        gc_huge_free_object(huge);
+        huge = next;
+        ++unmapped;
+      }
+
+      pthread_mutex_lock(&sw->lock);
+      sw->unmapping = false;
+      sw->stats.huge_unmapped += unmapped;
+      pthread_cond_broadcast(&sw->work_done);
+      continue;
+    }
+
+    if (sw->swept < sw->work_count) {
+      gc_swept_block_t *item = &sw->work[sw->swept];
+      pthread_mutex_unlock(&sw->lock);
+
+      gc_sweeper_sweep_block(item);
+
+      pthread_mutex_lock(&sw->lock);
+      sw->swept++;
+      sw->stats.blocks_swept++;
+      sw->stats.slots_freed += item->dead_count;
+      pthread_cond_broadcast(&sw->work_done);
+      continue;
+    }
+
+    pthread_cond_wait(&sw->work_ready, &sw->lock);
+  }
+  pthread_mutex_unlock(&sw->lock);
+
+  return NULL;
+}
+
+bool gc_sweeper_init(gc_t *gc) {
+  if (!gc) return false;
+  if (gc->sweeper) return true;
+
+  gc_sweeper_t *sw = (gc_sweeper_t*) calloc(1, sizeof(gc_sweeper_t));
+  if (!sw) return false;
+
+  pthread_mutex_init(&sw->lock, NULL);
+  pthread_cond_init(&sw->work_ready, NULL);
+  pthread_cond_init(&sw->work_done, NULL);
+  memset(&sw->stats, 0, sizeof(gc_sweeper_stats_t));
+
+  if (pthread_create(&sw->thread, NULL, gc_sweeper_thread, sw) != 0) {
+    pthread_cond_destroy(&sw->work_done);
+    pthread_cond_destroy(&sw->work_ready);
+    pthread_mutex_destroy(&sw->lock);
+    free(sw);
+    return false;
+  }
+  sw->thread_running = true;
+
+  gc->sweeper = sw;
+  return true;
+}
+
+void gc_sweeper_destroy(gc_t *gc) {
+  if (!gc || !gc->sweeper) return;
+
+  gc_sweeper_t *sw = gc->sweeper;
+
+  pthread_mutex_lock(&sw->lock);
+  sw->stop_requested = true;
+  pthread_cond_signal(&sw->work_ready);
+  pthread_mutex_unlock(&sw->lock);
+  pthread_join(sw->thread, NULL);
+  sw->thread_running = false;
+
+  // anything the thread did not get to
+  huge_object_t *huge = sw->dead_huge;
+  while (huge) {
+    huge_object_t *next = huge->next;
+    gc_huge_free_object(huge);
+    huge = next;
+  }
+
+  pthread_cond_destroy(&sw->work_done);
+  pthread_cond_destroy(&sw->work_ready);
+  pthread_mutex_destroy(&sw->lock);
+  free(sw->work);
+  free(sw);
+  gc->sweeper = NULL;
+}
+
+bool gc_sweeper_active(const gc_t *gc) {
+  return (gc && gc->sweeper && gc->sweeper->thread_running);
+}
+
+// splice one swept block back in; mutator side only
+static void gc_sweeper_apply(gc_t *gc, gc_swept_block_t *item) {
+  pool_block_t *block = item->block;
+
+  if (item->dead_head) {
+    free_node_t *node = item->dead_head;
+    while (node) {
+      if (gc->debug) gc_debug_track_free(gc, (void*)((obj_header_t*) node + 1));
+      gc_pool_set_allocated(block, gc_pool_slot_index(block, node), false);
+      node = node->next;
+    }
+
+    item->dead_tail->next = block->free_list;
+    block->free_list = item->dead_head;
+    block->used -= item->dead_count;
+    item->sc->total_used -= item->dead_count;
+
+    gc->object_count -= item->dead_count;
+    gc->heap_used -= item->dead_bytes;
+    gc->total_bytes_freed += item->dead_bytes;
+    gc_report_reclaim(gc, GC_TIER_POOL, (int)(item->sc - gc->size_classes),
+        item->dead_count, item->dead_bytes);
+  }
+
+  block->needs_sweep = false;
+  gc->sweep_pending--;
+}
+
+size_t gc_sweeper_collect(gc_t *gc) {
+  if (!gc_sweeper_active(gc)) return 0;
+
+  gc_sweeper_t *sw = gc->sweeper;
+
+  pthread_mutex_lock(&sw->lock);
+  size_t first = sw->applied;
+  size_t last = sw->swept;
+  sw->applied = last;
+  if (last > first) sw->stats.handoffs++;
+  pthread_mutex_unlock(&sw->lock);
+
+  // entries below swept are never touched by the sweeper again
+  for (size_t i = first; i < last; ++i) {
+    gc_sweeper_apply(gc, &sw->work[i]);
+  }
+  return last - first;
+}
+
+void gc_sweeper_wait(gc_t *gc) {
+  if (!gc_sweeper_active(gc)) return;
+
+  gc_sweeper_t *sw = gc->sweeper;
+
+  pthread_mutex_lock(&sw->lock);
+  while (sw->swept < sw->work_count || sw->dead_huge || sw->unmapping) {
+    pthread_cond_wait(&sw->work_done, &sw->lock);
+  }
+  pthread_mutex_unlock(&sw->lock);
+
+  gc_sweeper_collect(gc);
+}
+
+void gc_sweeper_submit(gc_t *gc) {
+  if (!gc_sweeper_active(gc)) return;
+
+  gc_sweeper_t *sw = gc->sweeper;
+
+  // the previous cycle's blocks were finished before marking started
+  gc_sweeper_wait(gc);
+
+  // dead huge objects leave the heap now, their memory goes back later
+  huge_object_t *dead_huge = NULL;
+  huge_object_t **link = &gc->huge_objects;
+  while (*link) {
+    huge_object_t *object = *link;
+
+    if (!object->header->marked) {
+      *link = object->next;
+      gc->object_count--;
+      gc->huge_object_count--;
+      gc->heap_used -= object->size;
+      gc_report_reclaim(gc, GC_TIER_HUGE, -1, 1, object->size);
+
+      object->next = dead_huge;
+      dead_huge = object;
+    } else {
+      // marked, unmark for next cycle
+      object->header->marked = false;
+      link = &object->next;
+    }
+  }
+
+  if (gc->sweep_pending > sw->work_capacity) {
+    gc_swept_block_t *work = (gc_swept_block_t*) realloc(sw->work,
+        sizeof(gc_swept_block_t) * gc->sweep_pending);
+    if (work) {
+      sw->work = work;
+      sw->work_capacity = gc->sweep_pending;
+    }
+  }
+
+  size_t count = 0;
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    size_class_t *sc = &gc->size_classes[i];
+    pool_block_t *block = sc->blocks;
+
+    while (block) {
+      if (block->needs_sweep) {
+        if (count < sw->work_capacity) {
+          sw->work[count].sc = sc;
+          sw->work[count].block = block;
+          ++count;
+        } else {
+          // no room to hand it over, sweep it here
+          gc_sweep_pool_block(gc, sc, block);
+        }
+      }
+      block = block->next;
+    }
+  }
+
+  pthread_mutex_lock(&sw->lock);
+  sw->work_count = count;
+  sw->swept = 0;
+  sw->applied = 0;
+  sw->dead_huge = dead_huge;
+  sw->stats.cycles++;
+  pthread_cond_signal(&sw->work_ready);
+  pthread_mutex_unlock(&sw->lock);
+}
+
+void gc_sweeper_get_stats(gc_t *gc, gc_sweeper_stats_t *stats) {
+  if (!gc || !gc->sweeper || !stats) return;
+
+  pthread_mutex_lock(&gc->sweeper->lock);
+  *stats = gc->sweeper->stats;
+  pthread_mutex_unlock(&gc->sweeper->lock);
+}
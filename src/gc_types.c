@@ -13,6 +13,8 @@ bool gc_init_header(obj_header_t *header, obj_type_t type, size_t size) {
 
   header->age = 0;
   header->generation = 0;
+  header->pinned = 0;
+  header->forwarded = 0;
 
   return true;
 }
@@ -0,0 +1,125 @@
+#include "gc_workers.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+
+static void *gc_workers_thread(void *arg) {
+  gc_worker_arg_t *self = (gc_worker_arg_t*) arg;
+  gc_workers_t *workers = self->workers;
+  size_t seen = 0;
+
+  pthread_mutex_lock(&workers->lock);
+  for (;;) {
+    while (!workers->stop && workers->round == seen) {
+      pthread_cond_wait(&workers->start, &workers->lock);
+    }
+    if (workers->stop) break;
+
+    seen = workers->round;
+    gc_worker_fn fn = workers->fn;
+    void *ctx = workers->ctx;
+    pthread_mutex_unlock(&workers->lock);
+
+    fn(ctx, self->index);
+
+    pthread_mutex_lock(&workers->lock);
+    if (--workers->busy == 0) {
+      pthread_cond_signal(&workers->done);
+    }
+  }
+  pthread_mutex_unlock(&workers->lock);
+
+  return NULL;
+}
+
+size_t gc_workers_default_count(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return cpus > 0 ? (size_t) cpus : 1;
+}
+
+static void gc_workers_stop(gc_workers_t *workers, size_t started) {
+  pthread_mutex_lock(&workers->lock);
+  workers->stop = true;
+  pthread_cond_broadcast(&workers->start);
+  pthread_mutex_unlock(&workers->lock);
+
+  for (size_t i = 0; i < started; ++i) {
+    pthread_join(workers->threads[i], NULL);
+  }
+}
+
+gc_workers_t *gc_workers_create(size_t count) {
+  if (count == 0) count = gc_workers_default_count();
+
+  gc_workers_t *workers = (gc_workers_t*) calloc(1, sizeof(gc_workers_t));
+  if (!workers) return NULL;
+
+  // the calling thread does the first share, only count - 1 helpers
+  size_t helpers = count - 1;
+  if (helpers > 0) {
+    workers->threads = (pthread_t*) malloc(sizeof(pthread_t) * helpers);
+    workers->args = (gc_worker_arg_t*) malloc(sizeof(gc_worker_arg_t) * helpers);
+    if (!workers->threads || !workers->args) {
+      free(workers->threads);
+      free(workers->args);
+      free(workers);
+      return NULL;
+    }
+  }
+
+  workers->count = count;
+  pthread_mutex_init(&workers->lock, NULL);
+  pthread_cond_init(&workers->start, NULL);
+  pthread_cond_init(&workers->done, NULL);
+
+  for (size_t i = 0; i < helpers; ++i) {
+    workers->args[i].workers = workers;
+    workers->args[i].index = i + 1;
+
+    if (pthread_create(&workers->threads[i], NULL, gc_workers_thread, &workers->args[i]) != 0) {
+      gc_workers_stop(workers, i);
+      pthread_cond_destroy(&workers->done);
+      pthread_cond_destroy(&workers->start);
+      pthread_mutex_destroy(&workers->lock);
+      free(workers->threads);
+      free(workers->args);
+      free(workers);
+      return NULL;
+    }
+  }
+
+  return workers;
+}
+
+void gc_workers_destroy(gc_workers_t *workers) {
+  if (!workers) return;
+
+  gc_workers_stop(workers, workers->count - 1);
+
+  pthread_cond_destroy(&workers->done);
+  pthread_cond_destroy(&workers->start);
+  pthread_mutex_destroy(&workers->lock);
+  free(workers->threads);
+  free(workers->args);
+  free(workers);
+}
+
+void gc_workers_run(gc_workers_t *workers, gc_worker_fn fn, void *ctx) {
+  if (!workers || !fn) return;
+
+  pthread_mutex_lock(&workers->lock);
+  workers->fn = fn;
+  workers->ctx = ctx;
+  workers->busy = workers->count - 1;
+  workers->round++;
+  pthread_cond_broadcast(&workers->start);
+  pthread_mutex_unlock(&workers->lock);
+
+  fn(ctx, 0);
+
+  pthread_mutex_lock(&workers->lock);
+  while (workers->busy > 0) {
+    pthread_cond_wait(&workers->done, &workers->lock);
+  }
+  pthread_mutex_unlock(&workers->lock);
+}
@@ -14,6 +14,10 @@
 #include "gc_generation.h"
 #include "gc_cardtable.h"
 #include "gc_barrier.h"
+#include "gc_concurrent.h"
+#include "gc_incremental.h"
+#include "gc_sweeper.h"
+#include "gc_workers.h"
 #include "gc_trace.h"
 #include "gc_debug.h"
 
@@ -107,6 +111,10 @@ bool simple_gc_init(gc_t* gc, size_t init_capacity) {
 
   gc->gen_context = NULL;
   gc->barrier_context = NULL;
+  gc->incremental = NULL;
+  gc->concurrent = NULL;
+  gc->sweeper = NULL;
+  gc->workers = NULL;
 
   // roots
   gc->root_capacity = 16;
@@ -119,6 +127,13 @@ bool simple_gc_init(gc_t* gc, size_t init_capacity) {
 
   // refs
   gc->references = NULL;
+  gc->slot_index = (gc_slot_index_t){0};
+
+  // marking must not allocate, reserve the mark stack up front
+  if (!gc_mark_stack_init(&gc->mark_stack, GC_MARK_STACK_CAPACITY)) {
+    free(gc->roots);
+    return false;
+  }
 
   // stack scanning
   gc->stack_bottom = NULL;
@@ -130,6 +145,7 @@ bool simple_gc_init(gc_t* gc, size_t init_capacity) {
 
   // memory pools
   if (!gc_pool_init_all_classes(gc->size_classes)) {
+    gc_mark_stack_destroy(&gc->mark_stack);
     free(gc->roots);
     return false;
   }
@@ -140,6 +156,10 @@ bool simple_gc_init(gc_t* gc, size_t init_capacity) {
   gc->huge_objects = NULL;
   gc->huge_object_count = 0;
 
+  gc->lazy_sweep = false;
+  gc->sweep_pending = 0;
+  gc_sweep_lazy_init(gc);
+
   // memory pressure
   gc->config = gc_default_config();
   gc->pressure = GC_PRESSURE_NONE;
@@ -148,6 +168,7 @@ bool simple_gc_init(gc_t* gc, size_t init_capacity) {
   gc->last_collect_time = 0;
   gc->last_alloc_time = 0;
   gc->last_collection_duration = 0;
+  gc_report_init(&gc->report);
 
   // stats
   gc->total_allocations = 0;
@@ -155,6 +176,8 @@ bool simple_gc_init(gc_t* gc, size_t init_capacity) {
   gc->total_bytes_allocated = 0;
   gc->total_bytes_freed = 0;
   gc->total_compactions = 0;
+  gc_compact_init(&gc->compaction);
+  gc->handles = NULL;
   gc->bytes_reclaimed = 0;
 
   // tracing/debugging
@@ -172,8 +195,13 @@ void simple_gc_destroy(gc_t* gc) {
     return;
   }
 
+  if (gc->concurrent) gc_concurrent_destroy(gc);
+  if (gc->incremental) gc_incremental_destroy(gc);
+  if (gc->sweeper) gc_sweeper_destroy(gc);
+  if (gc->workers) simple_gc_disable_parallel_sweep(gc);
   if (gc->barrier_context) gc_barrier_destroy(gc);
   if (gc->gen_context) gc_gen_destroy(gc);
+  if (gc->handles) simple_gc_disable_handles(gc);
 
   // end tracing if active
   if (gc->trace) gc_trace_end(gc);
@@ -218,6 +246,10 @@ void simple_gc_destroy(gc_t* gc) {
   gc->root_count = 0;
   gc->root_capacity = 0;
   gc->references = NULL;
+  free(gc->slot_index.entries);
+  gc->slot_index = (gc_slot_index_t){0};
+  gc_mark_stack_destroy(&gc->mark_stack);
+  gc_compact_destroy(&gc->compaction);
 }
 
 size_t simple_gc_object_count(const gc_t* gc) {
@@ -270,6 +302,12 @@ void *simple_gc_alloc(gc_t *gc, obj_type_t type, size_t size) {
   if (!gc || size == 0) return NULL;
 
   if (gc->gen_context && gc_gen_enabled(gc)) {
+    // collect before allocating: the new object is not reachable until the
+    // caller stores it, a collection right after would drop it
+    if (gc_gen_should_collect_minor(gc)) {
+      gc_gen_collect_minor(gc);
+    }
+
     void *result = gc_gen_alloc(gc, type, size);
     if (result) {
       // bookkeeping for legacy mode
@@ -278,14 +316,14 @@ void *simple_gc_alloc(gc_t *gc, obj_type_t type, size_t size) {
       size_t total_size = sizeof(obj_header_t) + size;
       gc->total_bytes_allocated += total_size;
       update_heap_bounds(gc, result, size);
-      if (gc_gen_should_collect_minor(gc)) {
-        gc_gen_collect_minor(gc);
-      }
       return result;
     }
     return NULL;
   }
 
+  // mutator threads share the rate and pressure bookkeeping
+  gc_concurrent_lock(gc);
+
   clock_t now = clock();
   if (gc->last_alloc_time > 0) {
     clock_t time_since_last = now - gc->last_alloc_time;
@@ -298,16 +336,57 @@ void *simple_gc_alloc(gc_t *gc, obj_type_t type, size_t size) {
   }
   gc->last_alloc_time = now;
 
-  // auto-collect if pressure indicates to do so
+  // garbage left from the last cycle may be enough, sweep it before collecting again
+  if (gc->sweep_pending > 0 && gc_should_auto_collect(gc)) {
+    gc_sweep_finish(gc);
+  }
+
+  // auto-collect if pressure indicates to do so; incremental mode paces a
+  // running cycle with one bounded step per allocation instead
   gc_update_pressure(gc);
-  if (gc_should_auto_collect(gc)) simple_gc_collect(gc);
+  bool collect = gc_should_auto_collect(gc);
+  bool marking = gc_concurrent_marking(gc);
+  gc_concurrent_unlock(gc);
+
+  // another mutator may get there first, start and finish check again
+  if (gc->incremental) {
+    if (gc_incremental_marking(gc) || collect) {
+      simple_gc_collect_step(gc, gc->incremental->budget_us);
+    }
+  } else if (gc->concurrent) {
+    if (!marking) {
+      if (collect) simple_gc_collect_concurrent_start(gc);
+    } else if (gc_concurrent_mark_done(gc)) {
+      simple_gc_collect_concurrent_finish(gc);
+    }
+  } else if (collect) {
+    simple_gc_collect(gc);
+  }
 
   // capacity check
   size_t total_size = sizeof(obj_header_t) + size;
-  if (total_size + gc->heap_used > gc->heap_capacity) return NULL;
+  gc_concurrent_lock(gc);
+  bool full = total_size + gc->heap_used > gc->heap_capacity;
+  gc_concurrent_unlock(gc);
+  if (full) {
+    // out of room mid-cycle, finish it to reclaim garbage
+    if (gc_incremental_marking(gc)) simple_gc_collect_step(gc, GC_INCREMENTAL_UNBOUNDED);
+    if (gc->concurrent) simple_gc_collect_concurrent_finish(gc);
+
+    gc_concurrent_lock(gc);
+    gc_sweep_finish(gc);
+    gc_concurrent_unlock(gc);
+  }
 
   void *result = NULL;
 
+  // the background marker reads pools and lists while we modify them
+  gc_concurrent_lock(gc);
+  if (total_size + gc->heap_used > gc->heap_capacity) {
+    gc_concurrent_unlock(gc);
+    return NULL;
+  }
+
   if (gc->use_pools) {
     size_class_t *sc = gc_pool_get_size_class(gc->size_classes, size);
     if (sc) {
@@ -323,12 +402,14 @@ void *simple_gc_alloc(gc_t *gc, obj_type_t type, size_t size) {
     // allocate total memory for object+header
     obj_header_t* header = (obj_header_t*) malloc(total_size);
     if (!header) {
+      gc_concurrent_unlock(gc);
       return NULL;
 
     }
     // verify we can initialize the header
     if (!simple_gc_init_header(header, type, size)) {
       free(header);
+      gc_concurrent_unlock(gc);
       return NULL;
     }
 
@@ -340,6 +421,11 @@ void *simple_gc_alloc(gc_t *gc, obj_type_t type, size_t size) {
 
   // bookkeeping for legacy mode
   if (result) {
+    // allocate black while a cycle is marking
+    if (gc_incremental_marking(gc) || gc_concurrent_marking(gc)) {
+      ((obj_header_t*) result - 1)->marked = true;
+    }
+
     GC_TRACE_ALLOC(gc, result, size, type, __FILE__, __LINE__);
     gc->allocs_since_collect++;
     gc->object_count++;
@@ -348,6 +434,7 @@ void *simple_gc_alloc(gc_t *gc, obj_type_t type, size_t size) {
     gc->total_allocations++;
     gc->total_bytes_allocated += total_size;
   }
+  gc_concurrent_unlock(gc);
   return result;
 }
 
@@ -382,18 +469,8 @@ obj_header_t* gc_find_header_in_pools(gc_t *gc, void *ptr) {
         void *expected_data_ptr = (void*)(header + 1);
 
         if (expected_data_ptr == ptr) {
-          // check if this slot is actually in use (not in free list)
-          bool is_free = false;
-          free_node_t *free_node = block->free_list;
-          while (free_node) {
-            if ((void*)free_node == (void*)header) {
-              is_free = true;
-              break;
-            }
-            free_node = free_node->next;
-          }
-
-          if (!is_free && simple_gc_is_valid_header(header)) {
+          // check if this slot is actually in use
+          if (gc_pool_slot_in_use(block, header) && simple_gc_is_valid_header(header)) {
             return header;
           }
         }
@@ -411,59 +488,9 @@ obj_header_t* gc_find_header_in_pools(gc_t *gc, void *ptr) {
 obj_header_t *simple_gc_find_header(gc_t *gc, void *ptr) {
   if (!gc || !ptr) return NULL;
 
-  // check young generation
-  if (gc->gen_context && gc_gen_enabled(gc)) {
-    gc_gen_t *gen = gc->gen_context;
-
-    // search young pools
-    for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
-      size_class_t *sc = &gen->young_pools[i];
-      pool_block_t *block = sc->blocks;
-
-      while (block) {
-        if (gc_pool_pointer_in_block(block, ptr)) {
-          char *base = (char*) block->memory;
-          char *mem_start = (char*) ptr;
-          ptrdiff_t offset = mem_start - base;
-          size_t slot_index = offset / block->slot_size;
-          char *slot_start = base + (slot_index * block->slot_size);
-
-          obj_header_t *header = (obj_header_t*) slot_start;
-          void *expected_data_ptr = (void*)(header + 1);
-
-          if (expected_data_ptr == ptr) { // check if slot in use
-            bool is_free = false;
-            free_node_t *free_node = block->free_list;
-
-            while (free_node) {
-              if ((void*)free_node == (void*)header) {
-                is_free = true;
-                break;
-              }
-              free_node = free_node->next;
-            }
-            if (!is_free && simple_gc_is_valid_header(header)) {
-              return header;
-            }
-          }
-
-          return NULL;
-        }
-
-        block = block->next;
-      }
-    }
-
-
-    // search young large blocks
-    large_block_t *large = gen->young_large;
-    while (large) {
-      void *data = (void*)(large->header + 1);
-      if (data == ptr) {
-        return large->header;
-      }
-      large = large->next;
-    }
+  // young objects live only in the nursery
+  if (gc->gen_context && gc_gen_enabled(gc) && gc_gen_in_nursery(gc->gen_context, ptr)) {
+    return gc_gen_nursery_header(gc->gen_context, ptr);
   }
 
   // check old gen pools
@@ -496,8 +523,12 @@ bool simple_gc_add_root(gc_t *gc, void *ptr) {
     return false;
   }
 
+  // the final pause rescans the roots
+  gc_concurrent_lock(gc);
+
   obj_header_t* header = simple_gc_find_header(gc, ptr);
   if (!header) {
+    gc_concurrent_unlock(gc);
     return false;
   }
 
@@ -506,6 +537,7 @@ bool simple_gc_add_root(gc_t *gc, void *ptr) {
     size_t new_capacity = gc->root_capacity * 2 + 1;
     void** new_roots = (void**) realloc(gc->roots, new_capacity * sizeof(void*));
     if (!new_roots) {
+      gc_concurrent_unlock(gc);
       return false;
     }
 
@@ -520,6 +552,7 @@ bool simple_gc_add_root(gc_t *gc, void *ptr) {
     gc_trace_event(gc, &event);
   }
 
+  gc_concurrent_unlock(gc);
   return true;
 }
 
@@ -528,12 +561,14 @@ bool simple_gc_remove_root(gc_t *gc, void *ptr) {
     return false;
   }
 
+  gc_concurrent_lock(gc);
+
   // find the root
   for (size_t i = 0; i < gc->root_count; ++i) {
     if (gc->roots[i] == ptr) {
       // shift all elements after, overwriting what we want to remove
       for (size_t j = i; j < gc->root_count - 1; ++j) {
-        gc->roots[i] = gc->roots[j + 1];
+        gc->roots[j] = gc->roots[j + 1];
       }
       // update and return found
       gc->root_count--;
@@ -542,9 +577,11 @@ bool simple_gc_remove_root(gc_t *gc, void *ptr) {
         gc_trace_event_t event = {.type = GC_EVENT_ROOT_REMOVE};
         gc_trace_event(gc, &event);
       }
+      gc_concurrent_unlock(gc);
       return true;
     }
   }
+  gc_concurrent_unlock(gc);
   return false;  // not found
 }
 
@@ -562,16 +599,96 @@ bool simple_gc_is_root(gc_t *gc, void *ptr) {
   return false;
 }
 
+static void gc_compact_heap(gc_t *gc);
+
+// sweep, compact and tune once marking has completed
+static void gc_finish_cycle(gc_t *gc) {
+  uint64_t phase_start = gc_report_now_us();
+
+  // sweep phase
+  if (gc->trace) {
+    gc_trace_event_t event = {.type = GC_EVENT_SWEEP_START};
+    gc_trace_event(gc, &event);
+  }
+
+  if (gc->lazy_sweep) {
+    gc_sweep_lazy_begin(gc);
+  } else {
+    gc_sweep_all(gc);
+  }
+
+  if (gc->trace) {
+    gc_trace_event_t event = {.type = GC_EVENT_SWEEP_END};
+    gc_trace_event(gc, &event);
+  }
+
+  gc_report_phase(gc, GC_PHASE_SWEEP, gc_report_now_us() - phase_start);
+
+  // pool utilization is stale until lazy sweeping catches up, so compaction
+  // and tuning wait for an explicit request
+  if (gc->lazy_sweep) {
+    gc_compact_unpin_stack(&gc->compaction);
+    gc->allocs_since_collect = 0;
+    return;
+  }
+
+  // auto-compact if fragmented
+  phase_start = gc_report_now_us();
+  if (simple_gc_should_compact(gc)) {
+    if (gc->trace) {
+      gc_trace_event_t event = {.type = GC_EVENT_COMPACT_START};
+      gc_trace_event(gc, &event);
+
+    }
+    gc_compact_heap(gc);
+
+    if (gc->trace) {
+      gc_trace_event_t event = {.type = GC_EVENT_COMPACT_END};
+      gc_trace_event(gc, &event);
+    }
+  }
+  gc_report_phase(gc, GC_PHASE_COMPACT, gc_report_now_us() - phase_start);
+
+  phase_start = gc_report_now_us();
+  simple_gc_auto_tune(gc);
+  gc_report_phase(gc, GC_PHASE_TUNE, gc_report_now_us() - phase_start);
+
+  // the old generation's cards are laid out again over what survived
+  gc_gen_after_full_collection(gc);
+
+  // stack pins only hold for the scan that found them
+  gc_compact_unpin_stack(&gc->compaction);
+  gc->allocs_since_collect = 0;
+}
+
+// publish the pause as the last collection duration, returns milliseconds
+static double gc_record_pause(gc_t *gc, uint64_t pause_us) {
+  gc->last_collection_duration = (double) pause_us / 1000000.0;
+  return (double) pause_us / 1000.0;
+}
+
+static void gc_walk_stack(gc_t *gc, bool shade);
 
 void simple_gc_collect(gc_t *gc) {
   if (!gc) {
     return;
   }
 
-  clock_t start = clock();
+  // a full collection supersedes any in-progress incremental or concurrent
+  // cycle, then stops the world until the sweep is done
+  gc_concurrent_pause_lock(gc);
+  gc_incremental_abort(gc);
+  gc_concurrent_abort(gc);
+  gc_concurrent_lock(gc);
+
+  // live objects in unswept blocks are still marked from the last cycle
+  gc_sweep_finish(gc);
+  gc_compact_unpin_stack(&gc->compaction);
+
   size_t objects_before = gc->object_count;
   size_t bytes_before = gc->heap_used;
   GC_TRACE_COLLECT_START(gc, "full", objects_before, bytes_before);
+  gc_report_begin(gc, "full");
 
   gc->total_collections++;
 
@@ -581,57 +698,308 @@ void simple_gc_collect(gc_t *gc) {
     gc_trace_event(gc, &event);
   }
 
-  gc_mark_all_roots(gc);
-
-  // automated root scanning
+  // shade explicit roots and, with automated root scanning, the stack
+  uint64_t phase_start = gc_report_now_us();
+  gc_mark_shade_roots(gc);
   if (gc->auto_root_scan_enabled) {
-    simple_gc_scan_stack(gc);
+    gc_walk_stack(gc, true);
   }
 
+  uint64_t mark_start = gc_report_now_us();
+  gc_report_phase(gc, GC_PHASE_ROOTS, mark_start - phase_start);
+
+  gc_mark_complete(gc);
+  gc_report_phase(gc, GC_PHASE_MARK, gc_report_now_us() - mark_start);
+
   if (gc->trace) {
     gc_trace_event_t event = {.type = GC_EVENT_MARK_END};
     gc_trace_event(gc, &event);
   }
 
-  // sweep phase
+  gc_finish_cycle(gc);
+
+  gc_report_end(gc);
+  double duration = gc_record_pause(gc, gc_report_last(gc)->total_us);
+  size_t collected = objects_before - gc->object_count;
+
+  GC_TRACE_COLLECT_END(gc, gc->object_count, gc->heap_used, collected, 0, duration);
+  gc_concurrent_unlock(gc);
+  gc_concurrent_pause_unlock(gc);
+}
+
+bool simple_gc_enable_lazy_sweep(gc_t *gc) {
+  if (!gc) return false;
+  if (gc_gen_enabled(gc)) return false;
+
+  gc->lazy_sweep = true;
+  return true;
+}
+
+void simple_gc_disable_lazy_sweep(gc_t *gc) {
+  if (!gc) return;
+
+  simple_gc_disable_background_sweep(gc);
+  gc_sweep_finish(gc);
+  gc->lazy_sweep = false;
+}
+
+bool simple_gc_is_lazy_sweep(gc_t *gc) {
+  return (gc && gc->lazy_sweep);
+}
+
+size_t simple_gc_sweep_step(gc_t *gc, size_t max_blocks) {
+  if (!gc) return 0;
+
+  gc_concurrent_lock(gc);
+  size_t swept = gc_sweep_lazy_step(gc, max_blocks);
+  gc_concurrent_unlock(gc);
+  return swept;
+}
+
+bool simple_gc_enable_background_sweep(gc_t *gc) {
+  if (!gc) return false;
+  if (gc->sweeper) return true;
+  if (!simple_gc_enable_lazy_sweep(gc)) return false;
+
+  return gc_sweeper_init(gc);
+}
+
+void simple_gc_disable_background_sweep(gc_t *gc) {
+  if (!gc || !gc->sweeper) return;
+
+  // lazy sweeping stays on, the remaining blocks are swept on demand
+  gc_concurrent_lock(gc);
+  gc_sweep_finish(gc);
+  gc_concurrent_unlock(gc);
+  gc_sweeper_destroy(gc);
+}
+
+bool simple_gc_is_background_sweep(gc_t *gc) {
+  return (gc && gc->sweeper);
+}
+
+bool simple_gc_enable_parallel_sweep(gc_t *gc, size_t threads) {
+  if (!gc) return false;
+  if (gc->workers) return true;
+
+  gc->workers = gc_workers_create(threads);
+  return gc->workers != NULL;
+}
+
+void simple_gc_disable_parallel_sweep(gc_t *gc) {
+  if (!gc || !gc->workers) return;
+
+  gc_workers_destroy(gc->workers);
+  gc->workers = NULL;
+}
+
+bool simple_gc_is_parallel_sweep(gc_t *gc) {
+  return (gc && gc->workers);
+}
+
+bool simple_gc_last_cycle(gc_t *gc, gc_cycle_report_t *report) {
+  if (!gc || !report) return false;
+
+  const gc_cycle_report_t *last = gc_report_last(gc);
+  if (!last) return false;
+
+  *report = *last;
+  return true;
+}
+
+size_t simple_gc_cycle_history(gc_t *gc, gc_cycle_report_t *reports, size_t max) {
+  return gc_report_history(gc, reports, max);
+}
+
+bool simple_gc_enable_incremental(gc_t *gc) {
+  if (!gc) return false;
+  if (gc->incremental) return true;
+  if (gc_gen_enabled(gc) || gc->concurrent) return false;
+
+  if (!gc_incremental_init(gc)) return false;
+
+  // mutations between steps go through the insertion barrier
+  if (!gc->barrier_context && !gc_barrier_init(gc, GC_BARRIER_INCREMENTAL)) {
+    gc_incremental_destroy(gc);
+    return false;
+  }
+  gc_barrier_update_filter(gc);
+  return true;
+}
+
+void simple_gc_disable_incremental(gc_t *gc) {
+  if (!gc || !gc->incremental) return;
+
+  gc_incremental_abort(gc);
+  gc_incremental_destroy(gc);
+
+  if (gc->barrier_context && gc->barrier_context->type == GC_BARRIER_INCREMENTAL) {
+    gc_barrier_destroy(gc);
+  }
+  gc_barrier_update_filter(gc);
+}
+
+bool simple_gc_is_incremental(gc_t *gc) {
+  return (gc && gc->incremental);
+}
+
+bool simple_gc_collect_step(gc_t *gc, size_t budget_us) {
+  if (!gc) return false;
+  if (!gc->incremental && !simple_gc_enable_incremental(gc)) return false;
+
+  gc_incremental_t *inc = gc->incremental;
+
+  if (!gc_incremental_marking(gc)) {
+    // lazily swept blocks are credited to the cycle that found them dead
+    gc_sweep_finish(gc);
+    gc_compact_unpin_stack(&gc->compaction);
+
+    GC_TRACE_COLLECT_START(gc, "incremental", gc->object_count, gc->heap_used);
+    gc_report_begin(gc, "incremental");
+    gc->total_collections++;
+
+    if (gc->trace) {
+      gc_trace_event_t event = {.type = GC_EVENT_MARK_START};
+      gc_trace_event(gc, &event);
+    }
+  }
+
+  if (!gc_incremental_step(gc, budget_us)) {
+    return false;
+  }
+
   if (gc->trace) {
-    gc_trace_event_t event = {.type = GC_EVENT_SWEEP_START};
+    gc_trace_event_t event = {.type = GC_EVENT_MARK_END};
     gc_trace_event(gc, &event);
   }
 
-  gc_sweep_all(gc);
+  gc_report_phase(gc, GC_PHASE_MARK, inc->cycle_pause_us);
+
+  uint64_t start = gc_report_now_us();
+  gc_finish_cycle(gc);
+
+  // pause time is the sum of the marking steps plus the final sweep
+  gc_report_end(gc);
+  double duration = gc_record_pause(gc, inc->cycle_pause_us + (gc_report_now_us() - start));
+
+  size_t collected = inc->cycle_objects_before > gc->object_count
+    ? inc->cycle_objects_before - gc->object_count
+    : 0;
+
+  GC_TRACE_COLLECT_END(gc, gc->object_count, gc->heap_used, collected, 0, duration);
+  return true;
+}
+
+bool simple_gc_enable_concurrent(gc_t *gc) {
+  if (!gc) return false;
+  if (gc->concurrent) return true;
+  if (gc_gen_enabled(gc) || gc->incremental) return false;
+
+  if (!gc_concurrent_init(gc)) return false;
+
+  // removed references are logged by the snapshot barrier
+  if (!gc->barrier_context && !gc_barrier_init(gc, GC_BARRIER_SNAPSHOT)) {
+    gc_concurrent_destroy(gc);
+    return false;
+  }
+  gc_barrier_update_filter(gc);
+  return true;
+}
+
+void simple_gc_disable_concurrent(gc_t *gc) {
+  if (!gc || !gc->concurrent) return;
+
+  gc_concurrent_destroy(gc);
+
+  if (gc->barrier_context && gc->barrier_context->type == GC_BARRIER_SNAPSHOT) {
+    gc_barrier_destroy(gc);
+  }
+  gc_barrier_update_filter(gc);
+}
+
+bool simple_gc_is_concurrent(gc_t *gc) {
+  return (gc && gc->concurrent);
+}
+
+bool simple_gc_collect_concurrent_start(gc_t *gc) {
+  if (!gc) return false;
+  if (!gc->concurrent && !simple_gc_enable_concurrent(gc)) return false;
+
+  gc_concurrent_pause_lock(gc);
+  gc_concurrent_lock(gc);
+  if (gc_concurrent_marking(gc)) {
+    gc_concurrent_unlock(gc);
+    gc_concurrent_pause_unlock(gc);
+    return false;
+  }
+
+  gc_sweep_finish(gc);
+  gc_compact_unpin_stack(&gc->compaction);
+
+  GC_TRACE_COLLECT_START(gc, "concurrent", gc->object_count, gc->heap_used);
+  gc_report_begin(gc, "concurrent");
+  gc->total_collections++;
 
   if (gc->trace) {
-    gc_trace_event_t event = {.type = GC_EVENT_SWEEP_END};
+    gc_trace_event_t event = {.type = GC_EVENT_MARK_START};
     gc_trace_event(gc, &event);
   }
 
-  // auto-compact if fragmented
-  if (simple_gc_should_compact(gc)) {
-    if (gc->trace) {
-      gc_trace_event_t event = {.type = GC_EVENT_COMPACT_START};
-      gc_trace_event(gc, &event);
+  // the initial pause snapshots the roots
+  uint64_t initial_before = gc->concurrent->stats.initial_pause_us;
+  bool started = gc_concurrent_start(gc);
+  gc_report_phase(gc, GC_PHASE_ROOTS, gc->concurrent->stats.initial_pause_us - initial_before);
+  gc_concurrent_unlock(gc);
+  gc_concurrent_pause_unlock(gc);
+  return started;
+}
 
-    }
-    simple_gc_compact(gc);
+bool simple_gc_concurrent_mark_done(gc_t *gc) {
+  return gc_concurrent_mark_done(gc);
+}
 
-    if (gc->trace) {
-      gc_trace_event_t event = {.type = GC_EVENT_COMPACT_END};
-      gc_trace_event(gc, &event);
-    }
+void simple_gc_collect_concurrent_finish(gc_t *gc) {
+  if (!gc || !gc->concurrent) return;
+
+  // another mutator may have finished the cycle while we waited for the
+  // marker; the world stays stopped from the remark through the sweep
+  gc_concurrent_pause_lock(gc);
+  gc_concurrent_join(gc);
+  gc_concurrent_lock(gc);
+  if (!gc_concurrent_marking(gc)) {
+    gc_concurrent_unlock(gc);
+    gc_concurrent_pause_unlock(gc);
+    return;
   }
 
-  simple_gc_auto_tune(gc);
+  gc_concurrent_t *conc = gc->concurrent;
+  uint64_t final_before = conc->stats.final_pause_us;
 
-  clock_t end = clock();
+  gc_concurrent_final_mark(gc);
 
-  gc->allocs_since_collect = 0;
-  gc->last_collection_duration = (double) (end - start) / CLOCKS_PER_SEC;
+  if (gc->trace) {
+    gc_trace_event_t event = {.type = GC_EVENT_MARK_END};
+    gc_trace_event(gc, &event);
+  }
 
-  double duration = (double) (end - start) / CLOCKS_PER_SEC * 1000.0;
-  size_t collected = objects_before - gc->object_count;
+  // only the initial and final pauses, not the marking on the background thread
+  uint64_t final_pause_us = conc->stats.final_pause_us - final_before;
+  gc_report_phase(gc, GC_PHASE_MARK, final_pause_us);
+
+  uint64_t start = gc_report_now_us();
+  gc_finish_cycle(gc);
+
+  uint64_t initial_pause_us = gc_report_last(gc)->phase_us[GC_PHASE_ROOTS];
+  gc_report_end(gc);
+  double duration = gc_record_pause(gc, initial_pause_us + final_pause_us + (gc_report_now_us() - start));
+
+  size_t collected = conc->cycle_objects_before > gc->object_count
+    ? conc->cycle_objects_before - gc->object_count
+    : 0;
 
   GC_TRACE_COLLECT_END(gc, gc->object_count, gc->heap_used, collected, 0, duration);
+  gc_concurrent_unlock(gc);
+  gc_concurrent_pause_unlock(gc);
 }
 
 bool simple_gc_add_reference(gc_t *gc, void *from_ptr, void *to_ptr) {
@@ -639,23 +1007,27 @@ bool simple_gc_add_reference(gc_t *gc, void *from_ptr, void *to_ptr) {
     return false;
   }
 
+  gc_concurrent_lock(gc);
+
   if (!simple_gc_find_header(gc, from_ptr) || !simple_gc_find_header(gc, to_ptr)) {
+    gc_concurrent_unlock(gc);
     return false;
   }
 
-  if (gc->barrier_context) gc_barrier_write(gc, from_ptr, to_ptr);
+  GC_WRITE(gc, from_ptr, to_ptr);
 
   ref_node_t* ref = (ref_node_t*) malloc(sizeof(ref_node_t));
   if (!ref) {
+    gc_concurrent_unlock(gc);
     return false;
   }
 
   ref->from_obj = from_ptr;
   ref->to_obj = to_ptr;
+  ref->slot = GC_REF_NO_SLOT;
+  gc_ref_link(gc, ref);
 
-  ref->next = gc->references;
-  gc->references = ref;
-
+  gc_concurrent_unlock(gc);
   return true;
 }
 
@@ -664,17 +1036,21 @@ bool simple_gc_remove_reference(gc_t *gc, void *from_ptr, void *to_ptr) {
     return false;
   }
 
-  ref_node_t** curr = &gc->references;
-  while (*curr) {
-    ref_node_t* ref = *curr;
+  gc_concurrent_lock(gc);
+
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) {
     if (ref->from_obj == from_ptr && ref->to_obj == to_ptr) {
-      *curr = ref->next;
+      if (gc->barrier_context) gc_barrier_delete(gc, from_ptr, to_ptr);
+
+      if (ref->slot != GC_REF_NO_SLOT) gc->slot_index.valid = false;
+      gc_ref_unlink(ref);
       free(ref);
+      gc_concurrent_unlock(gc);
       return true;
     }
-    curr = &(*curr)->next;
   }
 
+  gc_concurrent_unlock(gc);
   return false;
 }
 
@@ -718,10 +1094,17 @@ bool simple_gc_is_heap_pointer(gc_t *gc, void *ptr) {
     }
     curr = curr->next;
   }
+
+  // pool, large and huge objects are only recognized by their data pointer
+  if (gc->use_pools) {
+    return simple_gc_find_header(gc, ptr) != NULL;
+  }
   return false;
 }
 
-void simple_gc_scan_stack(gc_t* gc) {
+// pin every object an ambiguous stack word points at and, when shading, mark
+// it gray; the caller completes marking
+static void gc_walk_stack(gc_t *gc, bool shade) {
   if (!gc || !gc->stack_bottom || !gc->auto_root_scan_enabled) return;
 
   // save registers to the stack
@@ -747,9 +1130,11 @@ void simple_gc_scan_stack(gc_t* gc) {
   while (curr_word < last_word) {
     void *check = (void*)(*curr_word);
     if (simple_gc_is_heap_pointer(gc, check)) {
-      obj_header_t * header = simple_gc_find_header(gc, check);
-      if (header && !header->marked) {
-        gc_mark_object(gc, check);
+      obj_header_t *header = simple_gc_find_header(gc, check);
+      if (header) {
+        // the word may be the only reference, so the object cannot move
+        gc_compact_pin_stack(&gc->compaction, header);
+        if (shade) gc_mark_shade(gc, check);
       }
     }
     // for now, accept false positives (integers mistaken for pointers)
@@ -759,6 +1144,13 @@ void simple_gc_scan_stack(gc_t* gc) {
 
 }
 
+void simple_gc_scan_stack(gc_t* gc) {
+  if (!gc || !gc->stack_bottom || !gc->auto_root_scan_enabled) return;
+
+  gc_walk_stack(gc, true);
+  gc_mark_complete(gc);
+}
+
 bool simple_gc_auto_init_stack(gc_t *gc) {
   if (!gc) return false;
 
@@ -770,263 +1162,248 @@ bool simple_gc_auto_init_stack(gc_t *gc) {
   return true;
 }
 
-static bool gc_add_relocation(compaction_ctx_t *ctx, void *old_addr, void *new_addr) {
-  if (!ctx || !old_addr || !new_addr) return false;
-
-  relocation_entry_t *entry = (relocation_entry_t*) malloc(sizeof(relocation_entry_t));
-  if (!entry) return false;
-
-  entry->old_addr = old_addr;
-  entry->new_addr = new_addr;
-  entry->next = ctx->relocations;
-
-  ctx->relocations = entry;
-  ctx->relocation_count++;
-
-  return true;
-}
+bool simple_gc_should_compact(gc_t *gc) {
+  if (!gc || !gc->use_pools) return false;
 
-static void *gc_find_new_address(compaction_ctx_t *ctx, void *old_addr) {
-  if (!ctx || !old_addr) return NULL;
+  gc_frag_histogram_t histogram;
+  gc_compact_histogram(gc, &histogram);
 
-  relocation_entry_t *entry = ctx->relocations;
-  while (entry) {
-    if (entry->old_addr == old_addr) {
-      return entry->new_addr;
-    }
-    entry = entry->next;
+  // free space trapped in sparse blocks, worth it once a block could be freed
+  size_t sparse_buckets = (size_t)(GC_COMPACT_SPARSE_OCCUPANCY * GC_FRAG_BUCKETS);
+  size_t sparse_free = 0;
+  for (size_t i = 0; i < sparse_buckets; ++i) {
+    sparse_free += histogram.free_bytes[i];
   }
+  if (sparse_free >= GC_POOL_BLOCK_SIZE) return true;
 
-  // did not relocate
-  return old_addr;
+  return gc->compaction.compact_large &&
+      gc_compact_large_free_bytes(gc) >= GC_COMPACT_LARGE_FREE_BYTES;
 }
 
-static void gc_clear_relocations(compaction_ctx_t *ctx) {
-  if (!ctx) return;
-
-  relocation_entry_t *entry = ctx->relocations;
-  while (entry) {
-    relocation_entry_t* next = entry->next;
-    free(entry);
-    entry = next;
-  }
+void simple_gc_compact(gc_t *gc) {
+  if (!gc || !gc->use_pools) return;
 
-  ctx->relocations = NULL;
-  ctx->relocation_count = 0;
+  // the marker holds pointers into the blocks we would move, the cycle
+  // compacts when it finishes instead
+  gc_concurrent_lock(gc);
+  if (!gc_concurrent_marking(gc)) gc_compact_heap(gc);
+  gc_concurrent_unlock(gc);
 }
 
-static void gc_compact_size_class(gc_t *gc, size_class_t *sc) {
-  if (!gc || !sc || sc->total_used == 0) return;
+static void gc_compact_heap(gc_t *gc) {
+  // unswept blocks would carry dead objects along
+  gc_sweep_finish(gc);
 
-  float util = gc_pool_utilization(sc);
-  // good utilization, don't compact
-  if (util > 0.7f) return;
+  // ambiguous stack words may point at any object, refresh their pins
+  if (gc->auto_root_scan_enabled) gc_walk_stack(gc, false);
 
-  live_obj_t *live_objects = (live_obj_t*) malloc(sizeof(live_obj_t) * sc->total_used);
-  if (!live_objects) return;
+  gc->compaction.in_progress = true;
 
-  // collect live objects
-  size_t live_count = 0;
-  pool_block_t *block = sc->blocks;
-  while (block) {
-    char *slot = (char*) block->memory;
+  // Track fragmentation reduction instead of heap usage
+  size_t fragmented_before = 0;
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    size_class_t *sc = &gc->size_classes[i];
+    fragmented_before += gc_pool_fragmented_bytes(sc);
+  }
 
-    for (size_t i = 0; i < block->capacity; ++i) {
-      bool in_use = true;
-      obj_header_t *header = (obj_header_t*) slot;
-      free_node_t *free_node = block->free_list;
+  if (gc->compaction.mode == GC_COMPACT_EVACUATE) {
+    // copy out the sparsest blocks only, bounded by the evacuation budget
+    gc_compact_evacuate(gc);
+  } else if (gc->compaction.mode == GC_COMPACT_DEPTH_FIRST ||
+             gc->compaction.mode == GC_COMPACT_BREADTH_FIRST) {
+    // reorder survivors by traversal order, parents next to their children
+    gc_compact_locality(gc, gc->compaction.mode == GC_COMPACT_BREADTH_FIRST);
+  } else {
+    // slide survivors of each fragmented size class and release emptied blocks
+    gc_compact_pools(gc);
+  }
 
-      while (free_node) {
-        if ((void*) free_node == (void*) header) {
-          in_use = false;
-          break;
-        }
-        free_node = free_node->next;
-      }
+  // large objects are packed whatever the pool policy
+  if (gc->compaction.compact_large) gc_compact_large(gc);
 
-      if (in_use) {
-        live_objects[live_count].header = header;
-        live_objects[live_count].data = (void*)(header + 1);
-        live_objects[live_count].block = block;
-        ++live_count;
-      }
+  gc->compaction.in_progress = false;
+  gc->total_compactions++;
+  gc_compact_unpin_stack(&gc->compaction);
 
-      slot += block->slot_size;
-    }
+  // cards, crossing map and remembered sources still name the old addresses
+  gc_gen_after_full_collection(gc);
 
-    block = block->next;
+  // Calculate fragmentation after compaction
+  size_t fragmented_after = 0;
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    size_class_t *sc = &gc->size_classes[i];
+    fragmented_after += gc_pool_fragmented_bytes(sc);
   }
 
-  // find new addresses and register relocations
-  block = sc->blocks;
-  char *dest = (char*) block->memory;
-
-  for (size_t i = 0; i < live_count; ++i) {
-    // obj_header_t *old_header = live_objects[i].header;
-    void *old_data = live_objects[i].data;
+  // Track how much fragmentation was reduced
+  if (fragmented_before > fragmented_after) {
+    gc->bytes_reclaimed += (fragmented_before - fragmented_after);
+  }
+}
 
-    obj_header_t *new_header = (obj_header_t*) dest;
-    void *new_data = (void*)(new_header + 1);
+bool simple_gc_pin(gc_t *gc, void *ptr) {
+  if (!gc || !ptr) return false;
 
-    // register relocation before moving
-    if (old_data != new_data) {
-      gc_add_relocation(&gc->compaction, old_data, new_data);
-    }
+  gc_concurrent_lock(gc);
+  obj_header_t *header = simple_gc_find_header(gc, ptr);
+  if (header) header->pinned |= GC_PIN_EXPLICIT;
+  gc_concurrent_unlock(gc);
+  return header != NULL;
+}
 
-    dest += block->slot_size;
+bool simple_gc_unpin(gc_t *gc, void *ptr) {
+  if (!gc || !ptr) return false;
 
-    // move to next block if the current block is full
-    if (dest >= (char*) block->memory + (block->slot_size * block->capacity)) {
-      block = block->next;
-      if (!block) break;
-      dest = (char*) block->memory;
-    }
+  gc_concurrent_lock(gc);
+  obj_header_t *header = simple_gc_find_header(gc, ptr);
+  if (header) {
+    header->pinned &= (unsigned char) ~GC_PIN_EXPLICIT;
+    if (!header->pinned) gc_gen_unpinned(gc, ptr);
   }
+  gc_concurrent_unlock(gc);
+  return header != NULL;
+}
 
-  // shift objects in the block
-  block = sc->blocks;
-  dest = (char*) block->memory;
-
-  for (size_t i = 0; i < live_count; ++i) {
-    obj_header_t *old_header = live_objects[i].header;
-    obj_header_t *new_header = (obj_header_t*) dest;
-
-    if (old_header != new_header) {
-      memmove(new_header, old_header, sizeof(obj_header_t) + old_header->size);
-    }
-
-    dest += block->slot_size;
+bool simple_gc_is_pinned(gc_t *gc, void *ptr) {
+  if (!gc || !ptr) return false;
 
-    if (dest >= (char*) block->memory + (block->slot_size * block->capacity)) {
-      block = block->next;
-      if (!block) break;
-      dest = (char*) block->memory;
-    }
-  }
+  obj_header_t *header = simple_gc_find_header(gc, ptr);
+  return header && header->pinned;
+}
 
-  free(live_objects);
+bool simple_gc_enable_handles(gc_t *gc) {
+  if (!gc || !gc->use_pools) return false;  // legacy objects reuse the back-pointer
+  if (gc->handles) return true;
 
-  // rebuild free lists
-  block = sc->blocks;
-  size_t objects_placed = 0;
+  gc_handle_table_t *table = (gc_handle_table_t*) malloc(sizeof(gc_handle_table_t));
+  if (!table) return false;
 
-  while (block) {
-    block->free_list = NULL;
-    block->used = 0;
+  gc_handle_table_init(table);
+  gc->handles = table;
+  return true;
+}
 
-    char *slot = (char*) block->memory;
+static void gc_handle_detach(gc_handle_t handle, void *ctx) {
+  obj_header_t *header = simple_gc_find_header((gc_t*) ctx, *handle);
+  if (header) header->handle = NULL;
+}
 
-    for (size_t i = 0; i < block->capacity; ++i) {
-      if (objects_placed < live_count) { // slot is used
-        ++block->used;
-        ++objects_placed;
-      } else { // slot is available, add to free list
-        free_node_t *free_node = (free_node_t*) slot;
-        free_node->next = block->free_list;
-        block->free_list = free_node;
-      }
+// objects only reachable through a handle are collected by the next cycle
+void simple_gc_disable_handles(gc_t *gc) {
+  if (!gc || !gc->handles) return;
 
-      slot += block->slot_size;
-    }
+  gc_concurrent_lock(gc);
+  gc_handle_for_each(gc->handles, gc_handle_detach, gc);
+  gc_handle_table_destroy(gc->handles);
+  free(gc->handles);
+  gc->handles = NULL;
+  gc_concurrent_unlock(gc);
+}
 
-    block = block->next;
-  }
+bool simple_gc_is_handles(gc_t *gc) {
+  return gc && gc->handles;
 }
 
-static void gc_update_pointer(compaction_ctx_t *ctx, void **ptr_ref) {
-  if (!ctx || !ptr_ref || !*ptr_ref) return;
+gc_handle_t simple_gc_alloc_handle(gc_t *gc, obj_type_t type, size_t size) {
+  if (!gc || !gc->handles) return NULL;
 
-  void *new_addr = gc_find_new_address(ctx, *ptr_ref);
-  if (new_addr != *ptr_ref) *ptr_ref = new_addr;
+  void *ptr = simple_gc_alloc(gc, type, size);
+  if (!ptr) return NULL;
+
+  gc_concurrent_lock(gc);
+  obj_header_t *header = simple_gc_find_header(gc, ptr);
+  gc_handle_t handle = header ? gc_handle_new(gc->handles, ptr) : NULL;
+  if (handle) header->handle = handle;
+  gc_concurrent_unlock(gc);
+  return handle;
 }
 
-static void gc_update_all_references(gc_t *gc) {
-  if (!gc) return;
+// the object is replaced by a new one of the given size holding the common
+// prefix; edges recorded with simple_gc_add_reference keep the old address
+bool simple_gc_realloc_handle(gc_t *gc, gc_handle_t handle, size_t size) {
+  if (!gc || !gc->handles || !handle || size == 0) return false;
 
-  compaction_ctx_t *ctx = &gc->compaction;
+  obj_header_t *old_header = simple_gc_find_header(gc, *handle);
+  if (!old_header) return false;
+  if (old_header->size == size) return true;
 
-  // update roots
-  for (size_t i = 0; i < gc->root_count; ++i) {
-    gc_update_pointer(ctx, &gc->roots[i]);
-  }
+  // the handle still roots the old object if this allocation collects
+  void *ptr = simple_gc_alloc(gc, old_header->type, size);
+  if (!ptr) return false;
 
-  // update reference graph
-  ref_node_t *ref = gc->references;
-  while (ref) {
-    gc_update_pointer(ctx, &ref->from_obj);
-    gc_update_pointer(ctx, &ref->to_obj);
-    ref = ref->next;
+  gc_concurrent_lock(gc);
+  old_header = simple_gc_find_header(gc, *handle);
+  obj_header_t *new_header = simple_gc_find_header(gc, ptr);
+  if (!old_header || !new_header) {
+    gc_concurrent_unlock(gc);
+    return false;
   }
+  memcpy(ptr, *handle, old_header->size < size ? old_header->size : size);
 
-  // update heap bounds
-  gc_update_pointer(ctx, &gc->heap_start);
-  gc_update_pointer(ctx, &gc->heap_end);
+  new_header->handle = handle;
+  old_header->handle = NULL;
+  gc_handle_relocate(new_header);
+  gc_concurrent_unlock(gc);
+  return true;
 }
 
-bool simple_gc_should_compact(gc_t *gc) {
-  if (!gc || !gc->use_pools) return false;
+void simple_gc_release_handle(gc_t *gc, gc_handle_t handle) {
+  if (!gc || !gc->handles || !handle) return;
 
-  // stats
-  size_t total_capacity = 0;
-  size_t total_used = 0;
-  size_t fragmented_classes = 0;
+  gc_concurrent_lock(gc);
+  obj_header_t *header = simple_gc_find_header(gc, *handle);
+  if (header && header->handle == handle) header->handle = NULL;
+  gc_handle_free(gc->handles, handle);
+  gc_concurrent_unlock(gc);
+}
 
-  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
-    size_class_t *sc = &gc->size_classes[i];
-    total_capacity += sc->total_capacity;
-    total_used += sc->total_used;
+size_t simple_gc_handle_count(gc_t *gc) {
+  return (gc && gc->handles) ? gc->handles->count : 0;
+}
 
-    if (sc->total_capacity > 0) {
-      float util = gc_pool_utilization(sc);
-      if (util < 0.5f && sc->total_used > 0) {
-        ++fragmented_classes;
-      }
-    }
-  }
+void simple_gc_set_compaction_mode(gc_t *gc, gc_compact_mode_t mode) {
+  if (!gc) return;
+  gc->compaction.mode = mode;
+}
 
-  // compact if overall utilization <50% and multiple classes fragmented
-  if (total_capacity > 0) {
-    float overall_util = (float) total_used / (float) total_capacity;
-    return (overall_util < 0.5 && fragmented_classes >= 1);
-  }
-  return false;
+void simple_gc_set_large_compaction(gc_t *gc, bool enable) {
+  if (!gc) return;
+  gc->compaction.compact_large = enable;
 }
 
-void simple_gc_compact(gc_t *gc) {
+void simple_gc_compact_large(gc_t *gc) {
   if (!gc || !gc->use_pools) return;
 
-  gc->compaction.in_progress = true;
-  gc->compaction.relocations = NULL;
-  gc->compaction.relocation_count = 0;
-
-  // Track fragmentation reduction instead of heap usage
-  size_t fragmented_before = 0;
-  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
-    size_class_t *sc = &gc->size_classes[i];
-    fragmented_before += gc_pool_fragmented_bytes(sc);
+  gc_concurrent_lock(gc);
+  if (gc_concurrent_marking(gc)) {
+    gc_concurrent_unlock(gc);
+    return;
   }
 
-  // compact each size class
-  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
-    gc_compact_size_class(gc, &gc->size_classes[i]);
-  }
-  gc_update_all_references(gc);
-  gc_clear_relocations(&gc->compaction);
+  gc_sweep_finish(gc);
+  if (gc->auto_root_scan_enabled) gc_walk_stack(gc, false);
 
+  gc->compaction.in_progress = true;
+  gc_compact_large(gc);
   gc->compaction.in_progress = false;
-  gc->total_compactions++;
 
-  // Calculate fragmentation after compaction
-  size_t fragmented_after = 0;
-  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
-    size_class_t *sc = &gc->size_classes[i];
-    fragmented_after += gc_pool_fragmented_bytes(sc);
-  }
+  gc_compact_unpin_stack(&gc->compaction);
+  gc_gen_after_full_collection(gc);
+  gc_concurrent_unlock(gc);
+}
 
-  // Track how much fragmentation was reduced
-  if (fragmented_before > fragmented_after) {
-    gc->bytes_reclaimed += (fragmented_before - fragmented_after);
-  }
+void simple_gc_set_evacuation_budget(gc_t *gc, size_t bytes) {
+  if (!gc) return;
+  gc->compaction.evacuate_budget = bytes;
+}
+
+void simple_gc_fragmentation_histogram(gc_t *gc, gc_frag_histogram_t *histogram) {
+  if (!gc || !histogram) return;
+
+  gc_concurrent_lock(gc);
+  gc_sweep_finish(gc);
+  gc_compact_histogram(gc, histogram);
+  gc_concurrent_unlock(gc);
 }
 
 // memory pressure
@@ -1085,6 +1462,8 @@ void simple_gc_set_config(gc_t *gc, gc_config_t *config) {
 void simple_gc_auto_tune(gc_t *gc) {
   if (!gc || !gc->use_pools) return;
 
+  gc_sweep_finish(gc);
+
   for (int i = 0; i < GC_NUM_SIZE_CLASSES; i++) {
     size_class_t *sc = &gc->size_classes[i];
     if (sc->total_capacity == 0) continue;
@@ -1098,6 +1477,8 @@ void simple_gc_auto_tune(gc_t *gc) {
 bool simple_gc_enable_generations(gc_t *gc, size_t young_size) {
   if (!gc) return false;
   if (gc->gen_context) return true; // don't re-initialize
+  // minor collections move objects and free edges outside heap_lock
+  if (gc->concurrent || gc->incremental) return false;
 
   // default to 20% of heap for young gen
   if (young_size == 0) young_size = gc->heap_capacity / 5;
@@ -1190,7 +1571,159 @@ void simple_gc_disable_write_barrier(gc_t *gc) {
 
 void simple_gc_write(gc_t *gc, void *from, void *to) {
   if (!gc) return;
-  gc_barrier_write(gc, from, to);
+  gc_concurrent_lock(gc);
+  GC_WRITE(gc, from, to);
+  gc_concurrent_unlock(gc);
+}
+
+static bool gc_is_young(gc_t *gc, void *ptr) {
+  return gc_gen_enabled(gc) && gc_gen_nursery_header(gc->gen_context, ptr) != NULL;
+}
+
+static gc_slot_entry_t *gc_slot_index_entry(gc_slot_index_t *index, void *obj, bool insert) {
+  if (!index->entries) return NULL;
+
+  // fibonacci hashing like the relocation table
+  size_t mask = index->capacity - 1;
+  uint64_t key = (uint64_t)(uintptr_t) obj >> 4;
+  size_t i = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+  while (index->entries[i].obj && index->entries[i].obj != obj) {
+    i = (i + 1) & mask;
+  }
+
+  if (!index->entries[i].obj) {
+    if (!insert) return NULL;
+    index->entries[i].obj = obj;
+    index->count++;
+  }
+  return &index->entries[i];
+}
+
+// brings the index up to date with the reference list and leaves room for
+// one more source object
+static bool gc_slot_index_prepare(gc_t *gc) {
+  gc_slot_index_t *index = &gc->slot_index;
+  if (index->valid && (index->count + 1) * 2 <= index->capacity) return true;
+
+  size_t sources = 1;
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) {
+    if (ref->slot != GC_REF_NO_SLOT) sources++;
+  }
+
+  size_t capacity = 16;
+  while (capacity < sources * 2) capacity *= 2;
+  if (index->valid && capacity <= index->capacity) capacity = index->capacity * 2;
+
+  if (capacity > index->capacity) {
+    gc_slot_entry_t *entries = (gc_slot_entry_t*) calloc(capacity, sizeof(gc_slot_entry_t));
+    if (!entries) return false;
+    free(index->entries);
+    index->entries = entries;
+    index->capacity = capacity;
+  } else {
+    memset(index->entries, 0, index->capacity * sizeof(gc_slot_entry_t));
+  }
+  index->count = 0;
+  index->valid = true;
+
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) {
+    if (ref->slot == GC_REF_NO_SLOT) continue;
+
+    gc_slot_entry_t *entry = gc_slot_index_entry(index, ref->from_obj, true);
+    ref->slot_next = entry->edges;
+    entry->edges = ref;
+  }
+  return true;
+}
+
+bool simple_gc_array_copy(gc_t *gc, void *dst, size_t dst_offset, const void *src, size_t count) {
+  if (!gc || !dst || !src || count == 0) return false;
+
+  gc_concurrent_lock(gc);
+  obj_header_t *header = simple_gc_find_header(gc, dst);
+  size_t capacity = header ? header->size / sizeof(void*) : 0;
+  if (dst_offset > capacity || count > capacity - dst_offset || !gc_slot_index_prepare(gc)) {
+    gc_concurrent_unlock(gc);
+    return false;
+  }
+
+  // the edges of the overwritten slots are handed to the new young targets,
+  // only the missing ones are allocated, before anything is copied
+  size_t end = dst_offset + count;
+  gc_slot_entry_t *entry = gc_slot_index_entry(&gc->slot_index, dst, true);
+  size_t reusable = 0;
+  for (ref_node_t *ref = entry->edges; ref; ref = ref->slot_next) {
+    if (ref->slot >= dst_offset && ref->slot < end) reusable++;
+  }
+
+  void * const *values = (void * const*) src;
+  size_t young = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (gc_is_young(gc, values[i])) young++;
+  }
+
+  ref_node_t *fresh = NULL;
+  for (size_t n = reusable; n < young; ++n) {
+    ref_node_t *ref = (ref_node_t*) malloc(sizeof(ref_node_t));
+    if (!ref) {
+      while (fresh) {
+        ref = fresh->slot_next;
+        free(fresh);
+        fresh = ref;
+      }
+      gc_concurrent_unlock(gc);
+      return false;
+    }
+    ref->slot_next = fresh;
+    fresh = ref;
+  }
+
+  void **slots = (void**) dst;
+  memmove(slots + dst_offset, src, count * sizeof(void*));
+  gc_barrier_range_write(gc, dst, dst_offset, count);
+
+  // the overwritten slots no longer hold what their edges recorded
+  ref_node_t *spare = NULL;
+  ref_node_t **link = &entry->edges;
+  while (*link) {
+    ref_node_t *ref = *link;
+    if (ref->slot >= dst_offset && ref->slot < end) {
+      *link = ref->slot_next;
+      ref->slot_next = spare;
+      spare = ref;
+      continue;
+    }
+    link = &ref->slot_next;
+  }
+
+  for (size_t i = dst_offset; i < end; ++i) {
+    if (!gc_is_young(gc, slots[i])) continue;
+
+    ref_node_t *ref = spare;
+    if (ref) {
+      spare = ref->slot_next;
+    } else {
+      ref = fresh;
+      fresh = ref->slot_next;
+      ref->from_obj = dst;
+      gc_ref_link(gc, ref);
+    }
+    ref->to_obj = slots[i];
+    ref->slot = i;
+    ref->slot_next = entry->edges;
+    entry->edges = ref;
+  }
+
+  // slots that stopped holding young targets drop their edges
+  while (spare) {
+    ref_node_t *ref = spare;
+    spare = ref->slot_next;
+    gc_ref_unlink(ref);
+    free(ref);
+  }
+
+  gc_concurrent_unlock(gc);
+  return true;
 }
 
 void simple_gc_print_barrier_stats(gc_t *gc) {
@@ -29,6 +29,7 @@ static MunitResult test_basic_write(const MunitParameter params[], void *data) {
   gc_t gc;
   simple_gc_init(&gc, 1024);
   simple_gc_enable_write_barrier(&gc);
+  gc_barrier_set_stats(&gc, true);
 
   int *obj1 = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
   int *obj2 = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
@@ -53,6 +54,7 @@ static MunitResult test_cross_generation(const MunitParameter params[], void *da
   simple_gc_init(&gc, 1024 * 1024);
   simple_gc_enable_generations(&gc, 200 * 1024);
   simple_gc_enable_write_barrier(&gc);
+  gc_barrier_set_stats(&gc, true);
   gc.config.auto_collect = false;
 
   // create old object
@@ -134,6 +136,7 @@ static MunitResult test_same_generation(const MunitParameter params[], void *dat
   simple_gc_init(&gc, 1024 * 1024);
   simple_gc_enable_generations(&gc, 200 * 1024);
   simple_gc_enable_write_barrier(&gc);
+  gc_barrier_set_stats(&gc, true);
 
   // two young objects
   int *obj1 = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
@@ -159,6 +162,7 @@ static MunitResult test_statistics(const MunitParameter params[], void *data) {
   simple_gc_init(&gc, 1024 * 1024);
   simple_gc_enable_generations(&gc, 200 * 1024);
   simple_gc_enable_write_barrier(&gc);
+  gc_barrier_set_stats(&gc, true);
   gc.config.auto_collect = false;
 
   // create old object
@@ -196,6 +200,7 @@ static MunitResult test_reset_stats(const MunitParameter params[], void *data) {
   gc_t gc;
   simple_gc_init(&gc, 1024);
   simple_gc_enable_write_barrier(&gc);
+  gc_barrier_set_stats(&gc, true);
 
   int *obj1 = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
   int *obj2 = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
@@ -214,6 +219,209 @@ static MunitResult test_reset_stats(const MunitParameter params[], void *data) {
   return MUNIT_OK;
 }
 
+static MunitResult test_fast_path(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_generations(&gc, 200 * 1024);
+  simple_gc_enable_write_barrier(&gc);
+  gc.config.auto_collect = false;
+
+  // nothing is counted, so stores can be filtered by address alone
+  gc_barrier_t *barrier = gc.barrier_context;
+  munit_assert_true(barrier->filtered);
+  munit_assert_size(barrier->young_size, >, 0);
+
+  int *old_obj = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, old_obj);
+  for (int i = 0; i <= GC_PROMOTION_AGE; i++) {
+    simple_gc_collect_minor(&gc);
+  }
+  old_obj = (int *)gc.roots[0];
+
+  gc_gen_t *gen = gc.gen_context;
+  int *young1 = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  int *young2 = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+
+  // young->young and young->old stores never reach the slow path
+  simple_gc_write(&gc, young1, young2);
+  simple_gc_write(&gc, young1, old_obj);
+  munit_assert_size(gc_cardtable_dirty_count(&gen->cardtable), ==, 0);
+
+  // old->young still cards the source
+  simple_gc_write(&gc, old_obj, young1);
+  munit_assert_true(gc_cardtable_is_dirty(&gen->cardtable, old_obj));
+
+  gc_barrier_stats_t stats;
+  gc_barrier_get_stats(&gc, &stats);
+  munit_assert_size(stats.total_writes, ==, 0);
+
+  // counting turns the filter off again
+  gc_barrier_set_stats(&gc, true);
+  munit_assert_false(barrier->filtered);
+  simple_gc_write(&gc, young1, young2);
+  gc_barrier_get_stats(&gc, &stats);
+  munit_assert_size(stats.same_generation, ==, 1);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_array_copy(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_generations(&gc, 200 * 1024);
+  simple_gc_enable_write_barrier(&gc);
+  gc.config.auto_collect = false;
+
+  // big enough to be allocated straight into the old generation
+  gc_gen_t *gen = gc.gen_context;
+  void **array = (void **)simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 1024 * sizeof(void *));
+  munit_assert_not_null(array);
+  munit_assert_false(gc_gen_in_nursery(gen, array));
+  void *old_obj = simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 1024 * sizeof(void *));
+
+  // only old targets: nothing to remember
+  void *src[600];
+  for (size_t i = 0; i < 600; ++i) src[i] = old_obj;
+  munit_assert_true(simple_gc_array_copy(&gc, array, 0, src, 600));
+  munit_assert_size(gc_cardtable_dirty_count(&gen->cardtable), ==, 0);
+
+  // two young targets: only the cards between them are dirtied
+  src[500] = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  src[520] = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  munit_assert_true(simple_gc_array_copy(&gc, array, 0, src, 600));
+  munit_assert_memory_equal(600 * sizeof(void *), array, src);
+  munit_assert_true(gc_cardtable_is_dirty(&gen->cardtable, &array[500]));
+  munit_assert_true(gc_cardtable_is_dirty(&gen->cardtable, &array[520]));
+  munit_assert_false(gc_cardtable_is_dirty(&gen->cardtable, &array[0]));
+  munit_assert_size(gc_cardtable_dirty_count(&gen->cardtable), <=, 2);
+
+  // counting takes the per-element path
+  gc_barrier_set_stats(&gc, true);
+  gc_barrier_range_write(&gc, array, 500, 21);
+  gc_barrier_stats_t stats;
+  gc_barrier_get_stats(&gc, &stats);
+  munit_assert_size(stats.total_writes, ==, 21);
+  munit_assert_size(stats.old_to_young, ==, 2);
+  gc_barrier_set_stats(&gc, false);
+
+  // the young slots are edges: a minor collection keeps their targets and
+  // writes the new addresses into the slots
+  *(int *)src[500] = 500;
+  *(int *)src[520] = 520;
+  simple_gc_add_root(&gc, array);
+  simple_gc_collect_minor(&gc);
+  munit_assert_ptr_not_equal(array[500], src[500]);
+  munit_assert_ptr_not_equal(array[520], src[520]);
+  munit_assert_int(*(int *)array[500], ==, 500);
+  munit_assert_int(*(int *)array[520], ==, 520);
+  munit_assert_ptr_equal(array[0], old_obj);
+
+  // copying again replaces the slot edges instead of piling them up
+  src[500] = array[500];
+  src[520] = array[520];
+  munit_assert_true(simple_gc_array_copy(&gc, array, 0, src, 600));
+  size_t edges = 0;
+  for (ref_node_t *ref = gc.references; ref; ref = ref->next) edges++;
+  munit_assert_size(edges, ==, 2);
+  simple_gc_collect_minor(&gc);
+  munit_assert_int(*(int *)array[500], ==, 500);
+  munit_assert_int(*(int *)array[520], ==, 520);
+
+  // dst must have room for every reference
+  munit_assert_false(simple_gc_array_copy(&gc, old_obj, 0, src, 1025));
+  munit_assert_false(simple_gc_array_copy(&gc, src, 0, src, 1));
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static size_t count_edges(gc_t *gc) {
+  size_t edges = 0;
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) edges++;
+  return edges;
+}
+
+static MunitResult test_array_copy_offset(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_generations(&gc, 200 * 1024);
+  simple_gc_enable_write_barrier(&gc);
+  gc.config.auto_collect = false;
+
+  void **array = (void **)simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 1024 * sizeof(void *));
+  void *old_obj = simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 1024 * sizeof(void *));
+  munit_assert_not_null(array);
+  munit_assert_not_null(old_obj);
+  simple_gc_add_root(&gc, array);
+
+  int *a = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  int *b = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  *a = 1;
+  *b = 2;
+
+  // the copy lands in the middle, the slots around it are left alone
+  void *src[2] = {a, b};
+  munit_assert_true(simple_gc_array_copy(&gc, array, 100, src, 2));
+  munit_assert_ptr_equal(array[100], a);
+  munit_assert_ptr_equal(array[101], b);
+  munit_assert_null(array[99]);
+  munit_assert_null(array[102]);
+  munit_assert_size(count_edges(&gc), ==, 2);
+
+  // only the edges of the overwritten slots are replaced
+  src[0] = b;
+  munit_assert_true(simple_gc_array_copy(&gc, array, 100, src, 1));
+  munit_assert_size(count_edges(&gc), ==, 2);
+  src[0] = old_obj;
+  munit_assert_true(simple_gc_array_copy(&gc, array, 101, src, 1));
+  munit_assert_size(count_edges(&gc), ==, 1);
+
+  simple_gc_collect_minor(&gc);
+  munit_assert_ptr_not_equal(array[100], b);
+  munit_assert_int(*(int *)array[100], ==, 2);
+  munit_assert_ptr_equal(array[101], old_obj);
+
+  // the collection moved the edge, the next copy still finds it
+  src[0] = old_obj;
+  munit_assert_true(simple_gc_array_copy(&gc, array, 100, src, 1));
+  munit_assert_size(count_edges(&gc), ==, 0);
+
+  // slot edges of many arrays outgrow the index
+  enum { ARRAYS = 40 };
+  void **arrays[ARRAYS];
+  for (size_t i = 0; i < ARRAYS; ++i) {
+    arrays[i] = (void **)simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 1024 * sizeof(void *));
+    munit_assert_not_null(arrays[i]);
+    src[0] = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    munit_assert_true(simple_gc_array_copy(&gc, arrays[i], i, src, 1));
+  }
+  munit_assert_size(count_edges(&gc), ==, ARRAYS);
+  src[0] = old_obj;
+  for (size_t i = 0; i < ARRAYS; ++i) {
+    munit_assert_true(simple_gc_array_copy(&gc, arrays[i], i, src, 1));
+  }
+  munit_assert_size(count_edges(&gc), ==, 0);
+
+  // dst[dst_offset, dst_offset + count) must fit
+  munit_assert_true(simple_gc_array_copy(&gc, array, 1023, src, 1));
+  munit_assert_false(simple_gc_array_copy(&gc, array, 1023, src, 2));
+  munit_assert_false(simple_gc_array_copy(&gc, array, 1025, src, 1));
+  munit_assert_false(simple_gc_array_copy(&gc, array, SIZE_MAX, src, 2));
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
 static MunitTest tests[] = {
   {"/init", test_init, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/basic_write", test_basic_write, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
@@ -221,6 +429,9 @@ static MunitTest tests[] = {
   {"/with_cardtable", test_with_cardtable, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/same_generation", test_same_generation, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/statistics", test_statistics, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/fast_path", test_fast_path, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/array_copy", test_array_copy, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/array_copy_offset", test_array_copy_offset, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/reset_stats", test_reset_stats, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
 };
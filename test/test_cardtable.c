@@ -2,6 +2,8 @@
 #include "gc_cardtable.h"
 #include "simple_gc.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static MunitResult test_init(const MunitParameter params[], void *data) {
   (void)params;
@@ -12,8 +14,8 @@ static MunitResult test_init(const MunitParameter params[], void *data) {
 
   bool result = gc_cardtable_init(&table, heap, sizeof(heap));
   munit_assert_true(result);
-  munit_assert_not_null(table.cards);
-  munit_assert_size(table.num_cards, ==, (4096 + GC_CARD_SIZE - 1) / GC_CARD_SIZE);
+  munit_assert_size(table.region_count, ==, 1);
+  munit_assert_size(table.num_cards, ==, GC_CARD_REGION_CARDS);
   munit_assert_ptr_equal(table.heap_start, heap);
   munit_assert_true(table.enabled);
 
@@ -201,6 +203,209 @@ static MunitResult test_scan_dirty(const MunitParameter params[], void *data) {
   return MUNIT_OK;
 }
 
+typedef struct {
+  char *heap;
+  size_t cards[256];
+  size_t count;
+} scan_log_t;
+
+static void log_callback(gc_t *gc, void *card_start, void *card_end, void *user_data) {
+  (void)gc;
+  scan_log_t *log = (scan_log_t *)user_data;
+  munit_assert_size((size_t)((char *)card_end - (char *)card_start), ==, GC_CARD_SIZE);
+  log->cards[log->count++] = (size_t)((char *)card_start - log->heap) / GC_CARD_SIZE;
+}
+
+static MunitResult test_scan_runs(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 4096);
+
+  // runs inside a word, across word and vector boundaries, and at the end
+  static char heap[203 * GC_CARD_SIZE];
+  gc_cardtable_t table;
+  gc_cardtable_init(&table, heap, sizeof(heap));
+
+  size_t expected[] = {3, 4, 5, 15, 16, 17, 31, 32, 33, 63, 64, 100, 200, 201, 202};
+  size_t expected_count = sizeof(expected) / sizeof(expected[0]);
+  for (size_t i = 0; i < expected_count; ++i) {
+    gc_cardtable_mark_dirty(&table, heap + expected[i] * GC_CARD_SIZE);
+  }
+  munit_assert_size(gc_cardtable_dirty_count(&table), ==, expected_count);
+
+  scan_log_t log = {heap, {0}, 0};
+  gc_cardtable_scan_dirty(&gc, &table, log_callback, &log);
+
+  munit_assert_size(log.count, ==, expected_count);
+  for (size_t i = 0; i < expected_count; ++i) {
+    munit_assert_size(log.cards[i], ==, expected[i]);
+  }
+  munit_assert_size(gc_cardtable_dirty_count(&table), ==, 0);
+  for (size_t i = 0; i < 203; ++i) {
+    munit_assert_false(gc_cardtable_is_dirty(&table, heap + i * GC_CARD_SIZE));
+  }
+
+  gc_cardtable_destroy(&table);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_summary(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 4096);
+
+  // 2 MiB of heap: 4096 cards in two regions of 32 chunks each
+  size_t heap_size = (size_t)4096 * GC_CARD_SIZE;
+  char *heap = (char *)malloc(heap_size);
+  munit_assert_not_null(heap);
+  gc_cardtable_t table;
+  gc_cardtable_init(&table, heap, heap_size);
+  munit_assert_size(table.region_count, ==, 2);
+  munit_assert_uint64(table.regions[0]->summary, ==, 0);
+
+  // a run crossing from chunk 9 into chunk 10, and the last card
+  gc_cardtable_mark_range_dirty(&table, heap + 638 * GC_CARD_SIZE, 3 * GC_CARD_SIZE);
+  gc_cardtable_mark_dirty(&table, heap + 4095 * GC_CARD_SIZE);
+  munit_assert_uint64(table.regions[0]->summary, ==, UINT64_C(3) << 9);
+  munit_assert_uint64(table.regions[1]->summary, ==, UINT64_C(1) << 31);
+
+  scan_log_t log = {heap, {0}, 0};
+  gc_cardtable_scan_dirty(&gc, &table, log_callback, &log);
+  munit_assert_size(log.count, ==, 4);
+  munit_assert_size(log.cards[0], ==, 638);
+  munit_assert_size(log.cards[1], ==, 639);
+  munit_assert_size(log.cards[2], ==, 640);
+  munit_assert_size(log.cards[3], ==, 4095);
+  munit_assert_uint64(table.regions[0]->summary, ==, 0);
+  munit_assert_uint64(table.regions[1]->summary, ==, 0);
+  munit_assert_size(gc_cardtable_dirty_count(&table), ==, 0);
+
+  // a cleared card leaves its chunk flagged until the next scan
+  gc_cardtable_mark_dirty(&table, heap + 100 * GC_CARD_SIZE);
+  gc_cardtable_clear_card(&table, 100);
+  munit_assert_uint64(table.regions[0]->summary, ==, UINT64_C(1) << 1);
+  log.count = 0;
+  gc_cardtable_scan_dirty(&gc, &table, log_callback, &log);
+  munit_assert_size(log.count, ==, 0);
+  munit_assert_uint64(table.regions[0]->summary, ==, 0);
+
+  gc_cardtable_destroy(&table);
+  free(heap);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static void collect_object(gc_t *gc, void *header, void *user_data) {
+  (void)gc;
+  void **found = (void **)user_data;
+  while (*found) found++;
+  *found = header;
+}
+
+static MunitResult test_crossing_map(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  // long enough for an object reaching more than GC_CROSSING_MAX cards
+  static uint64_t heap[300 * GC_CARD_SIZE / sizeof(uint64_t)];
+  char *base = (char *)heap;
+  gc_cardtable_t table;
+  gc_cardtable_init(&table, heap, sizeof(heap));
+
+  char *a = base;                     // inside card 0
+  char *b = base + 480;               // starts in card 0, reaches into card 1
+  char *c = base + 2 * GC_CARD_SIZE;  // card 2 through card 299
+  munit_assert_true(gc_cardtable_record_object(&table, a, 48));
+  munit_assert_true(gc_cardtable_record_object(&table, b, 100));
+  munit_assert_true(gc_cardtable_record_object(&table, c, 297 * GC_CARD_SIZE + 8));
+  munit_assert_false(gc_cardtable_record_object(&table, base + 4, 16));  // off granule
+
+  munit_assert_true(gc_cardtable_has_object(&table, b));
+  munit_assert_false(gc_cardtable_has_object(&table, base + 8));
+
+  void *found[4] = {NULL};
+  gc_cardtable_for_each_object(NULL, &table, base, collect_object, found);
+  munit_assert_ptr_equal(found[0], a);
+  munit_assert_ptr_equal(found[1], b);
+  munit_assert_null(found[2]);
+
+  memset(found, 0, sizeof(found));
+  gc_cardtable_for_each_object(NULL, &table, base + GC_CARD_SIZE, collect_object, found);
+  munit_assert_ptr_equal(found[0], b);
+  munit_assert_null(found[1]);
+
+  // found by stepping back over saturated crossing entries
+  memset(found, 0, sizeof(found));
+  gc_cardtable_for_each_object(NULL, &table, base + 299 * GC_CARD_SIZE, collect_object, found);
+  munit_assert_ptr_equal(found[0], c);
+  munit_assert_null(found[1]);
+
+  // an object reusing the memory drops the starts it covers
+  munit_assert_true(gc_cardtable_record_object(&table, a, 600));
+  munit_assert_false(gc_cardtable_has_object(&table, b));
+  memset(found, 0, sizeof(found));
+  gc_cardtable_for_each_object(NULL, &table, base + GC_CARD_SIZE, collect_object, found);
+  munit_assert_ptr_equal(found[0], a);
+  munit_assert_null(found[1]);
+
+  gc_cardtable_forget_objects(&table);
+  munit_assert_false(gc_cardtable_has_object(&table, a));
+
+  gc_cardtable_destroy(&table);
+  return MUNIT_OK;
+}
+
+static MunitResult test_sparse(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 4096);
+
+  // nothing committed up front; addresses are only compared, never touched
+  char heap[64];
+  gc_cardtable_t table;
+  munit_assert_true(gc_cardtable_init(&table, heap, 0));
+  munit_assert_size(table.region_count, ==, 0);
+  munit_assert_false(gc_cardtable_is_dirty(&table, heap));
+
+  // a terabyte apart and below the origin: every address gets its own card
+  void *far = (void *)((uintptr_t)heap + ((uintptr_t)1 << 40));
+  void *below = (void *)((uintptr_t)heap - ((uintptr_t)64 << 20));
+  munit_assert_true(gc_cardtable_mark_dirty(&table, heap));
+  munit_assert_true(gc_cardtable_mark_dirty(&table, far));
+  munit_assert_true(gc_cardtable_mark_dirty(&table, below));
+  munit_assert_size(table.region_count, ==, 3);
+  munit_assert_size(table.num_cards, ==, 3 * GC_CARD_REGION_CARDS);
+  munit_assert_true(gc_cardtable_is_dirty(&table, far));
+  munit_assert_true(gc_cardtable_is_dirty(&table, below));
+  munit_assert_false(gc_cardtable_is_dirty(&table, (char *)far + GC_CARD_SIZE));
+  munit_assert_size(gc_cardtable_dirty_count(&table), ==, 3);
+
+  scan_log_t log = {heap, {0}, 0};
+  gc_cardtable_scan_dirty(&gc, &table, log_callback, &log);
+  munit_assert_size(log.count, ==, 3);
+  munit_assert_size(gc_cardtable_dirty_count(&table), ==, 0);
+  munit_assert_false(gc_cardtable_is_dirty(&table, far));
+
+  // an object straddling two regions is found from the second one
+  char *straddle = (char *)gc_cardtable_card_to_addr(&table, GC_CARD_REGION_CARDS) - 64;
+  munit_assert_true(gc_cardtable_record_object(&table, straddle, 128));
+  void *found[4] = {NULL};
+  gc_cardtable_for_each_object(NULL, &table, straddle + 64, collect_object, found);
+  munit_assert_ptr_equal(found[0], straddle);
+  munit_assert_null(found[1]);
+
+  gc_cardtable_destroy(&table);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
 static MunitTest tests[] = {
   {"/init", test_init, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/addr_to_card", test_addr_to_card, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
@@ -210,6 +415,10 @@ static MunitTest tests[] = {
   {"/clear_single", test_clear_single, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/statistics", test_statistics, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/scan_dirty", test_scan_dirty, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/scan_runs", test_scan_runs, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/summary", test_summary, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/crossing_map", test_crossing_map, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/sparse", test_sparse, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
 };
 
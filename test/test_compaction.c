@@ -1,7 +1,9 @@
 #include "munit.h"
 #include "simple_gc.h"
 #include "gc_pool.h"
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 
 static MunitResult test_basic(const MunitParameter params[], void *data) {
@@ -219,11 +221,631 @@ static MunitResult test_stats(const MunitParameter params[], void *data) {
   return MUNIT_OK;
 }
 
+static MunitResult test_many_relocations(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+
+  // every other object survives through a chain hanging off one root
+  const int count = 20000;
+  int *head = NULL;
+  int *prev = NULL;
+  for (int i = 0; i < count; i++) {
+    int *obj = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    munit_assert_not_null(obj);
+    *obj = i;
+    if (i % 2 != 0) continue;
+
+    if (!head) {
+      head = obj;
+      simple_gc_add_root(&gc, obj);
+    } else {
+      simple_gc_add_reference(&gc, prev, obj);
+    }
+    prev = obj;
+  }
+
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, (size_t) count / 2);
+
+  simple_gc_compact(&gc);
+  munit_assert_size(gc.compaction.relocation_count, ==, 0);
+  munit_assert_null(gc.compaction.relocations);
+
+  // every edge must point at a relocated survivor with its payload intact
+  size_t edges = 0;
+  for (ref_node_t *ref = gc.references; ref; ref = ref->next) {
+    munit_assert_not_null(simple_gc_find_header(&gc, ref->from_obj));
+    munit_assert_not_null(simple_gc_find_header(&gc, ref->to_obj));
+    munit_assert_int(*(int*)ref->to_obj, ==, *(int*)ref->from_obj + 2);
+    ++edges;
+  }
+  munit_assert_size(edges, ==, (size_t) count / 2 - 1);
+  munit_assert_int(*(int*)gc.roots[0], ==, 0);
+
+  // the moved heap still collects to the same live set
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, (size_t) count / 2);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_releases_blocks(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+
+  size_class_t *sc = gc_pool_get_size_class(gc.size_classes, sizeof(int));
+
+  // load spike: survivors end up spread over every block
+  const int count = 4000;
+  for (int i = 0; i < count; i++) {
+    int *obj = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *obj = i;
+    if (i % 100 == 0) simple_gc_add_root(&gc, obj);
+  }
+
+  size_t blocks_before = gc_pool_count_blocks(sc);
+  size_t capacity_before = sc->total_capacity;
+  size_t compactions_before = gc.total_compactions;
+  munit_assert_size(blocks_before, >, 1);
+
+  // 99% garbage, the collection compacts on its own
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.total_compactions, >, compactions_before);
+
+  // survivors are packed at the front, trailing blocks went back to the OS
+  munit_assert_size(gc_pool_count_blocks(sc), <, blocks_before);
+  munit_assert_size(sc->total_capacity, <, capacity_before);
+  munit_assert_size(gc.compaction.blocks_released, ==, blocks_before - gc_pool_count_blocks(sc));
+  munit_assert_size(gc.compaction.bytes_released, >, 0);
+  munit_assert_size(sc->total_used, ==, (size_t) count / 100);
+
+  // order is preserved and payloads are intact
+  for (size_t i = 0; i < gc.root_count; i++) {
+    munit_assert_int(*(int*)gc.roots[i], ==, (int) i * 100);
+    munit_assert_not_null(simple_gc_find_header(&gc, gc.roots[i]));
+  }
+
+  // the packed class still allocates and collects normally
+  for (int i = 0; i < 100; i++) {
+    munit_assert_not_null(simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int)));
+  }
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, (size_t) count / 100);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_relocation_table_full(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  gc.config.auto_collect = false;
+
+  for (int i = 0; i < 200; i++) {
+    int *obj = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *obj = i;
+    if (i % 2 == 0) simple_gc_add_root(&gc, obj);
+  }
+  // sweep without compacting, every other slot is a hole
+  gc_mark_all_roots(&gc);
+  gc_sweep_all(&gc);
+  size_class_t *sc = gc_pool_get_size_class(gc.size_classes, sizeof(int));
+
+  // a table sized for one object takes 8 entries, far fewer than would move
+  munit_assert_true(gc_compact_relocations_init(&gc.compaction, 1));
+  munit_assert_false(gc_compact_plan_class(&gc, sc));
+  gc_compact_clear_relocations(&gc.compaction);
+
+  // evacuation leaves every block it cannot record in full where it is
+  munit_assert_true(gc_compact_relocations_init(&gc.compaction, 1));
+  size_t budget = SIZE_MAX;
+  munit_assert_size(gc_compact_evacuate_class(&gc, sc, &budget), ==, 0);
+  munit_assert_size(gc.compaction.relocation_count, ==, 0);
+  gc_compact_clear_relocations(&gc.compaction);
+
+  for (size_t i = 0; i < gc.root_count; i++) {
+    munit_assert_int(*(int*)gc.roots[i], ==, (int)(2 * i));
+  }
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+// dense prefix plus a long sparse tail, returns the survivors' size class
+static size_class_t *fill_sparse(gc_t *gc, int count) {
+  for (int i = 0; i < count; i++) {
+    int *obj = (int*)simple_gc_alloc(gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *obj = i;
+    if (i < 500 || i % 50 == 0) simple_gc_add_root(gc, obj);
+  }
+  return gc_pool_get_size_class(gc->size_classes, sizeof(int));
+}
+
+static MunitResult test_evacuate_sparse(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+  gc.config.auto_expand_pools = false;
+  simple_gc_set_compaction_mode(&gc, GC_COMPACT_EVACUATE);
+
+  size_class_t *sc = fill_sparse(&gc, 5000);
+  size_t blocks_before = gc_pool_count_blocks(sc);
+  size_t live = gc.root_count;
+
+  simple_gc_collect(&gc);
+
+  // only sparse blocks were copied out, each of them went away
+  munit_assert_size(gc.compaction.blocks_evacuated, >, 0);
+  munit_assert_size(gc_pool_count_blocks(sc), ==, blocks_before - gc.compaction.blocks_evacuated);
+  munit_assert_size(gc.compaction.bytes_evacuated, <, live * sc->slot_size);
+  munit_assert_size(sc->total_used, ==, live);
+
+  for (size_t i = 0; i < gc.root_count; i++) {
+    int expected = i < 500 ? (int) i : (int)(i - 500) * 50 + 500;
+    munit_assert_not_null(simple_gc_find_header(&gc, gc.roots[i]));
+    munit_assert_int(*(int*)gc.roots[i], ==, expected);
+  }
+
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, live);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_evacuate_budget(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_set_compaction_mode(&gc, GC_COMPACT_EVACUATE);
+
+  size_class_t *sc = fill_sparse(&gc, 5000);
+
+  // room for a handful of survivors only
+  size_t budget = 8 * sc->slot_size;
+  simple_gc_set_evacuation_budget(&gc, budget);
+  simple_gc_collect(&gc);
+
+  munit_assert_size(gc.compaction.blocks_evacuated, >, 0);
+  munit_assert_size(gc.compaction.bytes_evacuated, <=, budget);
+
+  // the next compaction picks up where the budget ran out
+  size_t evacuated = gc.compaction.blocks_evacuated;
+  simple_gc_compact(&gc);
+  munit_assert_size(gc.compaction.blocks_evacuated, >, evacuated);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_histogram(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+
+  size_class_t *sc = fill_sparse(&gc, 5000);
+
+  gc_frag_histogram_t histogram;
+  simple_gc_fragmentation_histogram(&gc, &histogram);
+  // only the block currently being filled may have room
+  munit_assert_size(histogram.blocks[GC_FRAG_BUCKETS - 1], >=, gc_pool_count_blocks(sc) - 1);
+  munit_assert_false(simple_gc_should_compact(&gc));
+
+  // drop everything outside the dense prefix without compacting
+  for (size_t i = gc.root_count; i > 500; i--) {
+    simple_gc_remove_root(&gc, gc.roots[i - 1]);
+  }
+  gc_mark_all_roots(&gc);
+  gc_sweep_all(&gc);
+
+  simple_gc_fragmentation_histogram(&gc, &histogram);
+  size_t blocks = 0;
+  for (int i = 0; i < GC_FRAG_BUCKETS; i++) {
+    blocks += histogram.blocks[i];
+  }
+  munit_assert_size(blocks, ==, gc_pool_count_blocks(sc));
+  munit_assert_size(histogram.blocks[0], >, 0);
+  munit_assert_size(histogram.free_bytes[0], >=, GC_POOL_BLOCK_SIZE);
+  munit_assert_true(simple_gc_should_compact(&gc));
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+// follow the only outgoing edge of ptr
+static void *next_node(gc_t *gc, void *ptr) {
+  for (ref_node_t *ref = gc->references; ref; ref = ref->next) {
+    if (ref->from_obj == ptr) return ref->to_obj;
+  }
+  return NULL;
+}
+
+static MunitResult test_depth_first_order(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_set_compaction_mode(&gc, GC_COMPACT_DEPTH_FIRST);
+
+  // list nodes scattered between garbage and linked in shuffled order
+  enum { COUNT = 600 };
+  int *nodes[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    nodes[i] = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  unsigned seed = 12345;
+  for (int i = COUNT - 1; i > 0; i--) {
+    seed = seed * 1103515245u + 12345u;
+    int j = (int)((seed >> 16) % (unsigned)(i + 1));
+    int *tmp = nodes[i];
+    nodes[i] = nodes[j];
+    nodes[j] = tmp;
+  }
+  for (int i = 0; i < COUNT; i++) {
+    *nodes[i] = i;
+    if (i > 0) simple_gc_add_reference(&gc, nodes[i - 1], nodes[i]);
+  }
+  simple_gc_add_root(&gc, nodes[0]);
+
+  simple_gc_collect(&gc);
+  simple_gc_compact(&gc);
+
+  // list order is now slot order, a step only jumps at a block boundary
+  size_class_t *sc = gc_pool_get_size_class(gc.size_classes, sizeof(int));
+  size_t adjacent = 0;
+  char *node = gc.roots[0];
+  for (int i = 0; i < COUNT; i++) {
+    munit_assert_not_null(node);
+    munit_assert_int(*(int*)node, ==, i);
+
+    char *next = next_node(&gc, node);
+    if (next == node + sc->slot_size) adjacent++;
+    node = next;
+  }
+  size_t per_block = sc->blocks->capacity;
+  munit_assert_size(adjacent, >=, COUNT - 1 - (COUNT / per_block + 1));
+  munit_assert_size(gc.object_count, ==, COUNT);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_breadth_first_order(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_set_compaction_mode(&gc, GC_COMPACT_BREADTH_FIRST);
+
+  // complete binary tree, node i has children 2i+1 and 2i+2; allocated
+  // backwards so level order starts out reversed
+  enum { COUNT = 255 };
+  int *nodes[COUNT];
+  for (int i = COUNT - 1; i >= 0; i--) {
+    nodes[i] = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *nodes[i] = i;
+  }
+  for (int i = 0; 2 * i + 2 < COUNT; i++) {
+    simple_gc_add_reference(&gc, nodes[i], nodes[2 * i + 1]);
+    simple_gc_add_reference(&gc, nodes[i], nodes[2 * i + 2]);
+  }
+  simple_gc_add_root(&gc, nodes[0]);
+
+  simple_gc_collect(&gc);
+  simple_gc_compact(&gc);
+
+  // level order is slot order
+  size_class_t *sc = gc_pool_get_size_class(gc.size_classes, sizeof(int));
+  size_t k = 0;
+  for (pool_block_t *block = sc->blocks; block; block = block->next) {
+    for (size_t j = 0; j < block->used; j++) {
+      obj_header_t *header = (obj_header_t*)((char*)block->memory + j * block->slot_size);
+      munit_assert_int(*(int*)(header + 1), ==, (int)k++);
+    }
+  }
+  munit_assert_size(k, ==, COUNT);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_pinned_not_moved(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+
+  size_class_t *sc = fill_sparse(&gc, 5000);
+
+  // pin a survivor from the sparse tail
+  size_t pinned_root = gc.root_count - 1;
+  void *pinned = gc.roots[pinned_root];
+  int value = *(int*)pinned;
+  munit_assert_true(simple_gc_pin(&gc, pinned));
+  munit_assert_true(simple_gc_is_pinned(&gc, pinned));
+
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.compaction.blocks_released, >, 0);
+
+  // everything else slid, the pinned object kept its address and its block
+  munit_assert_ptr_equal(gc.roots[pinned_root], pinned);
+  munit_assert_int(*(int*)pinned, ==, value);
+  munit_assert_true(simple_gc_is_pinned(&gc, pinned));
+  munit_assert_size(sc->total_used, ==, gc.root_count);
+
+  // no other survivor landed on the pinned slot
+  for (size_t i = 0; i < gc.root_count; i++) {
+    if (i != pinned_root) munit_assert_ptr_not_equal(gc.roots[i], pinned);
+    munit_assert_not_null(simple_gc_find_header(&gc, gc.roots[i]));
+  }
+
+  // unpinned, the next compaction may move it
+  munit_assert_true(simple_gc_unpin(&gc, pinned));
+  munit_assert_false(simple_gc_is_pinned(&gc, pinned));
+  simple_gc_compact(&gc);
+  munit_assert_int(*(int*)gc.roots[pinned_root], ==, value);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_evacuate_skips_pinned(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_set_compaction_mode(&gc, GC_COMPACT_EVACUATE);
+
+  fill_sparse(&gc, 5000);
+
+  void *pinned = gc.roots[gc.root_count - 1];
+  simple_gc_pin(&gc, pinned);
+
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.compaction.blocks_evacuated, >, 0);
+  munit_assert_size(gc.compaction.pinned_skipped, >, 0);
+  munit_assert_ptr_equal(gc.roots[gc.root_count - 1], pinned);
+  munit_assert_not_null(simple_gc_find_header(&gc, pinned));
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_large_packed(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_set_large_compaction(&gc, true);
+
+  // 1-4 KB buffers, every fifth survives
+  enum { COUNT = 50 };
+  for (int i = 0; i < COUNT; i++) {
+    size_t size = 512 + (size_t)(i % 6) * 512;
+    char *obj = (char*)simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, size);
+    snprintf(obj, size, "buffer %d", i);
+    if (i % 5 == 0) simple_gc_add_root(&gc, obj);
+  }
+  munit_assert_size(gc.large_block_count, ==, COUNT);
+  void *pinned = gc.roots[3];
+  simple_gc_pin(&gc, pinned);
+
+  simple_gc_collect(&gc);
+  simple_gc_compact(&gc);
+
+  // dead blocks are gone, the movable survivors share one arena
+  munit_assert_size(gc.large_block_count, ==, COUNT / 5);
+  munit_assert_size(gc.compaction.large_blocks_released, ==, COUNT - COUNT / 5);
+  munit_assert_size(gc.compaction.large_objects_moved, ==, COUNT / 5 - 1);
+  munit_assert_ptr_equal(gc.roots[3], pinned);
+
+  large_arena_t *arena = NULL;
+  for (large_block_t *block = gc.large_blocks; block; block = block->next) {
+    if (block->header->pinned) {
+      munit_assert_null(block->arena);
+      continue;
+    }
+    munit_assert_not_null(block->arena);
+    if (arena) munit_assert_ptr_equal(block->arena, arena);
+    arena = block->arena;
+  }
+  munit_assert_size(arena->blocks, ==, COUNT / 5 - 1);
+
+  for (size_t i = 0; i < gc.root_count; i++) {
+    char expected[32];
+    snprintf(expected, sizeof(expected), "buffer %d", (int) i * 5);
+    munit_assert_not_null(simple_gc_find_header(&gc, gc.roots[i]));
+    munit_assert_string_equal((char*)gc.roots[i], expected);
+  }
+
+  // nothing left to gain, a second pass moves nothing
+  size_t moved = gc.compaction.large_objects_moved;
+  simple_gc_compact_large(&gc);
+  munit_assert_size(gc.compaction.large_objects_moved, ==, moved);
+
+  // the arena goes away with its last block
+  gc.root_count = 0;
+  simple_gc_collect(&gc);
+  simple_gc_compact_large(&gc);
+  munit_assert_size(gc.large_block_count, ==, 0);
+  munit_assert_size(gc.object_count, ==, 0);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_large_slack_trimmed(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_enable_handles(&gc);
+
+  // a small object reusing a big dead block
+  simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 3000);
+  simple_gc_collect(&gc);
+  gc_handle_t handle = simple_gc_alloc_handle(&gc, OBJ_TYPE_ARRAY, 300);
+  munit_assert_size(gc.large_block_count, ==, 1);
+  munit_assert_size(gc.large_blocks->size, ==, 3000);
+  memset(*handle, 'x', 300);
+
+  // off by default: blocks are kept as they are
+  simple_gc_compact(&gc);
+  munit_assert_size(gc.large_blocks->size, ==, 3000);
+
+  simple_gc_compact_large(&gc);
+  munit_assert_size(gc.large_blocks->size, ==, 300);
+  munit_assert_ptr_equal(simple_gc_find_header(&gc, *handle), gc.large_blocks->header);
+  munit_assert_char(((char*)*handle)[299], ==, 'x');
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_slot_references(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_compact_mode_t modes[] = {GC_COMPACT_SLIDE, GC_COMPACT_DEPTH_FIRST};
+  for (size_t m = 0; m < 2; m++) {
+    gc_t gc;
+    simple_gc_init(&gc, 1024 * 1024);
+    gc.config.auto_collect = false;
+    simple_gc_set_compaction_mode(&gc, modes[m]);
+
+    // garbage ahead of the target, so packing moves it
+    void **array = (void**)simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 4 * sizeof(void*));
+    for (int i = 0; i < 50; i++) {
+      simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    }
+    int *target = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *target = 42;
+    simple_gc_add_root(&gc, array);
+    array[1] = target;
+    array[2] = target;
+    simple_gc_add_reference(&gc, array, target);
+    gc.references->slot = 1;
+
+    simple_gc_collect(&gc);
+    simple_gc_compact(&gc);
+
+    // the edge's slot follows the target, an unrecorded copy does not
+    array = (void**)gc.roots[0];
+    munit_assert_ptr_not_equal(gc.references->to_obj, target);
+    munit_assert_ptr_equal(array[1], gc.references->to_obj);
+    munit_assert_int(*(int*)array[1], ==, 42);
+    munit_assert_ptr_equal(array[2], target);
+
+    simple_gc_destroy(&gc);
+  }
+  return MUNIT_OK;
+}
+
+static MunitResult test_locality_generations(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_enable_generations(&gc, 64 * 1024);
+  simple_gc_set_compaction_mode(&gc, GC_COMPACT_DEPTH_FIRST);
+
+  // tenured survivors between tenured garbage
+  for (int i = 0; i < 40; i++) {
+    int *obj = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *obj = i;
+    simple_gc_add_root(&gc, obj);
+  }
+  for (int i = 0; i < GC_PROMOTION_AGE; i++) {
+    simple_gc_collect_minor(&gc);
+  }
+  for (int i = 39; i >= 0; i--) {
+    if (*(int*)gc.roots[i] % 2) simple_gc_remove_root(&gc, gc.roots[i]);
+  }
+
+  // rooted young objects, the full collection leaves their headers marked
+  for (int i = 0; i < 20; i++) {
+    int *obj = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *obj = 100 + i;
+    simple_gc_add_root(&gc, obj);
+  }
+  simple_gc_collect(&gc);
+  simple_gc_compact(&gc);
+
+  // only the pool survivors were laid out, the young roots did not move
+  munit_assert_size(gc.root_count, ==, 40);
+  int old_sum = 0;
+  int young_sum = 0;
+  for (size_t i = 0; i < gc.root_count; i++) {
+    int value = *(int*)gc.roots[i];
+    if (value >= 100) {
+      young_sum += value - 100;
+    } else {
+      munit_assert_int(value % 2, ==, 0);
+      old_sum += value;
+    }
+  }
+  munit_assert_int(old_sum, ==, 2 * (19 * 20 / 2));
+  munit_assert_int(young_sum, ==, 19 * 20 / 2);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
 static MunitTest tests[] = {
   {"/basic", test_basic, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/with_roots", test_with_roots, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/references", test_references, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/stats", test_stats, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/many_relocations", test_many_relocations, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/releases_blocks", test_releases_blocks, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/relocation_table_full", test_relocation_table_full, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/evacuate_sparse", test_evacuate_sparse, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/evacuate_budget", test_evacuate_budget, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/histogram", test_histogram, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/pinned_not_moved", test_pinned_not_moved, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/evacuate_skips_pinned", test_evacuate_skips_pinned, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/depth_first_order", test_depth_first_order, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/breadth_first_order", test_breadth_first_order, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/large_packed", test_large_packed, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/large_slack_trimmed", test_large_slack_trimmed, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/slot_references", test_slot_references, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/locality_generations", test_locality_generations, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
 };
 
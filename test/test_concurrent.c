@@ -0,0 +1,398 @@
+#include "munit.h"
+#include "simple_gc.h"
+#include "gc_concurrent.h"
+#include "gc_mark.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static void *build_chain(gc_t *gc, size_t len, void **nodes) {
+  void *head = simple_gc_alloc(gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(gc, head);
+  if (nodes) nodes[0] = head;
+
+  void *prev = head;
+  for (size_t i = 1; i < len; ++i) {
+    void *obj = simple_gc_alloc(gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    simple_gc_add_reference(gc, prev, obj);
+    if (nodes) nodes[i] = obj;
+    prev = obj;
+  }
+  return head;
+}
+
+static MunitResult test_enable_disable(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024);
+
+  munit_assert_true(simple_gc_enable_concurrent(&gc));
+  munit_assert_true(simple_gc_is_concurrent(&gc));
+  munit_assert_not_null(gc.barrier_context);
+  munit_assert_int(gc.barrier_context->type, ==, GC_BARRIER_SNAPSHOT);
+
+  // modes are mutually exclusive, in either order
+  munit_assert_false(simple_gc_enable_incremental(&gc));
+  munit_assert_false(simple_gc_enable_generations(&gc, 0));
+  munit_assert_null(gc.gen_context);
+
+  simple_gc_disable_concurrent(&gc);
+  munit_assert_false(simple_gc_is_concurrent(&gc));
+  munit_assert_null(gc.barrier_context);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_basic_cycle(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_concurrent(&gc);
+
+  const size_t chain_len = 500;
+  build_chain(&gc, chain_len, NULL);
+  for (int i = 0; i < 50; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  munit_assert_size(gc.object_count, ==, chain_len + 50);
+
+  munit_assert_true(simple_gc_collect_concurrent_start(&gc));
+  munit_assert_true(gc_concurrent_marking(&gc));
+  munit_assert_false(simple_gc_collect_concurrent_start(&gc));
+
+  while (!simple_gc_concurrent_mark_done(&gc)) {
+    sched_yield();
+  }
+  simple_gc_collect_concurrent_finish(&gc);
+
+  munit_assert_false(gc_concurrent_marking(&gc));
+  munit_assert_size(gc.object_count, ==, chain_len);
+
+  gc_concurrent_stats_t stats;
+  gc_concurrent_get_stats(&gc, &stats);
+  munit_assert_size(stats.cycles, ==, 1);
+  munit_assert_size(stats.objects_scanned, ==, chain_len);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_satb_deletion(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_concurrent(&gc);
+
+  // root -> a -> b, plus a long tail so the marker is still busy
+  void *root = build_chain(&gc, 1000, NULL);
+  void *a = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  void *b = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_reference(&gc, root, a);
+  simple_gc_add_reference(&gc, a, b);
+
+  simple_gc_collect_concurrent_start(&gc);
+
+  // move b from a to root while marking runs
+  simple_gc_add_reference(&gc, root, b);
+  simple_gc_remove_reference(&gc, a, b);
+
+  simple_gc_collect_concurrent_finish(&gc);
+
+  munit_assert_not_null(simple_gc_find_header(&gc, a));
+  munit_assert_not_null(simple_gc_find_header(&gc, b));
+  munit_assert_size(gc.object_count, ==, 1002);
+
+  gc_concurrent_stats_t stats;
+  gc_concurrent_get_stats(&gc, &stats);
+  munit_assert_size(stats.satb_logged, >=, 1);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_mutator_runs_during_mark(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 4 * 1024 * 1024);
+  simple_gc_enable_concurrent(&gc);
+
+  const size_t chain_len = 1000;
+  void *nodes[1000];
+  void *root = build_chain(&gc, chain_len, nodes);
+
+  simple_gc_collect_concurrent_start(&gc);
+
+  // keep allocating and rewiring while the marker traces the chain
+  const size_t extra = 300;
+  void *linked[300];
+  for (size_t i = 0; i < extra; ++i) {
+    linked[i] = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    munit_assert_not_null(linked[i]);
+    simple_gc_add_reference(&gc, root, linked[i]);
+
+    // detach the tail of the chain and reattach it at the root
+    size_t j = chain_len - 1 - i;
+    simple_gc_remove_reference(&gc, nodes[j - 1], nodes[j]);
+    simple_gc_add_reference(&gc, root, nodes[j]);
+  }
+
+  simple_gc_collect_concurrent_finish(&gc);
+
+  for (size_t i = 0; i < chain_len; ++i) {
+    munit_assert_not_null(simple_gc_find_header(&gc, nodes[i]));
+  }
+  for (size_t i = 0; i < extra; ++i) {
+    munit_assert_not_null(simple_gc_find_header(&gc, linked[i]));
+  }
+  munit_assert_size(gc.object_count, ==, chain_len + extra);
+
+  // everything is still reachable for a stop-the-world collection
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, chain_len + extra);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_full_collect_aborts(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_concurrent(&gc);
+
+  build_chain(&gc, 200, NULL);
+  simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+
+  simple_gc_collect_concurrent_start(&gc);
+  simple_gc_collect(&gc);
+
+  munit_assert_false(gc_concurrent_marking(&gc));
+  munit_assert_size(gc.object_count, ==, 200);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_compact_while_marking(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_concurrent(&gc);
+
+  build_chain(&gc, 500, NULL);
+  simple_gc_collect_concurrent_start(&gc);
+
+  // the marker holds pointers into the pools, nothing may move under it
+  size_t compactions = gc.total_compactions;
+  simple_gc_compact(&gc);
+  simple_gc_compact_large(&gc);
+  munit_assert_size(gc.total_compactions, ==, compactions);
+  munit_assert_true(gc_concurrent_marking(&gc));
+
+  simple_gc_collect_concurrent_finish(&gc);
+  munit_assert_size(gc.object_count, ==, 500);
+
+  simple_gc_compact(&gc);
+  munit_assert_size(gc.total_compactions, ==, compactions + 1);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_destroy_while_marking(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_concurrent(&gc);
+
+  build_chain(&gc, 500, NULL);
+  simple_gc_collect_concurrent_start(&gc);
+
+  // must stop and join the marker before freeing the heap
+  simple_gc_destroy(&gc);
+  munit_assert_null(gc.concurrent);
+  return MUNIT_OK;
+}
+
+#define MUTATOR_THREADS 4
+#define MUTATOR_ITERATIONS 5000
+#define MUTATOR_WINDOW 32
+
+// every object a mutator still names is pinned, compaction at the end of
+// a cycle would move it out from under the thread's raw pointers
+typedef struct {
+  gc_t *gc;
+  // a fresh object is unreachable until it is linked, the collector is
+  // kept out of that gap and nothing else
+  pthread_mutex_t *publish;
+  int *running;
+  int id;
+  void *holders[2];
+  int *window[MUTATOR_WINDOW];
+  size_t failures;
+} mutator_t;
+
+static void *mutator_main(void *arg) {
+  mutator_t *m = (mutator_t*) arg;
+  int *rooted = NULL;
+
+  for (int i = 0; i < MUTATOR_ITERATIONS; ++i) {
+    pthread_mutex_lock(m->publish);
+    int *obj = (int*) simple_gc_alloc(m->gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    if (obj) {
+      *obj = m->id * MUTATOR_ITERATIONS + i;
+      if (!simple_gc_add_reference(m->gc, m->holders[0], obj)) m->failures++;
+      simple_gc_pin(m->gc, obj);
+    }
+    pthread_mutex_unlock(m->publish);
+    if (!obj) {
+      m->failures++;
+      continue;
+    }
+
+    // move it to the other holder, the deletion goes through this thread's
+    // SATB buffer while the marker or another thread's final pause runs
+    simple_gc_add_reference(m->gc, m->holders[1], obj);
+    simple_gc_remove_reference(m->gc, m->holders[0], obj);
+
+    // the previous root is still in the window, so still pinned
+    if (i % 16 == 0) {
+      simple_gc_add_root(m->gc, obj);
+      if (rooted) simple_gc_remove_root(m->gc, rooted);
+      rooted = obj;
+    }
+
+    int **slot = &m->window[i % MUTATOR_WINDOW];
+    if (*slot) {
+      simple_gc_remove_reference(m->gc, m->holders[1], *slot);
+      simple_gc_unpin(m->gc, *slot);
+    }
+    *slot = obj;
+  }
+
+  pthread_mutex_lock(m->publish);
+  (*m->running)--;
+  pthread_mutex_unlock(m->publish);
+  return NULL;
+}
+
+static MunitResult test_multiple_mutators(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 16 * 1024 * 1024);
+  simple_gc_enable_concurrent(&gc);
+
+  pthread_mutex_t publish = PTHREAD_MUTEX_INITIALIZER;
+  int running = MUTATOR_THREADS;
+  mutator_t mutators[MUTATOR_THREADS];
+  pthread_t threads[MUTATOR_THREADS];
+
+  for (int t = 0; t < MUTATOR_THREADS; ++t) {
+    mutator_t *m = &mutators[t];
+    memset(m, 0, sizeof(*m));
+    m->gc = &gc;
+    m->publish = &publish;
+    m->running = &running;
+    m->id = t;
+    for (int h = 0; h < 2; ++h) {
+      m->holders[h] = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+      simple_gc_add_root(&gc, m->holders[h]);
+      simple_gc_pin(&gc, m->holders[h]);
+    }
+  }
+  // keeps the marker busy long enough for the mutators to delete under it
+  const size_t chain_len = 1000;
+  build_chain(&gc, chain_len, NULL);
+
+  for (int t = 0; t < MUTATOR_THREADS; ++t) {
+    munit_assert_int(pthread_create(&threads[t], NULL, mutator_main, &mutators[t]), ==, 0);
+  }
+
+  // cycle back to back, every mutator keeps running through the marking
+  // and the first allocation after the marker is done finishes the cycle
+  size_t cycles = 0;
+  for (;;) {
+    pthread_mutex_lock(&publish);
+    bool done = (running == 0);
+    if (!done && simple_gc_collect_concurrent_start(&gc)) cycles++;
+    pthread_mutex_unlock(&publish);
+    if (done) break;
+
+    for (;;) {
+      gc_concurrent_lock(&gc);
+      bool marking = gc_concurrent_marking(&gc);
+      gc_concurrent_unlock(&gc);
+      if (!marking || simple_gc_concurrent_mark_done(&gc)) break;
+      sched_yield();
+    }
+
+    pthread_mutex_lock(&publish);
+    simple_gc_collect_concurrent_finish(&gc);
+    pthread_mutex_unlock(&publish);
+  }
+
+  for (int t = 0; t < MUTATOR_THREADS; ++t) {
+    pthread_join(threads[t], NULL);
+  }
+  munit_assert_size(cycles, >, 0);
+
+  // nothing that was reachable at any point was swept from under a mutator
+  simple_gc_collect(&gc);
+  for (int t = 0; t < MUTATOR_THREADS; ++t) {
+    mutator_t *m = &mutators[t];
+    munit_assert_size(m->failures, ==, 0);
+    for (int w = 0; w < MUTATOR_WINDOW; ++w) {
+      int i = MUTATOR_ITERATIONS - MUTATOR_WINDOW + w;
+      int *obj = m->window[i % MUTATOR_WINDOW];
+      munit_assert_not_null(simple_gc_find_header(&gc, obj));
+      munit_assert_int(*obj, ==, t * MUTATOR_ITERATIONS + i);
+    }
+  }
+
+  munit_assert_size(gc.object_count, ==, chain_len + MUTATOR_THREADS * (2 + MUTATOR_WINDOW));
+
+  gc_concurrent_stats_t stats;
+  gc_concurrent_get_stats(&gc, &stats);
+  munit_assert_size(stats.cycles, ==, cycles);
+  munit_assert_size(stats.satb_logged, >, 0);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+  {"/enable_disable", test_enable_disable, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/basic_cycle", test_basic_cycle, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/satb_deletion", test_satb_deletion, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/mutator_runs_during_mark", test_mutator_runs_during_mark, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/full_collect_aborts", test_full_collect_aborts, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/compact_while_marking", test_compact_while_marking, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/destroy_while_marking", test_destroy_while_marking, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/multiple_mutators", test_multiple_mutators, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static const MunitSuite suite = {"/concurrent", tests, NULL, 1, MUNIT_SUITE_OPTION_NONE};
+
+int main(int argc, char *argv[]) {
+  return munit_suite_main(&suite, NULL, argc, argv);
+}
@@ -264,6 +264,79 @@ static MunitResult test_mark_diamond_graph(const MunitParameter params[], void *
   return MUNIT_OK;
 }
 
+static MunitResult test_mark_stack_overflow_wide(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+
+  // shrink the mark stack so a single wide object overflows it
+  gc_mark_stack_destroy(&gc.mark_stack);
+  munit_assert_true(gc_mark_stack_init(&gc.mark_stack, 4));
+
+  const size_t fanout = 64;
+  void *root = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, root);
+
+  void *children[64];
+  for (size_t i = 0; i < fanout; ++i) {
+    children[i] = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    simple_gc_add_reference(&gc, root, children[i]);
+
+    // grandchildren are only reachable through overflowed objects
+    void *grandchild = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    simple_gc_add_reference(&gc, children[i], grandchild);
+  }
+  simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int)); // garbage
+
+  gc_mark_all_roots(&gc);
+
+  munit_assert_size(gc.mark_stack.overflow_count, >, 0);
+  munit_assert_false(gc.mark_stack.overflowed);
+  munit_assert_size(gc.mark_stack.count, ==, 0);
+  munit_assert_size(gc_count_marked(&gc), ==, 1 + fanout * 2);
+
+  gc_unmark_all(&gc);
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, 1 + fanout * 2);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_mark_stack_overflow_deep(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+
+  gc_mark_stack_destroy(&gc.mark_stack);
+  munit_assert_true(gc_mark_stack_init(&gc.mark_stack, 1));
+
+  // binary tree: every scan shades two children into a one-slot stack
+  const size_t node_count = 255;
+  void *nodes[255];
+  for (size_t i = 0; i < node_count; ++i) {
+    nodes[i] = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    if (i > 0) {
+      simple_gc_add_reference(&gc, nodes[(i - 1) / 2], nodes[i]);
+    }
+  }
+  simple_gc_add_root(&gc, nodes[0]);
+
+  gc_mark_all_roots(&gc);
+
+  munit_assert_size(gc.mark_stack.overflow_count, >, 0);
+  for (size_t i = 0; i < node_count; ++i) {
+    munit_assert_true(gc_is_marked(&gc, nodes[i]));
+  }
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
 static MunitTest tests[] = {
   {"/single_object", test_mark_single_object, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/roots", test_mark_roots, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
@@ -274,6 +347,8 @@ static MunitTest tests[] = {
   {"/count_marked", test_count_marked, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/deep_chain", test_deep_reference_chain, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/diamond_graph", test_mark_diamond_graph, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/stack_overflow_wide", test_mark_stack_overflow_wide, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/stack_overflow_deep", test_mark_stack_overflow_deep, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
 };
 
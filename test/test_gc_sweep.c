@@ -2,6 +2,9 @@
 #include "gc_sweep.h"
 #include "gc_mark.h"
 #include "simple_gc.h"
+#include "gc_workers.h"
+#include "gc_bitmap.h"
+#include <stdint.h>
 
 
 static MunitResult test_sweep_unmarked(const MunitParameter params[], void *data) {
@@ -188,6 +191,232 @@ static MunitResult test_sweep_legacy_mode(const MunitParameter params[], void *d
   return MUNIT_OK;
 }
 
+static MunitResult test_sweep_lazy_defers(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  munit_assert_true(simple_gc_enable_lazy_sweep(&gc));
+
+  int *root = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, root);
+  for (int i = 0; i < 499; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  size_t blocks = gc_pool_count_blocks(gc_pool_get_size_class(gc.size_classes, sizeof(int)));
+  munit_assert_size(blocks, >, 1);
+
+  // collection only flags the blocks
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, 500);
+  munit_assert_size(gc.sweep_pending, ==, blocks);
+  munit_assert_true(gc_is_marked(&gc, root));
+
+  // background pass sweeps a bounded number of blocks
+  munit_assert_size(simple_gc_sweep_step(&gc, 1), ==, 1);
+  munit_assert_size(gc.sweep_pending, ==, blocks - 1);
+  munit_assert_size(gc.object_count, <, 500);
+
+  simple_gc_sweep_step(&gc, SIZE_MAX);
+  munit_assert_size(gc.sweep_pending, ==, 0);
+  munit_assert_size(gc.object_count, ==, 1);
+  munit_assert_false(gc_is_marked(&gc, root));
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_sweep_lazy_on_alloc(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_lazy_sweep(&gc);
+
+  for (int i = 0; i < 500; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  size_class_t *sc = gc_pool_get_size_class(gc.size_classes, sizeof(int));
+  size_t capacity = sc->total_capacity;
+
+  simple_gc_collect(&gc);
+  size_t pending = gc.sweep_pending;
+
+  // allocating sweeps only the block it reuses
+  int *obj = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  munit_assert_not_null(obj);
+  munit_assert_size(gc.sweep_pending, ==, pending - 1);
+  munit_assert_size(sc->total_capacity, ==, capacity);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_sweep_lazy_next_cycle(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_lazy_sweep(&gc);
+
+  // root -> child; child still carries its mark while unswept
+  int *root = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  int *child = (int*)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, root);
+  simple_gc_add_reference(&gc, root, child);
+
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.sweep_pending, >, 0);
+
+  // the next cycle finishes the pending sweep before marking
+  simple_gc_collect(&gc);
+  simple_gc_disable_lazy_sweep(&gc);
+  munit_assert_false(simple_gc_is_lazy_sweep(&gc));
+  munit_assert_size(gc.sweep_pending, ==, 0);
+  munit_assert_size(gc.object_count, ==, 2);
+  munit_assert_not_null(simple_gc_find_header(&gc, child));
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static void fill_heap(gc_t *gc, size_t count) {
+  static const size_t sizes[] = {4, 12, 24, 60, 100, 200};
+
+  for (size_t i = 0; i < count; ++i) {
+    void *obj = simple_gc_alloc(gc, OBJ_TYPE_PRIMITIVE, sizes[i % 6]);
+    if (i % 3 == 0) simple_gc_add_root(gc, obj);
+  }
+}
+
+static MunitResult test_sweep_parallel_matches_serial(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t serial;
+  gc_t parallel;
+  simple_gc_init(&serial, 16 * 1024 * 1024);
+  simple_gc_init(&parallel, 16 * 1024 * 1024);
+  munit_assert_true(simple_gc_enable_parallel_sweep(&parallel, 4));
+  munit_assert_true(simple_gc_is_parallel_sweep(&parallel));
+
+  fill_heap(&serial, 6000);
+  fill_heap(&parallel, 6000);
+
+  simple_gc_collect(&serial);
+  simple_gc_collect(&parallel);
+
+  munit_assert_size(parallel.object_count, ==, 2000);
+  munit_assert_size(parallel.object_count, ==, serial.object_count);
+  munit_assert_size(parallel.heap_used, ==, serial.heap_used);
+  munit_assert_size(parallel.total_bytes_freed, ==, serial.total_bytes_freed);
+
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    size_class_t *sc = &parallel.size_classes[i];
+    munit_assert_size(sc->total_used, ==, serial.size_classes[i].total_used);
+
+    size_t used = 0;
+    for (pool_block_t *block = sc->blocks; block; block = block->next) {
+      used += block->used;
+    }
+    munit_assert_size(sc->total_used, ==, used);
+  }
+
+  simple_gc_disable_parallel_sweep(&parallel);
+  munit_assert_null(parallel.workers);
+
+  simple_gc_destroy(&serial);
+  simple_gc_destroy(&parallel);
+  return MUNIT_OK;
+}
+
+static void count_worker(void *ctx, size_t worker) {
+  size_t *hits = (size_t*) ctx;
+  hits[worker]++;
+}
+
+static MunitResult test_sweep_workers_run(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_workers_t *workers = gc_workers_create(4);
+  munit_assert_not_null(workers);
+  munit_assert_size(workers->count, ==, 4);
+
+  size_t hits[4] = {0, 0, 0, 0};
+  for (int round = 0; round < 3; ++round) {
+    gc_workers_run(workers, count_worker, hits);
+  }
+  for (int i = 0; i < 4; ++i) {
+    munit_assert_size(hits[i], ==, 3);
+  }
+
+  gc_workers_destroy(workers);
+  return MUNIT_OK;
+}
+
+static MunitResult test_sweep_bitmap_kernel(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  for (size_t words = 0; words < 19; ++words) {
+    uint64_t alloc[19];
+    uint64_t mark[19];
+    uint64_t a[19];
+    uint64_t m[19];
+    size_t expected = 0;
+    for (size_t i = 0; i < words; ++i) {
+      alloc[i] = ((uint64_t) munit_rand_uint32() << 32) | munit_rand_uint32();
+      mark[i] = ((uint64_t) munit_rand_uint32() << 32) | munit_rand_uint32();
+      a[i] = alloc[i];
+      m[i] = mark[i];
+      expected += gc_bitmap_popcount(alloc[i] & ~mark[i]);
+    }
+
+    munit_assert_size(gc_bitmap_sweep(a, m, words), ==, expected);
+    for (size_t i = 0; i < words; ++i) {
+      munit_assert_uint64(a[i], ==, alloc[i] & mark[i]);
+      munit_assert_uint64(m[i], ==, alloc[i] & ~mark[i]);
+    }
+  }
+
+  return MUNIT_OK;
+}
+
+static MunitResult test_sweep_alloc_bitmap(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 16 * 1024 * 1024);
+
+  fill_heap(&gc, 3000);
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, 1000);
+
+  // the published bitmap matches the free lists exactly
+  for (int i = 0; i < GC_NUM_SIZE_CLASSES; ++i) {
+    for (pool_block_t *block = gc.size_classes[i].blocks; block; block = block->next) {
+      size_t allocated = 0;
+      for (size_t w = 0; w < block->bitmap_words; ++w) {
+        allocated += gc_bitmap_popcount(block->alloc_bits[w]);
+      }
+      munit_assert_size(allocated, ==, block->used);
+
+      for (free_node_t *node = block->free_list; node; node = node->next) {
+        munit_assert_false(gc_pool_slot_in_use(block, node));
+      }
+    }
+  }
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
 static MunitTest tests[] = {
   {"/unmarked", test_sweep_unmarked, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/pools", test_sweep_pools, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
@@ -195,6 +424,13 @@ static MunitTest tests[] = {
   {"/huge", test_sweep_huge, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/mixed", test_sweep_mixed, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/legacy_mode", test_sweep_legacy_mode, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/lazy_defers", test_sweep_lazy_defers, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/lazy_on_alloc", test_sweep_lazy_on_alloc, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/lazy_next_cycle", test_sweep_lazy_next_cycle, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/parallel_matches_serial", test_sweep_parallel_matches_serial, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/workers_run", test_sweep_workers_run, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/bitmap_kernel", test_sweep_bitmap_kernel, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/alloc_bitmap", test_sweep_alloc_bitmap, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
 };
 
@@ -15,6 +15,7 @@ static MunitResult test_full_integration(const MunitParameter params[], void *da
   simple_gc_init(&gc, 1024 * 1024);
   simple_gc_enable_generations(&gc, 200 * 1024);
   simple_gc_enable_write_barrier(&gc);
+  gc_barrier_set_stats(&gc, true);
   gc_debug_enable(&gc);
   gc_trace_begin(&gc, "test_integration.txt", GC_TRACE_FORMAT_TEXT);
   gc.config.auto_collect = false;
@@ -123,9 +124,11 @@ static MunitResult test_remembered_set_accuracy(const MunitParameter params[], v
   size_t young_after = gen->stats[GC_GEN_YOUNG].objects;
   munit_assert_size(young_after, <, young_before);
 
-  // verify reachable object survived
+  // verify reachable object survived, copied to where the edge now points
+  young_reachable = (int *)gc.references->to_obj;
   obj_header_t *header = simple_gc_find_header(&gc, young_reachable);
   munit_assert_not_null(header);
+  munit_assert_int(*young_reachable, ==, 111);
 
   simple_gc_destroy(&gc);
   return MUNIT_OK;
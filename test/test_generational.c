@@ -1,6 +1,7 @@
 #include "munit.h"
 #include "simple_gc.h"
 #include "gc_generation.h"
+#include "gc_barrier.h"
 #include "gc_debug.h"
 #include "gc_trace.h"
 #include <stdio.h>
@@ -280,6 +281,428 @@ static MunitResult test_old_to_young_refs(const MunitParameter params[], void *d
   return MUNIT_OK;
 }
 
+static MunitResult test_nursery_bump(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 8192);
+  gc_gen_init(&gc, 4096);
+  gc_gen_t *gen = gc.gen_context;
+
+  // consecutive allocations sit next to each other, small and large alike
+  char *a = (char *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  char *b = (char *)gc_gen_alloc(&gc, OBJ_TYPE_ARRAY, 300);
+  char *c = (char *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  munit_assert_ptr_equal(a, gen->eden.start + sizeof(obj_header_t));
+  munit_assert_true(b > a && c > b);
+  munit_assert_true(gc_gen_in_nursery(gen, a));
+  munit_assert_true(gc_gen_in_nursery(gen, b));
+  munit_assert_int(gc_gen_which_generation(&gc, c), ==, GC_GEN_YOUNG);
+
+  // only object starts have headers
+  munit_assert_ptr_equal(simple_gc_find_header(&gc, b), (obj_header_t *)b - 1);
+  munit_assert_null(simple_gc_find_header(&gc, b + 16));
+
+  // with everything dead the bump pointer goes back to the start
+  gc_gen_collect_minor(&gc);
+  munit_assert_ptr_equal(gen->eden.top, gen->eden.start);
+  munit_assert_size(gc_gen_young_size(&gc), ==, 0);
+  munit_assert_null(simple_gc_find_header(&gc, a));
+
+  gc_gen_destroy(&gc);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_survivor_copy(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024);
+  gc_gen_init(&gc, 16 * 1024);
+  gc_gen_t *gen = gc.gen_context;
+
+  // a rooted young list head -> mid -> tail, plus garbage in between
+  long *head = (long *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));
+  gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, 64);
+  long *mid = (long *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));
+  gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, 64);
+  long *tail = (long *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));
+  *head = 1;
+  *mid = 2;
+  *tail = 3;
+  simple_gc_add_root(&gc, head);
+  simple_gc_add_reference(&gc, head, mid);
+  simple_gc_add_reference(&gc, mid, tail);
+
+  gc_gen_collect_minor(&gc);
+
+  // survivors were copied into a survivor space, eden is empty
+  gc_gen_space_t *survivors = &gen->survivor[gen->survivor_from];
+  head = (long *)gc.roots[0];
+  munit_assert_true((char *)head >= survivors->start && (char *)head < survivors->top);
+  munit_assert_ptr_equal(gen->eden.top, gen->eden.start);
+  munit_assert_size(gen->stats[GC_GEN_YOUNG].objects, ==, 3);
+
+  // edges followed the copies, the garbage is gone
+  munit_assert_ptr_equal(gc.references->next->from_obj, head);
+  mid = (long *)gc.references->next->to_obj;
+  munit_assert_ptr_equal(gc.references->from_obj, mid);
+  tail = (long *)gc.references->to_obj;
+  munit_assert_long(*head + *mid + *tail, ==, 6);
+  munit_assert_int(((obj_header_t *)mid - 1)->age, ==, 1);
+
+  // aging copies between the survivor spaces, then tenures
+  gc_gen_collect_minor(&gc);
+  gc_gen_space_t *next = &gen->survivor[gen->survivor_from];
+  munit_assert_ptr_not_equal(next, survivors);
+  munit_assert_true((char *)gc.roots[0] >= next->start && (char *)gc.roots[0] < next->top);
+
+  gc_gen_collect_minor(&gc);
+  munit_assert_int(gc_gen_which_generation(&gc, gc.roots[0]), ==, GC_GEN_OLD);
+  munit_assert_size(gen->stats[GC_GEN_YOUNG].promotions, ==, 3);
+  munit_assert_size(gen->stats[GC_GEN_YOUNG].objects, ==, 0);
+  tail = (long *)gc.references->to_obj;
+  munit_assert_int(gc_gen_which_generation(&gc, tail), ==, GC_GEN_OLD);
+  munit_assert_long(*tail, ==, 3);
+
+  gc_gen_destroy(&gc);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_deep_young_list(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  #define LIST_LENGTH 5000
+
+  gc_t gc;
+  simple_gc_init(&gc, 4 * 1024 * 1024);
+  gc_gen_init(&gc, 1024 * 1024);
+
+  // rooted chain built tail first, every link an edge between young objects
+  long *next = NULL;
+  for (long i = LIST_LENGTH - 1; i >= 0; --i) {
+    long *node = (long *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));
+    *node = i;
+    if (next) simple_gc_add_reference(&gc, node, next);
+    next = node;
+    gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));  // garbage
+  }
+  simple_gc_add_root(&gc, next);
+
+  gc_gen_collect_minor(&gc);
+
+  gc_gen_t *gen = gc.gen_context;
+  munit_assert_size(gen->stats[GC_GEN_YOUNG].objects + gen->stats[GC_GEN_YOUNG].promotions,
+      ==, LIST_LENGTH);
+
+  // walk the chain through the rewritten edges
+  long *node = (long *)gc.roots[0];
+  for (long i = 0; i < LIST_LENGTH; ++i) {
+    munit_assert_not_null(node);
+    munit_assert_long(*node, ==, i);
+    long *follow = NULL;
+    for (ref_node_t *ref = gc.references; ref; ref = ref->next) {
+      if (ref->from_obj == node) follow = (long *)ref->to_obj;
+    }
+    node = follow;
+  }
+  munit_assert_null(node);
+
+  gc_gen_destroy(&gc);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+
+  #undef LIST_LENGTH
+}
+
+static MunitResult test_card_scan(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024);
+  gc_gen_init(&gc, 16 * 1024);
+  gc_barrier_init(&gc, GC_BARRIER_CARD_MARKING);
+
+  int *old_obj = (int *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, old_obj);
+  for (int i = 0; i < GC_PROMOTION_AGE; ++i) {
+    gc_gen_collect_minor(&gc);
+  }
+  old_obj = (int *)gc.roots[0];
+
+  int *young_obj = (int *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  *young_obj = 333;
+  simple_gc_add_reference(&gc, old_obj, young_obj);
+
+  // the store carded the old object, which the crossing map knows about
+  gc_gen_t *gen = gc.gen_context;
+  munit_assert_true(gen->remembered);
+  munit_assert_true(gc_cardtable_is_dirty(&gen->cardtable, old_obj));
+  munit_assert_true(gc_cardtable_has_object(&gen->cardtable, (obj_header_t *)old_obj - 1));
+
+  // the card keeps the target alive and is dirtied again for the copy
+  for (int i = 0; i < 2; ++i) {
+    gc_gen_collect_minor(&gc);
+    munit_assert_true(gen->remembered);
+    munit_assert_true(gc_cardtable_is_dirty(&gen->cardtable, old_obj));
+    munit_assert_ptr_equal(gc.references->from_obj, old_obj);
+    munit_assert_true(gc_gen_in_nursery(gen, gc.references->to_obj));
+    munit_assert_int(*(int *)gc.references->to_obj, ==, 333);
+  }
+
+  gc_gen_destroy(&gc);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_card_scan_huge(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024);
+  gc_gen_init(&gc, 16 * 1024);
+  gc_barrier_init(&gc, GC_BARRIER_CARD_MARKING);
+
+  // huge objects get their own mapping, nowhere near the nursery or pools
+  char *huge = (char *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, GC_HUGE_OBJECT_THRESHOLD);
+  munit_assert_not_null(huge);
+  simple_gc_add_root(&gc, huge);
+
+  int *young_obj = (int *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  *young_obj = 444;
+  simple_gc_add_reference(&gc, huge, young_obj);
+
+  gc_gen_t *gen = gc.gen_context;
+  munit_assert_true(gen->remembered);
+  munit_assert_true(gc_cardtable_is_dirty(&gen->cardtable, huge));
+
+  gc_gen_collect_minor(&gc);
+  munit_assert_true(gen->remembered);
+  munit_assert_ptr_equal(gc.references->from_obj, huge);
+  munit_assert_int(*(int *)gc.references->to_obj, ==, 444);
+
+  gc_gen_destroy(&gc);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_remset_scan(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024);
+  gc_gen_init(&gc, 16 * 1024);
+  gc_barrier_init(&gc, GC_BARRIER_REMSET);
+
+  int *old_obj = (int *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, old_obj);
+  for (int i = 0; i < GC_PROMOTION_AGE; ++i) {
+    gc_gen_collect_minor(&gc);
+  }
+  old_obj = (int *)gc.roots[0];
+
+  // repeated stores remember the source once, no card table is needed
+  gc_gen_t *gen = gc.gen_context;
+  for (int i = 0; i < 3; ++i) {
+    int *young_obj = (int *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *young_obj = 444 + i;
+    simple_gc_add_reference(&gc, old_obj, young_obj);
+  }
+  munit_assert_true(gen->remembered);
+  munit_assert_size(gc_remset_count(&gen->remset), ==, 1);
+  munit_assert_true(gc_remset_contains(&gen->remset, old_obj));
+  munit_assert_false(gen->cardtable.enabled);
+
+  // the set keeps the targets alive and still holds the source afterwards
+  gc_gen_collect_minor(&gc);
+  munit_assert_true(gen->remembered);
+  munit_assert_true(gc_remset_contains(&gen->remset, old_obj));
+  int found = 0;
+  for (ref_node_t *ref = gc.references; ref; ref = ref->next) {
+    munit_assert_ptr_equal(ref->from_obj, old_obj);
+    munit_assert_true(gc_gen_in_nursery(gen, ref->to_obj));
+    found += *(int *)ref->to_obj;
+  }
+  munit_assert_int(found, ==, 444 + 445 + 446);
+
+  gc_gen_destroy(&gc);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_pinned_young(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024);
+  gc_gen_init(&gc, 16 * 1024);
+  gc_gen_t *gen = gc.gen_context;
+
+  // a pinned young object with a young child, a movable one and garbage
+  long *pinned = (long *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));
+  long *child = (long *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));
+  gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, 64);
+  long *movable = (long *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));
+  *pinned = 7;
+  *child = 8;
+  *movable = 9;
+  simple_gc_add_root(&gc, pinned);
+  simple_gc_add_root(&gc, movable);
+  simple_gc_add_reference(&gc, pinned, child);
+  munit_assert_true(simple_gc_pin(&gc, pinned));
+
+  // the pinned object stays put and keeps eden, everything else moves
+  gc_gen_collect_minor(&gc);
+  munit_assert_ptr_equal(gc.roots[0], pinned);
+  munit_assert_not_null(simple_gc_find_header(&gc, pinned));
+  munit_assert_long(*pinned, ==, 7);
+  munit_assert_true(gen->kept);
+  munit_assert_ptr_not_equal(gc.roots[1], movable);
+  munit_assert_long(*(long *)gc.roots[1], ==, 9);
+  munit_assert_ptr_equal(gc.references->from_obj, pinned);
+  munit_assert_ptr_not_equal(gc.references->to_obj, child);
+  munit_assert_long(*(long *)gc.references->to_obj, ==, 8);
+  munit_assert_size(gen->stats[GC_GEN_YOUNG].objects, ==, 3);
+
+  // still pinned: kept again, nothing is lost
+  gc_gen_collect_minor(&gc);
+  munit_assert_ptr_equal(gc.roots[0], pinned);
+  munit_assert_true(gen->kept);
+  munit_assert_int(gc_gen_which_generation(&gc, gc.roots[1]), ==, GC_GEN_OLD);
+
+  // once unpinned the next cycle tenures it and empties the nursery
+  munit_assert_true(simple_gc_unpin(&gc, pinned));
+  gc_gen_collect_minor(&gc);
+  munit_assert_false(gen->kept);
+  munit_assert_int(gc_gen_which_generation(&gc, gc.roots[0]), ==, GC_GEN_OLD);
+  munit_assert_long(*(long *)gc.roots[0], ==, 7);
+  munit_assert_ptr_equal(gc.references->from_obj, gc.roots[0]);
+  munit_assert_long(*(long *)gc.references->to_obj, ==, 8);
+  munit_assert_ptr_equal(gen->eden.top, gen->eden.start);
+  munit_assert_size(gen->young_used, ==, 0);
+  munit_assert_size(gen->stats[GC_GEN_YOUNG].objects, ==, 0);
+
+  gc_gen_destroy(&gc);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_unpin_resumes_minor(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 4 * 1024 * 1024);
+  munit_assert_true(simple_gc_enable_generations(&gc, 64 * 1024));
+  gc_gen_t *gen = gc.gen_context;
+
+  long *pinned = (long *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));
+  *pinned = 42;
+  simple_gc_add_root(&gc, pinned);
+  munit_assert_true(simple_gc_pin(&gc, pinned));
+
+  // the pin keeps eden, every kept cycle leaves it a little fuller
+  for (int i = 0; i < 20000; ++i) {
+    munit_assert_not_null(simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long)));
+  }
+  munit_assert_true(gen->kept);
+  munit_assert_ptr_equal(gc.roots[0], pinned);
+
+  // the first allocation after the unpin empties the nursery, then minor
+  // collections run on eden occupancy again
+  munit_assert_true(simple_gc_unpin(&gc, pinned));
+  size_t minors = gen->minor_count;
+  munit_assert_not_null(simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long)));
+  munit_assert_size(gen->minor_count, ==, minors + 1);
+  munit_assert_false(gen->kept);
+  munit_assert_int(gc_gen_which_generation(&gc, gc.roots[0]), ==, GC_GEN_OLD);
+  munit_assert_long(*(long *)gc.roots[0], ==, 42);
+
+  minors = gen->minor_count;
+  for (int i = 0; i < 200000; ++i) {
+    munit_assert_not_null(simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long)));
+  }
+  munit_assert_size(gen->minor_count, >, minors + 10);
+  munit_assert_false(gen->kept);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+// five old survivors among holes, each holding an edge to a young object
+static void compact_keeps_young_edges(gc_barrier_type_t mode, size_t size, bool large) {
+  gc_t gc;
+  simple_gc_init(&gc, 256 * 1024);
+  gc_gen_init(&gc, 64 * 1024);
+  gc_barrier_init(&gc, mode);
+  gc_gen_t *gen = gc.gen_context;
+
+  for (int i = 0; i < 10; ++i) {
+    int *obj = (int *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, size);
+    *obj = i;
+    simple_gc_add_root(&gc, obj);
+  }
+  for (int i = 0; i < GC_PROMOTION_AGE; ++i) {
+    gc_gen_collect_minor(&gc);
+  }
+  for (int i = 9; i >= 0; --i) {
+    if (*(int *)gc.roots[i] % 2 == 1) simple_gc_remove_root(&gc, gc.roots[i]);
+  }
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.root_count, ==, 5);
+
+  void *before[5];
+  for (size_t i = 0; i < 5; ++i) {
+    munit_assert_int(gc_gen_which_generation(&gc, gc.roots[i]), ==, GC_GEN_OLD);
+    int *young_obj = (int *)gc_gen_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *young_obj = 100 + *(int *)gc.roots[i];
+    simple_gc_add_reference(&gc, gc.roots[i], young_obj);
+    before[i] = gc.roots[i];
+  }
+
+  if (large) simple_gc_compact_large(&gc);
+  else simple_gc_compact(&gc);
+  size_t moved = 0;
+  for (size_t i = 0; i < 5; ++i) {
+    if (gc.roots[i] != before[i]) moved++;
+  }
+  munit_assert_size(moved, >, 0);
+
+  // the minor collection finds every source at its new address
+  gc_gen_collect_minor(&gc);
+  size_t edges = 0;
+  for (ref_node_t *ref = gc.references; ref; ref = ref->next) {
+    munit_assert_true(simple_gc_is_root(&gc, ref->from_obj));
+    munit_assert_true(gc_gen_in_nursery(gen, ref->to_obj));
+    munit_assert_int(*(int *)ref->to_obj, ==, 100 + *(int *)ref->from_obj);
+    edges++;
+  }
+  munit_assert_size(edges, ==, 5);
+
+  gc_gen_destroy(&gc);
+  simple_gc_destroy(&gc);
+}
+
+static MunitResult test_compact_then_minor(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  compact_keeps_young_edges(GC_BARRIER_CARD_MARKING, sizeof(int), false);
+  compact_keeps_young_edges(GC_BARRIER_REMSET, sizeof(int), false);
+  compact_keeps_young_edges(GC_BARRIER_CARD_MARKING, 512, true);
+  compact_keeps_young_edges(GC_BARRIER_REMSET, 512, true);
+  return MUNIT_OK;
+}
+
 static MunitTest tests[] = {
   {"/init_destroy", test_init_destroy, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/allocation", test_allocation, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
@@ -290,6 +713,15 @@ static MunitTest tests[] = {
   {"/with_trace", test_with_trace, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/statistics", test_statistics, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {"/old_to_young_refs", test_old_to_young_refs, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/nursery_bump", test_nursery_bump, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/survivor_copy", test_survivor_copy, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/deep_young_list", test_deep_young_list, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/card_scan", test_card_scan, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/card_scan_huge", test_card_scan_huge, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/remset_scan", test_remset_scan, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/pinned_young", test_pinned_young, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/unpin_resumes_minor", test_unpin_resumes_minor, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/compact_then_minor", test_compact_then_minor, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
   {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
 };
 
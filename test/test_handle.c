@@ -0,0 +1,273 @@
+#include "munit.h"
+#include "simple_gc.h"
+#include <stdint.h>
+
+
+static MunitResult test_keeps_alive(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  gc.config.auto_collect = false;
+
+  // handles are opt-in
+  munit_assert_false(simple_gc_is_handles(&gc));
+  munit_assert_null(simple_gc_alloc_handle(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int)));
+  munit_assert_true(simple_gc_enable_handles(&gc));
+
+  gc_handle_t handle = simple_gc_alloc_handle(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  munit_assert_not_null(handle);
+  *(int*)*handle = 42;
+  simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  munit_assert_size(simple_gc_handle_count(&gc), ==, 1);
+
+  // the handle is a root, the other object is garbage
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, 1);
+  munit_assert_int(*(int*)*handle, ==, 42);
+
+  simple_gc_release_handle(&gc, handle);
+  munit_assert_size(simple_gc_handle_count(&gc), ==, 0);
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, 0);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_slots_reused(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_enable_handles(&gc);
+
+  // spans several chunks
+  enum { COUNT = GC_HANDLE_CHUNK_SLOTS * 3 };
+  gc_handle_t handles[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    handles[i] = simple_gc_alloc_handle(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    munit_assert_not_null(handles[i]);
+    *(int*)*handles[i] = i;
+  }
+  munit_assert_size(gc.handles->capacity, ==, COUNT);
+
+  for (int i = 0; i < COUNT; i += 2) {
+    simple_gc_release_handle(&gc, handles[i]);
+  }
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, COUNT / 2);
+
+  // freed slots are handed out again before the table grows
+  for (int i = 0; i < COUNT; i += 2) {
+    handles[i] = simple_gc_alloc_handle(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *(int*)*handles[i] = i;
+  }
+  munit_assert_size(gc.handles->capacity, ==, COUNT);
+  munit_assert_size(simple_gc_handle_count(&gc), ==, COUNT);
+
+  for (int i = 0; i < COUNT; i++) {
+    munit_assert_int(*(int*)*handles[i], ==, i);
+  }
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static void check_moved(gc_compact_mode_t mode) {
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024 * 1024);
+  gc.config.auto_collect = false;
+  gc.config.auto_expand_pools = false;
+  simple_gc_enable_handles(&gc);
+  simple_gc_set_compaction_mode(&gc, mode);
+
+  // a dense prefix and a sparse tail, reachable only through handles
+  enum { COUNT = 5000 };
+  static gc_handle_t handles[COUNT];
+  static void *before[COUNT];
+  size_t live = 0;
+  for (int i = 0; i < COUNT; i++) {
+    if (i < 500 || i % 50 == 0) {
+      handles[live] = simple_gc_alloc_handle(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+      *(int*)*handles[live] = i;
+      before[live] = *handles[live];
+      live++;
+    } else {
+      simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    }
+  }
+
+  simple_gc_collect(&gc);
+  simple_gc_compact(&gc);
+
+  size_t moved = 0;
+  for (size_t i = 0; i < live; i++) {
+    obj_header_t *header = simple_gc_find_header(&gc, *handles[i]);
+    munit_assert_not_null(header);
+    munit_assert_ptr_equal(header->handle, handles[i]);
+    int expected = i < 500 ? (int) i : (int)(i - 500) * 50 + 500;
+    munit_assert_int(*(int*)*handles[i], ==, expected);
+    if (*handles[i] != before[i]) moved++;
+  }
+  munit_assert_size(moved, >, 0);
+  munit_assert_size(gc.object_count, ==, live);
+
+  simple_gc_destroy(&gc);
+}
+
+static MunitResult test_slide_updates_slot(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  check_moved(GC_COMPACT_SLIDE);
+  return MUNIT_OK;
+}
+
+static MunitResult test_evacuate_updates_slot(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  check_moved(GC_COMPACT_EVACUATE);
+  return MUNIT_OK;
+}
+
+static MunitResult test_realloc(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_enable_handles(&gc);
+
+  gc_handle_t handle = simple_gc_alloc_handle(&gc, OBJ_TYPE_ARRAY, 4 * sizeof(int));
+  for (int i = 0; i < 4; i++) ((int*)*handle)[i] = i + 1;
+  void *old = *handle;
+
+  // grows into another size class, the prefix is kept
+  munit_assert_true(simple_gc_realloc_handle(&gc, handle, 64 * sizeof(int)));
+  munit_assert_ptr_not_equal(*handle, old);
+  munit_assert_size(simple_gc_find_header(&gc, *handle)->size, ==, 64 * sizeof(int));
+  for (int i = 0; i < 4; i++) munit_assert_int(((int*)*handle)[i], ==, i + 1);
+
+  // the old object lost its handle and is garbage
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.object_count, ==, 1);
+  munit_assert_ptr_equal(simple_gc_find_header(&gc, *handle)->handle, handle);
+
+  // shrinking keeps what fits
+  munit_assert_true(simple_gc_realloc_handle(&gc, handle, 2 * sizeof(int)));
+  munit_assert_int(((int*)*handle)[1], ==, 2);
+  munit_assert_size(simple_gc_handle_count(&gc), ==, 1);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_promotion(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_enable_handles(&gc);
+  munit_assert_true(simple_gc_enable_generations(&gc, 64 * 1024));
+
+  gc_handle_t handle = simple_gc_alloc_handle(&gc, OBJ_TYPE_PRIMITIVE, sizeof(long));
+  *(long*)*handle = 7;
+  void *young = *handle;
+
+  for (int i = 0; i <= GC_PROMOTION_AGE; i++) {
+    simple_gc_collect_minor(&gc);
+  }
+
+  // promotion copied the object, only the handle slot had to change
+  obj_header_t *header = simple_gc_find_header(&gc, *handle);
+  munit_assert_not_null(header);
+  munit_assert_int(header->generation, ==, GC_GEN_OLD);
+  munit_assert_ptr_not_equal(*handle, young);
+  munit_assert_ptr_equal(header->handle, handle);
+  munit_assert_long(*(long*)*handle, ==, 7);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_incremental_root(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  gc.config.auto_collect = false;
+  simple_gc_enable_handles(&gc);
+  munit_assert_true(simple_gc_enable_incremental(&gc));
+
+  gc_handle_t handle = simple_gc_alloc_handle(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  *(int*)*handle = 5;
+  simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+
+  while (!simple_gc_collect_step(&gc, GC_INCREMENTAL_UNBOUNDED)) {}
+  munit_assert_size(gc.object_count, ==, 1);
+  munit_assert_int(*(int*)*handle, ==, 5);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_nursery_churn(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_handles(&gc);
+  munit_assert_true(simple_gc_enable_generations(&gc, 4096));
+
+  // a small nursery collects during many of these allocations
+  enum { COUNT = 2000 };
+  static gc_handle_t handles[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    handles[i] = simple_gc_alloc_handle(&gc, OBJ_TYPE_PRIMITIVE, 16);
+    munit_assert_not_null(handles[i]);
+    *(int*)*handles[i] = i;
+    if (i % 3 == 0) {
+      munit_assert_true(simple_gc_realloc_handle(&gc, handles[i], 24));
+      munit_assert_int(*(int*)*handles[i], ==, i);
+    }
+  }
+  munit_assert_size(gc.gen_context->minor_count, >, 0);
+
+  for (int i = 0; i < COUNT; i++) {
+    obj_header_t *header = simple_gc_find_header(&gc, *handles[i]);
+    munit_assert_not_null(header);
+    munit_assert_ptr_equal(header->handle, handles[i]);
+    munit_assert_int(*(int*)*handles[i], ==, i);
+  }
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+  {"/keeps_alive", test_keeps_alive, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/slots_reused", test_slots_reused, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/slide_updates_slot", test_slide_updates_slot, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/evacuate_updates_slot", test_evacuate_updates_slot, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/realloc", test_realloc, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/promotion", test_promotion, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/incremental_root", test_incremental_root, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/nursery_churn", test_nursery_churn, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static const MunitSuite suite = {"/handle", tests, NULL, 1, MUNIT_SUITE_OPTION_NONE};
+
+int main(int argc, char *argv[]) {
+  return munit_suite_main(&suite, NULL, argc, argv);
+}
@@ -0,0 +1,229 @@
+#include "munit.h"
+#include "simple_gc.h"
+#include "gc_incremental.h"
+#include "gc_mark.h"
+#include <stdio.h>
+
+
+static MunitResult test_enable_disable(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024);
+
+  munit_assert_true(simple_gc_enable_incremental(&gc));
+  munit_assert_true(simple_gc_is_incremental(&gc));
+  munit_assert_not_null(gc.incremental);
+  munit_assert_not_null(gc.barrier_context);
+  munit_assert_int(gc.barrier_context->type, ==, GC_BARRIER_INCREMENTAL);
+
+  simple_gc_disable_incremental(&gc);
+  munit_assert_false(simple_gc_is_incremental(&gc));
+  munit_assert_null(gc.incremental);
+  munit_assert_null(gc.barrier_context);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_unbounded_cycle(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024);
+  simple_gc_enable_incremental(&gc);
+
+  int *root = (int*) simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  int *child = (int*) simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+
+  simple_gc_add_root(&gc, root);
+  simple_gc_add_reference(&gc, root, child);
+  munit_assert_size(gc.object_count, ==, 4);
+
+  bool done = simple_gc_collect_step(&gc, GC_INCREMENTAL_UNBOUNDED);
+  munit_assert_true(done);
+  munit_assert_false(gc_incremental_marking(&gc));
+  munit_assert_size(gc.object_count, ==, 2);
+
+  // survivors are left white for the next cycle
+  munit_assert_false(gc_is_marked(&gc, root));
+  munit_assert_false(gc_is_marked(&gc, child));
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_budgeted_steps(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_incremental(&gc);
+
+  // long chain so a 1us budget cannot finish in one step
+  const size_t chain_len = 2000;
+  void *head = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, head);
+  void *prev = head;
+  for (size_t i = 1; i < chain_len; ++i) {
+    void *obj = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    simple_gc_add_reference(&gc, prev, obj);
+    prev = obj;
+  }
+  simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int)); // garbage
+  munit_assert_size(gc.object_count, ==, chain_len + 1);
+
+  size_t steps = 0;
+  while (!simple_gc_collect_step(&gc, 1)) {
+    ++steps;
+    munit_assert_true(gc_incremental_marking(&gc));
+    munit_assert_size(steps, <, chain_len * 2);
+  }
+  munit_assert_size(steps, >, 0);
+  munit_assert_size(gc.object_count, ==, chain_len);
+
+  gc_incremental_stats_t stats;
+  gc_incremental_get_stats(&gc, &stats);
+  munit_assert_size(stats.cycles, ==, 1);
+  munit_assert_size(stats.steps, ==, steps + 1);
+  munit_assert_size(stats.objects_scanned, ==, chain_len);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_insertion_barrier(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024);
+  simple_gc_enable_incremental(&gc);
+
+  void *root = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  void *hidden = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, root);
+
+  // blacken the root while hidden is still white
+  gc_incremental_start(&gc);
+  munit_assert_size(gc_incremental_mark(&gc, 1), ==, 1);
+  munit_assert_true(gc_is_marked(&gc, root));
+  munit_assert_false(gc_is_marked(&gc, hidden));
+
+  // black -> white store must shade the target
+  simple_gc_add_reference(&gc, root, hidden);
+  munit_assert_true(gc_is_marked(&gc, hidden));
+
+  gc_incremental_stats_t stats;
+  gc_incremental_get_stats(&gc, &stats);
+  munit_assert_size(stats.barrier_shades, ==, 1);
+
+  munit_assert_true(simple_gc_collect_step(&gc, GC_INCREMENTAL_UNBOUNDED));
+  munit_assert_size(gc.object_count, ==, 2);
+  munit_assert_not_null(simple_gc_find_header(&gc, hidden));
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_allocate_black(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_incremental(&gc);
+
+  // enough live data that allocation-driven steps cannot finish the cycle
+  const size_t chain_len = 1000;
+  void *root = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, root);
+  void *prev = root;
+  for (size_t i = 1; i < chain_len; ++i) {
+    void *obj = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    simple_gc_add_reference(&gc, prev, obj);
+    prev = obj;
+  }
+
+  gc.incremental->budget_us = 1;
+  gc_incremental_start(&gc);
+  void *fresh = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  munit_assert_not_null(fresh);
+  munit_assert_true(gc_incremental_marking(&gc));
+  munit_assert_true(gc_is_marked(&gc, fresh));
+
+  // survives the cycle it was allocated in, collected by the next one
+  munit_assert_true(simple_gc_collect_step(&gc, GC_INCREMENTAL_UNBOUNDED));
+  munit_assert_size(gc.object_count, ==, chain_len + 1);
+  munit_assert_true(simple_gc_collect_step(&gc, GC_INCREMENTAL_UNBOUNDED));
+  munit_assert_size(gc.object_count, ==, chain_len);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_full_collect_aborts(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 64 * 1024);
+  simple_gc_enable_incremental(&gc);
+
+  void *root = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, root);
+
+  gc_incremental_start(&gc);
+  munit_assert_true(gc_incremental_marking(&gc));
+
+  simple_gc_collect(&gc);
+  munit_assert_false(gc_incremental_marking(&gc));
+  munit_assert_size(gc.object_count, ==, 1);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_rejects_generational(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_generations(&gc, 0);
+
+  munit_assert_false(simple_gc_enable_incremental(&gc));
+  munit_assert_null(gc.incremental);
+
+  // and the other way round
+  simple_gc_disable_generations(&gc);
+  munit_assert_true(simple_gc_enable_incremental(&gc));
+  munit_assert_false(simple_gc_enable_generations(&gc, 0));
+  munit_assert_null(gc.gen_context);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+  {"/enable_disable", test_enable_disable, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/unbounded_cycle", test_unbounded_cycle, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/budgeted_steps", test_budgeted_steps, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/insertion_barrier", test_insertion_barrier, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/allocate_black", test_allocate_black, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/full_collect_aborts", test_full_collect_aborts, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/rejects_generational", test_rejects_generational, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static const MunitSuite suite = {"/incremental", tests, NULL, 1, MUNIT_SUITE_OPTION_NONE};
+
+int main(int argc, char *argv[]) {
+  return munit_suite_main(&suite, NULL, argc, argv);
+}
@@ -0,0 +1,120 @@
+#include "munit.h"
+#include "gc_remset.h"
+#include "simple_gc.h"
+#include <stdio.h>
+
+static MunitResult test_add_contains(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  long objs[4];
+  gc_remset_t set;
+  gc_remset_init(&set);
+  munit_assert_false(gc_remset_contains(&set, &objs[0]));
+
+  munit_assert_true(gc_remset_add(&set, &objs[0]));
+  munit_assert_true(gc_remset_add(&set, &objs[1]));
+  munit_assert_true(gc_remset_contains(&set, &objs[0]));
+  munit_assert_true(gc_remset_contains(&set, &objs[1]));
+  munit_assert_false(gc_remset_contains(&set, &objs[2]));
+  munit_assert_size(gc_remset_count(&set), ==, 2);
+
+  gc_remset_destroy(&set);
+  return MUNIT_OK;
+}
+
+static MunitResult test_dedup(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  long obj;
+  gc_remset_t set;
+  gc_remset_init(&set);
+
+  // repeated stores from the same source are remembered once
+  for (int i = 0; i < 100; ++i) {
+    gc_remset_add(&set, &obj);
+  }
+  munit_assert_size(gc_remset_count(&set), ==, 1);
+  munit_assert_size(set.inserts, ==, 100);
+
+  gc_remset_destroy(&set);
+  return MUNIT_OK;
+}
+
+static MunitResult test_grow(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  #define OBJ_COUNT 1000
+
+  static long objs[OBJ_COUNT];
+  gc_remset_t set;
+  gc_remset_init(&set);
+
+  for (int i = 0; i < OBJ_COUNT; ++i) {
+    munit_assert_true(gc_remset_add(&set, &objs[i]));
+  }
+  munit_assert_size(gc_remset_count(&set), ==, OBJ_COUNT);
+  munit_assert_size(set.capacity * 3, >=, OBJ_COUNT * 4);
+  for (int i = 0; i < OBJ_COUNT; ++i) {
+    munit_assert_true(gc_remset_contains(&set, &objs[i]));
+  }
+
+  gc_remset_destroy(&set);
+  return MUNIT_OK;
+
+  #undef OBJ_COUNT
+}
+
+static void count_callback(gc_t *gc, void *obj, void *user_data) {
+  (void)gc;
+  (void)obj;
+  int *count = (int *)user_data;
+  (*count)++;
+}
+
+static MunitResult test_for_each_clear(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  long objs[10];
+  gc_remset_t set;
+  gc_remset_init(&set);
+  for (int i = 0; i < 10; ++i) {
+    gc_remset_add(&set, &objs[i]);
+    gc_remset_add(&set, &objs[i]);
+  }
+
+  int count = 0;
+  gc_remset_for_each(NULL, &set, count_callback, &count);
+  munit_assert_int(count, ==, 10);
+
+  // clearing keeps the table for the next cycle
+  size_t capacity = set.capacity;
+  gc_remset_clear(&set);
+  munit_assert_size(gc_remset_count(&set), ==, 0);
+  munit_assert_size(set.capacity, ==, capacity);
+  munit_assert_false(gc_remset_contains(&set, &objs[0]));
+
+  count = 0;
+  gc_remset_for_each(NULL, &set, count_callback, &count);
+  munit_assert_int(count, ==, 0);
+
+  gc_remset_destroy(&set);
+  return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+  {"/add_contains", test_add_contains, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/dedup", test_dedup, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/grow", test_grow, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/for_each_clear", test_for_each_clear, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static const MunitSuite suite = {"/remset", tests, NULL, 1, MUNIT_SUITE_OPTION_NONE};
+
+int main(int argc, char *argv[]) {
+  return munit_suite_main(&suite, NULL, argc, argv);
+}
@@ -0,0 +1,220 @@
+#include "munit.h"
+#include "simple_gc.h"
+#include "gc_report.h"
+#include "gc_sweep.h"
+#include <stdio.h>
+
+
+static MunitResult test_no_cycle(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024);
+
+  gc_cycle_report_t report;
+  munit_assert_false(simple_gc_last_cycle(&gc, &report));
+  munit_assert_size(simple_gc_cycle_history(&gc, &report, 1), ==, 0);
+  munit_assert_size(gc_count_swept(&gc), ==, 0);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_phase_timings(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+
+  void *root = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, root);
+  for (int i = 0; i < 500; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  simple_gc_collect(&gc);
+
+  gc_cycle_report_t report;
+  munit_assert_true(simple_gc_last_cycle(&gc, &report));
+  munit_assert_size(report.cycle, ==, 1);
+  munit_assert_string_equal(report.kind, "full");
+  munit_assert_size(report.objects_before, ==, 501);
+  munit_assert_size(report.objects_after, ==, 1);
+
+  uint64_t phases = 0;
+  for (int i = 0; i < GC_PHASE_COUNT; ++i) {
+    phases += report.phase_us[i];
+  }
+  munit_assert_uint64(phases, <=, report.total_us);
+  munit_assert_double(gc.last_collection_duration, ==, (double) report.total_us / 1000000.0);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_reclaim_by_class_and_tier(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+
+  for (int i = 0; i < 100; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, 8);
+  }
+  for (int i = 0; i < 10; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 1024);
+  }
+  simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 8192);
+  simple_gc_collect(&gc);
+
+  gc_cycle_report_t report;
+  munit_assert_true(simple_gc_last_cycle(&gc, &report));
+
+  int small_class = gc_pool_size_to_class(8);
+  munit_assert_size(report.size_class[small_class].objects, ==, 100);
+  munit_assert_size(report.size_class[small_class].bytes, ==, 100 * (sizeof(obj_header_t) + 8));
+
+  munit_assert_size(report.tier[GC_TIER_POOL].objects, ==, 100);
+  munit_assert_size(report.tier[GC_TIER_LARGE].objects, ==, 10);
+  munit_assert_size(report.tier[GC_TIER_HUGE].objects, ==, 1);
+  munit_assert_size(report.reclaimed.objects, ==, 111);
+  munit_assert_size(report.bytes_before - report.bytes_after, ==, report.reclaimed.bytes);
+
+  munit_assert_size(gc_count_swept(&gc), ==, 111);
+  munit_assert_size(gc_bytes_freed_last_sweep(&gc), ==, report.reclaimed.bytes);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_history_wraps(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+
+  size_t cycles = GC_CYCLE_HISTORY + 5;
+  for (size_t c = 0; c < cycles; ++c) {
+    for (size_t i = 0; i <= c; ++i) {
+      simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    }
+    simple_gc_collect(&gc);
+  }
+
+  gc_cycle_report_t history[GC_CYCLE_HISTORY + 4];
+  size_t count = simple_gc_cycle_history(&gc, history, GC_CYCLE_HISTORY + 4);
+  munit_assert_size(count, ==, GC_CYCLE_HISTORY);
+
+  // newest first, each cycle freed one object per cycle number
+  for (size_t i = 0; i < count; ++i) {
+    munit_assert_size(history[i].cycle, ==, cycles - i);
+    munit_assert_size(history[i].reclaimed.objects, ==, cycles - i);
+  }
+
+  munit_assert_size(simple_gc_cycle_history(&gc, history, 3), ==, 3);
+  munit_assert_size(history[2].cycle, ==, cycles - 2);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_lazy_reclaim_attributed(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_lazy_sweep(&gc);
+
+  for (int i = 0; i < 300; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  simple_gc_collect(&gc);
+
+  gc_cycle_report_t report;
+  simple_gc_last_cycle(&gc, &report);
+  munit_assert_size(report.tier[GC_TIER_POOL].objects, ==, 0);
+
+  // blocks swept after the pause still count towards the cycle
+  simple_gc_sweep_step(&gc, SIZE_MAX);
+  simple_gc_last_cycle(&gc, &report);
+  munit_assert_size(report.tier[GC_TIER_POOL].objects, ==, 300);
+
+  // the next cycle starts from an empty report
+  simple_gc_collect(&gc);
+  simple_gc_last_cycle(&gc, &report);
+  munit_assert_size(report.cycle, ==, 2);
+  munit_assert_size(report.reclaimed.objects, ==, 0);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_incremental_kind(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+
+  for (int i = 0; i < 50; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  while (!simple_gc_collect_step(&gc, 1000)) {}
+
+  gc_cycle_report_t report;
+  munit_assert_true(simple_gc_last_cycle(&gc, &report));
+  munit_assert_string_equal(report.kind, "incremental");
+  munit_assert_size(report.reclaimed.objects, ==, 50);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_minor_kind(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_generations(&gc, 64 * 1024);
+  gc.config.auto_collect = false;
+
+  int *kept = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(&gc, kept);
+  for (int i = 0; i < 9; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  simple_gc_collect_minor(&gc);
+
+  gc_cycle_report_t report;
+  munit_assert_true(simple_gc_last_cycle(&gc, &report));
+  munit_assert_string_equal(report.kind, "minor");
+  munit_assert_size(report.tier[GC_TIER_NURSERY].objects, ==, 9);
+  munit_assert_size(report.tier[GC_TIER_NURSERY].bytes, ==, 9 * sizeof(int));
+  munit_assert_size(report.reclaimed.objects, ==, 9);
+  munit_assert_uint64(report.total_us, >=, report.phase_us[GC_PHASE_MARK]);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+  {"/no_cycle", test_no_cycle, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/phase_timings", test_phase_timings, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/reclaim_by_class_and_tier", test_reclaim_by_class_and_tier, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/history_wraps", test_history_wraps, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/lazy_reclaim_attributed", test_lazy_reclaim_attributed, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/incremental_kind", test_incremental_kind, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/minor_kind", test_minor_kind, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static const MunitSuite suite = {"/report", tests, NULL, 1, MUNIT_SUITE_OPTION_NONE};
+
+int main(int argc, char *argv[]) {
+  return munit_suite_main(&suite, NULL, argc, argv);
+}
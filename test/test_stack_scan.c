@@ -277,6 +277,49 @@ static MunitResult test_register_scanning(const MunitParameter params[], void *d
   return MUNIT_OK;
 }
 
+static void NO_INLINE allocate_garbage(gc_t *gc, int count) {
+  for (int i = 0; i < count; i++) {
+    simple_gc_alloc(gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+}
+
+static MunitResult test_pins_stack_referenced(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_auto_init_stack(&gc);
+  gc.config.auto_collect = false;
+
+  // survivors known only through the stack, spread over a sparse heap
+  int * volatile kept[4];
+  for (int i = 0; i < 4; i++) {
+    allocate_garbage(&gc, 500);
+    kept[i] = (int *)simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    *kept[i] = i + 1;
+  }
+  allocate_garbage(&gc, 500);
+
+  size_t compactions_before = gc.total_compactions;
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.total_compactions, >, compactions_before);
+  munit_assert_size(gc.compaction.pinned_skipped, >=, 4);
+
+  // compaction ran but left the ambiguously referenced objects in place
+  for (int i = 0; i < 4; i++) {
+    munit_assert_not_null(simple_gc_find_header(&gc, kept[i]));
+    munit_assert_int(*kept[i], ==, i + 1);
+  }
+
+  // pins from the scan are dropped with the cycle
+  munit_assert_false(simple_gc_is_pinned(&gc, kept[0]));
+  munit_assert_size(gc.compaction.stack_pin_count, ==, 0);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
 static MunitResult test_stack_scan_performance(const MunitParameter params[], void *data) {
   (void)params;
   (void)data;
@@ -340,6 +383,7 @@ static MunitTest tests[] = {
     {"/no_false_negatives", test_stack_scan_no_false_negatives, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/platform_detection", test_stack_platform_detection, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/auto_init", test_auto_init_stack, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/pins_stack_referenced", test_pins_stack_referenced, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/auto_collect", test_fully_automatic_collection, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/register_scanning", test_register_scanning, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/perf", test_stack_scan_performance, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
@@ -0,0 +1,183 @@
+#include "munit.h"
+#include "simple_gc.h"
+#include "gc_sweep.h"
+#include "gc_sweeper.h"
+#include "gc_mark.h"
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+static void *build_chain(gc_t *gc, size_t len) {
+  void *head = simple_gc_alloc(gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  simple_gc_add_root(gc, head);
+
+  void *prev = head;
+  for (size_t i = 1; i < len; ++i) {
+    void *obj = simple_gc_alloc(gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    simple_gc_add_reference(gc, prev, obj);
+    prev = obj;
+  }
+  return head;
+}
+
+static MunitResult test_enable_disable(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024);
+
+  munit_assert_true(simple_gc_enable_background_sweep(&gc));
+  munit_assert_true(simple_gc_is_background_sweep(&gc));
+  munit_assert_true(simple_gc_is_lazy_sweep(&gc));
+  munit_assert_true(gc_sweeper_active(&gc));
+
+  simple_gc_disable_background_sweep(&gc);
+  munit_assert_false(simple_gc_is_background_sweep(&gc));
+  munit_assert_null(gc.sweeper);
+
+  simple_gc_destroy(&gc);
+
+  // generational pools are not swept lazily
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_generations(&gc, 0);
+  munit_assert_false(simple_gc_enable_background_sweep(&gc));
+  munit_assert_null(gc.sweeper);
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_sweeps_in_background(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_background_sweep(&gc);
+
+  build_chain(&gc, 10);
+  for (int i = 0; i < 990; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  size_t blocks = gc_pool_count_blocks(gc_pool_get_size_class(gc.size_classes, sizeof(int)));
+
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.sweep_pending, ==, blocks);
+
+  // results come back through the hand-off, never behind the mutator's back
+  size_t applied = 0;
+  for (int spins = 0; gc.sweep_pending > 0 && spins < 1000000; ++spins) {
+    applied += simple_gc_sweep_step(&gc, SIZE_MAX);
+    sched_yield();
+  }
+  munit_assert_size(applied, ==, blocks);
+  munit_assert_size(gc.sweep_pending, ==, 0);
+  munit_assert_size(gc.object_count, ==, 10);
+
+  gc_sweeper_stats_t stats;
+  gc_sweeper_get_stats(&gc, &stats);
+  munit_assert_size(stats.cycles, ==, 1);
+  munit_assert_size(stats.blocks_swept, ==, blocks);
+  munit_assert_size(stats.slots_freed, ==, 990);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_huge_unmapped_by_sweeper(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_background_sweep(&gc);
+
+  void *keep = simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 8192);
+  simple_gc_add_root(&gc, keep);
+  simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 8192);
+  simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 16384);
+  munit_assert_size(gc.huge_object_count, ==, 3);
+
+  // unlinked in the pause, unmapped later
+  simple_gc_collect(&gc);
+  munit_assert_size(gc.huge_object_count, ==, 1);
+  munit_assert_size(gc.object_count, ==, 1);
+
+  gc_sweep_finish(&gc);
+
+  gc_sweeper_stats_t stats;
+  gc_sweeper_get_stats(&gc, &stats);
+  munit_assert_size(stats.huge_unmapped, ==, 2);
+  munit_assert_not_null(simple_gc_find_header(&gc, keep));
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_alloc_while_sweeping(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 4 * 1024 * 1024);
+  simple_gc_enable_background_sweep(&gc);
+
+  const size_t chain_len = 300;
+  void *root = build_chain(&gc, chain_len);
+
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 2000; ++i) {
+      simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    }
+    simple_gc_collect(&gc);
+
+    // the mutator keeps allocating while the sweeper works
+    void *fresh = simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+    munit_assert_not_null(fresh);
+    simple_gc_add_reference(&gc, root, fresh);
+  }
+
+  simple_gc_collect(&gc);
+  gc_sweep_finish(&gc);
+  munit_assert_size(gc.sweep_pending, ==, 0);
+  munit_assert_size(gc.object_count, ==, chain_len + 5);
+
+  simple_gc_destroy(&gc);
+  return MUNIT_OK;
+}
+
+static MunitResult test_destroy_while_sweeping(const MunitParameter params[], void *data) {
+  (void)params;
+  (void)data;
+
+  gc_t gc;
+  simple_gc_init(&gc, 1024 * 1024);
+  simple_gc_enable_background_sweep(&gc);
+
+  for (int i = 0; i < 2000; ++i) {
+    simple_gc_alloc(&gc, OBJ_TYPE_PRIMITIVE, sizeof(int));
+  }
+  simple_gc_alloc(&gc, OBJ_TYPE_ARRAY, 8192);
+  simple_gc_collect(&gc);
+
+  // must stop the sweeper before the pools go away
+  simple_gc_destroy(&gc);
+  munit_assert_null(gc.sweeper);
+  return MUNIT_OK;
+}
+
+static MunitTest tests[] = {
+  {"/enable_disable", test_enable_disable, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/sweeps_in_background", test_sweeps_in_background, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/huge_unmapped_by_sweeper", test_huge_unmapped_by_sweeper, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/alloc_while_sweeping", test_alloc_while_sweeping, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {"/destroy_while_sweeping", test_destroy_while_sweeping, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+  {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static const MunitSuite suite = {"/sweeper", tests, NULL, 1, MUNIT_SUITE_OPTION_NONE};
+
+int main(int argc, char *argv[]) {
+  return munit_suite_main(&suite, NULL, argc, argv);
+}